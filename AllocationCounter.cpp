@@ -0,0 +1,43 @@
+#include "AllocationCounter.h"
+
+#include <crtdbg.h>
+#include <atomic>
+
+static std::atomic<unsigned int> allocationCount(0);
+static bool hookInstalled = false;
+
+#if defined(DEBUG) || defined(_DEBUG)
+// Called by the debug CRT for every heap operation on any thread
+static int CountAllocations(int allocType, void* userData, size_t size, int blockType, long requestNumber, const unsigned char* filename, int lineNumber)
+{
+	// The CRT's own bookkeeping blocks aren't ours
+	if (blockType == _CRT_BLOCK)
+		return 1;
+
+	if (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC)
+		allocationCount++;
+
+	// Let the allocation go ahead
+	return 1;
+}
+#endif
+
+void AllocationCounter::Install()
+{
+#if defined(DEBUG) || defined(_DEBUG)
+	if (!hookInstalled) {
+		_CrtSetAllocHook(CountAllocations);
+		hookInstalled = true;
+	}
+#endif
+}
+
+bool AllocationCounter::IsInstalled()
+{
+	return hookInstalled;
+}
+
+unsigned int AllocationCounter::GetCount()
+{
+	return allocationCount;
+}
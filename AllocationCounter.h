@@ -0,0 +1,15 @@
+#pragma once
+
+// --------------------------------------------------------
+// Counts heap allocations using the debug CRT's allocation
+// hook, so a section of code can be checked for allocations
+// by comparing counts before and after it.  Release builds
+// don't have the hook, and the count stays at zero.
+// --------------------------------------------------------
+class AllocationCounter
+{
+public:
+	static void Install();
+	static bool IsInstalled();
+	static unsigned int GetCount();
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+
+// --------------------------------------------------------
+// Non-owning, read-only view of a contiguous array - a
+// pointer and a count, cheap to pass around by value.
+// Only valid as long as whatever owns the data keeps it.
+// --------------------------------------------------------
+template <typename T>
+struct ArrayView
+{
+	const T* Data;
+	size_t Count;
+
+	ArrayView() : Data(0), Count(0) {}
+	ArrayView(const T* data, size_t count) : Data(data), Count(count) {}
+
+	const T& operator[](size_t index) const { return Data[index]; }
+	const T* begin() const { return Data; }
+	const T* end() const { return Data + Count; }
+
+	size_t Size() const { return Count; }
+	size_t SizeInBytes() const { return Count * sizeof(T); }
+	bool Empty() const { return Count == 0; }
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// --------------------------------------------------------
+// Axis-aligned bounding box stored as center + half extents,
+// which is the form the plane tests want
+// --------------------------------------------------------
+struct AABB
+{
+	DirectX::XMFLOAT3 Center;
+	DirectX::XMFLOAT3 Extents;
+};
+
+// --------------------------------------------------------
+// Bounding sphere packed into 16 bytes so an array of them
+// can be loaded four at a time by the batch culling path
+// --------------------------------------------------------
+struct Sphere
+{
+	DirectX::XMFLOAT3 Center;
+	float Radius;
+};
+
+// --------------------------------------------------------
+// Oriented bounding box - a box with the same center and
+// extents as an AABB in its own space, turned by a unit
+// quaternion (the form transforms and physics both use)
+// --------------------------------------------------------
+struct OBB
+{
+	DirectX::XMFLOAT3 Center;
+	DirectX::XMFLOAT3 Extents;
+	DirectX::XMFLOAT4 Orientation;
+};
+
+// --------------------------------------------------------
+// Ray for picking and line of sight queries.  Direction
+// doesn't need to be normalized, but hit distances are in
+// multiples of its length.
+// --------------------------------------------------------
+struct Ray
+{
+	DirectX::XMFLOAT3 Origin;
+	DirectX::XMFLOAT3 Direction;
+};
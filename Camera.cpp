@@ -8,6 +8,8 @@ Camera::Camera(float x, float y, float z, float moveSpeed, float mouseLookSpeed,
 {
 	this->movementSpeed = moveSpeed;
 	this->mouseLookSpeed = mouseLookSpeed;
+	this->nearClip = 0.01f;
+	this->farClip = 100.0f;
 	transform.SetPosition(x, y, z);
 
 	UpdateViewMatrix();
@@ -58,8 +60,8 @@ void Camera::UpdateViewMatrix()
 {
 	// Rotate the standard "forward" matrix by our rotation
 	// This gives us our "look direction"
-	XMFLOAT3 rot = transform.GetPitchYawRoll();
-	XMVECTOR dir = XMVector3Rotate(XMVectorSet(0, 0, 1, 0), XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&rot)));
+	XMFLOAT4 rot = transform.GetRotation();
+	XMVECTOR dir = XMVector3Rotate(XMVectorSet(0, 0, 1, 0), XMLoadFloat4(&rot));
 
 	XMFLOAT3 pos = transform.GetPosition();
 	XMMATRIX view = XMMatrixLookToLH(
@@ -76,11 +78,18 @@ void Camera::UpdateProjectionMatrix(float aspectRatio)
 	XMMATRIX P = XMMatrixPerspectiveFovLH(
 		0.25f * XM_PI,		// Field of View Angle
 		aspectRatio,		// Aspect ratio
-		0.01f,				// Near clip plane distance
-		100.0f);			// Far clip plane distance
+		nearClip,			// Near clip plane distance
+		farClip);			// Far clip plane distance
 	XMStoreFloat4x4(&projMatrix, P);
 }
 
+FrustumCuller Camera::GetFrustum()
+{
+	FrustumCuller frustum;
+	frustum.SetFrustum(viewMatrix, projMatrix);
+	return frustum;
+}
+
 Transform* Camera::GetTransform()
 {
 	return &transform;
@@ -2,6 +2,7 @@
 #include <DirectXMath.h>
 #include <Windows.h>
 
+#include "FrustumCuller.h"
 #include "Transform.h"
 
 class Camera
@@ -18,6 +19,11 @@ public:
 	// Getters
 	DirectX::XMFLOAT4X4 GetView() { return viewMatrix; }
 	DirectX::XMFLOAT4X4 GetProjection() { return projMatrix; }
+	float GetNearClip() { return nearClip; }
+	float GetFarClip() { return farClip; }
+
+	// Planes of what the current view and projection can see
+	FrustumCuller GetFrustum();
 
 	Transform* GetTransform();
 
@@ -25,6 +31,8 @@ private:
 	// Camera matrices
 	DirectX::XMFLOAT4X4 viewMatrix;
 	DirectX::XMFLOAT4X4 projMatrix;
+	float nearClip;
+	float farClip;
 
 	Transform transform;
 
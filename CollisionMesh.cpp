@@ -3,57 +3,34 @@
 using namespace physx;
 using namespace DirectX;
 
-CollisionMesh::CollisionMesh(Mesh* mesh, physx::PxU32 tris, Material* texture, physx::PxMaterial* material, physx::PxCooking* cooking, physx::PxPhysics* physics, physx::PxVec3 scaleBy, physx::PxVec3 position, float rotation)
+CollisionMesh::CollisionMesh(Mesh* mesh, Material* texture, physx::PxMaterial* material, CollisionMeshCache* collisionMeshes, physx::PxPhysics* physics, physx::PxVec3 scaleBy, physx::PxVec3 position, float rotation, unsigned int flags)
 {
-	std::vector<PxVec3> verts;
-	std::vector<Vertex> vertices = mesh->GetVertices();
-	std::vector<unsigned int> indices = mesh->GetIndices();
-
-	// build vertices
-	unsigned int nbVerts = mesh->GetNumVertices();
-	for (unsigned int i = 0; i < nbVerts; i++) {
-		XMFLOAT3 vert = vertices[i].Position;
-
-		verts.push_back(PxVec3(
-			vert.x,
-			vert.y,
-			vert.z
-		));
+	body = 0;
+	entity = 0;
+
+	PxTransform pose(position, PxQuat(rotation, PxVec3(0, 1, 0)));
+
+	if (flags & LEVEL_BLOCK_COLLIDES) {
+		// every block made from the same mesh shares one cooked mesh
+		PxTriangleMesh* triMesh = collisionMeshes->Get(mesh);
+		if (triMesh) {
+			// make actor
+			PxMeshScale scale(PxVec3(scaleBy.x, scaleBy.y, scaleBy.z));
+			PxShape* aTriShape = physics->createShape(PxTriangleMeshGeometry(triMesh, scale), *material);
+			body = physics->createRigidStatic(pose);
+			body->attachShape(*aTriShape);
+
+			aTriShape->release();
+		}
 	}
 
-	// cook triangle mesh
-	PxTriangleMeshDesc meshDesc;
-	meshDesc.points.count = nbVerts;
-	meshDesc.points.stride = sizeof(PxVec3);
-	meshDesc.points.data = &verts[0];
-
-	meshDesc.triangles.count = tris;
-	meshDesc.triangles.stride = 3 * sizeof(unsigned int);
-	meshDesc.triangles.data = &indices[0];
-
-	PxDefaultMemoryOutputStream writeBuffer;
-	bool status = cooking->cookTriangleMesh(meshDesc, writeBuffer);
-	if (!status)
-		return;
-
-	// make actor
-	PxDefaultMemoryInputData readBuffer(writeBuffer.getData(), writeBuffer.getSize());
-	PxTriangleMesh* triMesh = physics->createTriangleMesh(readBuffer);
-
-	PxMeshScale scale(PxVec3(scaleBy.x, scaleBy.y, scaleBy.z));
-	PxShape* aTriShape = physics->createShape(PxTriangleMeshGeometry(triMesh, scale), *material);
-	body = physics->createRigidStatic(PxTransform(position, PxQuat(rotation, PxVec3(0, 1, 0))));
-	body->attachShape(*aTriShape);
-
-	aTriShape->release();
-
-	// make corresponding entity
-	entity = new GameEntity(mesh, texture);
-	PxVec3 pos = body->getGlobalPose().p;
-	entity->GetTransform()->SetPosition(pos.x, pos.y, pos.z);
-	entity->GetTransform()->SetScale(scaleBy.x, scaleBy.y, scaleBy.z);
-	PxQuat quat = body->getGlobalPose().q;
-	entity->GetTransform()->SetRotationQuat(quat.x, quat.y, quat.z, quat.w);
+	if (flags & LEVEL_BLOCK_VISIBLE) {
+		// make corresponding entity
+		entity = new GameEntity(mesh, texture);
+		entity->GetTransform()->SetPosition(pose.p.x, pose.p.y, pose.p.z);
+		entity->GetTransform()->SetScale(scaleBy.x, scaleBy.y, scaleBy.z);
+		entity->GetTransform()->SetRotationQuat(pose.q.x, pose.q.y, pose.q.z, pose.q.w);
+	}
 }
 
 CollisionMesh::~CollisionMesh() {}
@@ -5,13 +5,16 @@
 #include <PxPhysics.h>
 #include <PxPhysicsAPI.h>
 #include "GameEntity.h"
+#include "CollisionMeshCache.h"
+#include "LevelFile.h"
 
 class CollisionMesh
 {
 public:
-	CollisionMesh(Mesh* mesh, physx::PxU32 tris, Material* texture, physx::PxMaterial* material, physx::PxCooking* cooking, physx::PxPhysics* physics, physx::PxVec3 scaleBy, physx::PxVec3 position, float rotation);
+	CollisionMesh(Mesh* mesh, Material* texture, physx::PxMaterial* material, CollisionMeshCache* collisionMeshes, physx::PxPhysics* physics, physx::PxVec3 scaleBy, physx::PxVec3 position, float rotation, unsigned int flags = LEVEL_BLOCK_DEFAULT);
 	~CollisionMesh();
 
+	// Either can be null, for blocks that are hidden or don't collide
 	physx::PxRigidStatic* GetBody(); 
 	GameEntity* GetEntity();
 
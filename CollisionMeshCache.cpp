@@ -0,0 +1,174 @@
+#include "CollisionMeshCache.h"
+#include "Hashing.h"
+
+#include <fstream>
+#include <vector>
+
+using namespace physx;
+
+CollisionMeshCache::CollisionMeshCache(PxPhysics* physics, PxCooking* cooking) :
+	physics(physics),
+	cooking(cooking),
+	cookCount(0),
+	diskLoadCount(0),
+	sharedCount(0)
+{
+}
+
+CollisionMeshCache::~CollisionMeshCache()
+{
+	Clear();
+}
+
+void CollisionMeshCache::Clear()
+{
+	for (auto& entry : triangleMeshes)
+		entry.second->release();
+	triangleMeshes.clear();
+}
+
+PxTriangleMesh* CollisionMeshCache::Get(Mesh* mesh)
+{
+	auto found = triangleMeshes.find(mesh);
+	if (found != triangleMeshes.end()) {
+		sharedCount++;
+		return found->second;
+	}
+
+	if (!mesh->HasCPUGeometry())
+		return 0;
+
+	// Meshes built in code have nowhere sensible to save to
+	uint64_t key = HashGeometry(mesh);
+	std::string cacheFile;
+	if (!mesh->GetSourceFile().empty())
+		cacheFile = GetCacheFileName(mesh->GetSourceFile());
+
+	PxTriangleMesh* triMesh = 0;
+	if (!cacheFile.empty())
+		triMesh = ReadCacheFile(cacheFile, key);
+	if (triMesh)
+		diskLoadCount++;
+	else
+		triMesh = Cook(mesh, key, cacheFile);
+
+	if (triMesh)
+		triangleMeshes[mesh] = triMesh;
+	return triMesh;
+}
+
+PxTriangleMesh* CollisionMeshCache::Cook(Mesh* mesh, uint64_t key, const std::string& cacheFile)
+{
+	ArrayView<Vertex> vertices = mesh->GetVertices();
+	ArrayView<unsigned int> indices = mesh->GetIndices();
+
+	// submesh indices are relative to their base vertex, so a mesh
+	// with more than one needs absolute indices for a single
+	// physics mesh - the only case that needs its own copy
+	std::vector<unsigned int> rebased;
+	const unsigned int* triangles = indices.Data;
+	for (unsigned int s = 0; s < mesh->GetSubmeshCount(); s++) {
+		const Submesh& submesh = mesh->GetSubmesh(s);
+		if (submesh.BaseVertex == 0)
+			continue;
+
+		if (rebased.empty()) {
+			rebased.assign(indices.begin(), indices.end());
+			triangles = &rebased[0];
+		}
+		for (unsigned int i = 0; i < submesh.IndexCount; i++)
+			rebased[submesh.IndexStart + i] += submesh.BaseVertex;
+	}
+
+	// positions are pulled out of the full vertices by stride
+	PxTriangleMeshDesc meshDesc;
+	meshDesc.points.count = (PxU32)vertices.Size();
+	meshDesc.points.stride = sizeof(Vertex);
+	meshDesc.points.data = &vertices[0].Position;
+
+	meshDesc.triangles.count = (PxU32)(indices.Size() / 3);
+	meshDesc.triangles.stride = 3 * sizeof(unsigned int);
+	meshDesc.triangles.data = triangles;
+
+	PxDefaultMemoryOutputStream writeBuffer;
+	if (!cooking->cookTriangleMesh(meshDesc, writeBuffer))
+		return 0;
+	cookCount++;
+
+	// Save the stream, quietly doing nothing on failure
+	// (a read-only install just means cooking every run)
+	if (!cacheFile.empty()) {
+		CollisionCacheHeader h = {};
+		h.Magic = COLLISION_CACHE_MAGIC;
+		h.Version = COLLISION_CACHE_VERSION;
+		h.PhysXVersion = PX_PHYSICS_VERSION;
+		h.StreamSize = writeBuffer.getSize();
+		h.Key = key;
+
+		std::ofstream out(cacheFile, std::ios::binary | std::ios::trunc);
+		if (out.is_open()) {
+			out.write((const char*)&h, sizeof(h));
+			out.write((const char*)writeBuffer.getData(), writeBuffer.getSize());
+		}
+	}
+
+	PxDefaultMemoryInputData readBuffer(writeBuffer.getData(), writeBuffer.getSize());
+	return physics->createTriangleMesh(readBuffer);
+}
+
+// --------------------------------------------------------
+// Reads a cooked stream with a single file read.  Fails if
+// the file is missing, damaged, from another version of
+// PhysX or of this format, or cooked from other geometry.
+// --------------------------------------------------------
+PxTriangleMesh* CollisionMeshCache::ReadCacheFile(const std::string& cacheFile, uint64_t key)
+{
+	std::ifstream file(cacheFile, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return 0;
+
+	std::streamoff fileSize = file.tellg();
+	if (fileSize < (std::streamoff)sizeof(CollisionCacheHeader))
+		return 0;
+
+	std::vector<unsigned char> bytes((size_t)fileSize);
+	file.seekg(0);
+	if (!file.read((char*)bytes.data(), bytes.size()))
+		return 0;
+
+	const CollisionCacheHeader* h = (const CollisionCacheHeader*)bytes.data();
+	if (h->Magic != COLLISION_CACHE_MAGIC ||
+		h->Version != COLLISION_CACHE_VERSION ||
+		h->PhysXVersion != PX_PHYSICS_VERSION ||
+		h->Key != key ||
+		sizeof(CollisionCacheHeader) + (size_t)h->StreamSize != bytes.size())
+		return 0;
+
+	PxDefaultMemoryInputData readBuffer(bytes.data() + sizeof(CollisionCacheHeader), h->StreamSize);
+	return physics->createTriangleMesh(readBuffer);
+}
+
+uint64_t CollisionMeshCache::HashGeometry(Mesh* mesh)
+{
+	ArrayView<Vertex> vertices = mesh->GetVertices();
+	ArrayView<unsigned int> indices = mesh->GetIndices();
+
+	// Hash each array, then the hashes (with the submesh table, as
+	// it changes what the relative indices mean)
+	std::vector<uint64_t> hashes;
+	hashes.push_back(Hashing::FNV1a(vertices.Data, vertices.SizeInBytes()));
+	hashes.push_back(Hashing::FNV1a(indices.Data, indices.SizeInBytes()));
+	for (unsigned int s = 0; s < mesh->GetSubmeshCount(); s++)
+		hashes.push_back(mesh->GetSubmesh(s).BaseVertex);
+	return Hashing::FNV1a(hashes.data(), hashes.size() * sizeof(uint64_t));
+}
+
+std::string CollisionMeshCache::GetCacheFileName(const std::string& modelFile)
+{
+	std::string name(modelFile);
+	size_t dot = name.find_last_of('.');
+	size_t slash = name.find_last_of("/\\");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		name.erase(dot);
+	return name + ".pxcooked";
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <PxPhysicsAPI.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+#include "Mesh.h"
+
+// --------------------------------------------------------
+// Cooked cache file layout - this header, then the stream
+// PxCooking wrote.  The key is a hash of the geometry that
+// was cooked, so a stale file is caught even if it's newer
+// than the model, and the PhysX version guards the format.
+// --------------------------------------------------------
+#define COLLISION_CACHE_MAGIC 0x4B4F4F43u // "COOK"
+#define COLLISION_CACHE_VERSION 1
+
+struct CollisionCacheHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t PhysXVersion;
+	uint32_t StreamSize;
+	uint64_t Key;
+};
+
+// --------------------------------------------------------
+// Cooks each Mesh into a PxTriangleMesh once, and hands the
+// same one to everything using that Mesh - scale and pose
+// live on the shape and actor, not in the cooked data.
+//
+// The cache keeps one reference to each triangle mesh, and
+// every shape made from it holds its own, so clearing the
+// cache doesn't pull collision out from under live actors.
+// Meshes loaded from a file also save the cooked stream next
+// to it, so later runs skip cooking entirely.
+// --------------------------------------------------------
+class CollisionMeshCache
+{
+public:
+	CollisionMeshCache(physx::PxPhysics* physics, physx::PxCooking* cooking);
+	~CollisionMeshCache();
+
+	// The shared triangle mesh for this Mesh, which needs its CPU
+	// geometry the first time (or null if it can't be cooked)
+	physx::PxTriangleMesh* Get(Mesh* mesh);
+
+	// Drops the cache's references
+	void Clear();
+
+	// How each mesh was found, for checking the cache pays off
+	unsigned int GetCookCount() { return cookCount; }
+	unsigned int GetDiskLoadCount() { return diskLoadCount; }
+	unsigned int GetSharedCount() { return sharedCount; }
+
+	// "Models/cube.obj" -> "Models/cube.pxcooked"
+	static std::string GetCacheFileName(const std::string& modelFile);
+
+private:
+	physx::PxPhysics* physics;
+	physx::PxCooking* cooking;
+	std::unordered_map<Mesh*, physx::PxTriangleMesh*> triangleMeshes;
+
+	unsigned int cookCount;
+	unsigned int diskLoadCount;
+	unsigned int sharedCount;
+
+	physx::PxTriangleMesh* Cook(Mesh* mesh, uint64_t key, const std::string& cacheFile);
+	physx::PxTriangleMesh* ReadCacheFile(const std::string& cacheFile, uint64_t key);
+
+	static uint64_t HashGeometry(Mesh* mesh);
+};
@@ -0,0 +1,87 @@
+#include "ConstantBufferRing.h"
+
+// Offsets passed to *SetConstantBuffers1() are in 16 byte
+// constants and must be multiples of 16 constants
+#define RING_SLICE_ALIGNMENT	256
+#define BYTES_PER_CONSTANT		16
+
+ConstantBufferRing::ConstantBufferRing(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	unsigned int sizeInBytes) :
+		device(device),
+		context(context),
+		suballocator(0, RING_SLICE_ALIGNMENT),
+		mappedData(0),
+		supported(false)
+{
+	// Binding with offsets needs the 11.1 runtime and driver support
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+		supported = options.ConstantBufferOffsetting == TRUE;
+
+	// Always room for at least one slice, so growing by doubling works
+	unsigned int initialSize = RingSuballocator::AlignUp(sizeInBytes, RING_SLICE_ALIGNMENT);
+	CreateBuffer(initialSize > 0 ? initialSize : RING_SLICE_ALIGNMENT);
+}
+
+ConstantBufferRing::~ConstantBufferRing()
+{
+	End();
+}
+
+bool ConstantBufferRing::Begin()
+{
+	if (!supported || mappedData)
+		return false;
+
+	// Grow if last frame ran out of room, so it only falls back once
+	if (suballocator.GetRequested() > suballocator.GetCapacity())
+		CreateBuffer(suballocator.GetCapacityNeeded());
+
+	suballocator.Reset();
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return false;
+
+	mappedData = (unsigned char*)mapped.pData;
+	return true;
+}
+
+bool ConstantBufferRing::Allocate(unsigned int size, ConstantBufferSlice* sliceOut)
+{
+	if (!mappedData)
+		return false;
+
+	unsigned int offset = 0;
+	if (!suballocator.Allocate(size, &offset))
+		return false;
+
+	sliceOut->Data = mappedData + offset;
+	sliceOut->FirstConstant = offset / BYTES_PER_CONSTANT;
+	sliceOut->NumConstants = RingSuballocator::AlignUp(size, RING_SLICE_ALIGNMENT) / BYTES_PER_CONSTANT;
+	return true;
+}
+
+void ConstantBufferRing::End()
+{
+	if (!mappedData)
+		return;
+
+	context->Unmap(buffer.Get(), 0);
+	mappedData = 0;
+}
+
+void ConstantBufferRing::CreateBuffer(unsigned int sizeInBytes)
+{
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = sizeInBytes;
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	buffer.Reset();
+	device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+	suballocator.Resize(sizeInBytes);
+}
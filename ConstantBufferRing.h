@@ -0,0 +1,58 @@
+#pragma once
+
+#include <d3d11_1.h>
+#include <wrl/client.h>
+
+#include "RingSuballocator.h"
+
+// --------------------------------------------------------
+// A piece of the ring's buffer for one draw.  Data is only
+// valid between Begin() and End(), the constants are what
+// gets passed to *SetConstantBuffers1() afterwards.
+// --------------------------------------------------------
+struct ConstantBufferSlice
+{
+	void* Data;
+	unsigned int FirstConstant;
+	unsigned int NumConstants;
+};
+
+// --------------------------------------------------------
+// One large dynamic constant buffer that is mapped once per
+// frame with WRITE_DISCARD and split into 256 byte aligned
+// slices, so per object data doesn't need an UpdateSubresource
+// on a tiny buffer for every draw.  Needs D3D 11.1 constant
+// buffer offsetting - check IsSupported() first.
+// --------------------------------------------------------
+class ConstantBufferRing
+{
+public:
+	ConstantBufferRing(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		unsigned int sizeInBytes);
+	~ConstantBufferRing();
+
+	bool IsSupported() { return supported; }
+
+	// All slices for a frame are written between these two,
+	// and the buffer has to be unmapped before any draws use it
+	bool Begin();
+	bool Allocate(unsigned int size, ConstantBufferSlice* sliceOut);
+	void End();
+
+	ID3D11Buffer* GetBuffer() { return buffer.Get(); }
+	unsigned int GetCapacity() { return suballocator.GetCapacity(); }
+	unsigned int GetBytesUsed() { return suballocator.GetUsed(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+
+	RingSuballocator suballocator;
+	unsigned char* mappedData;
+	bool supported;
+
+	void CreateBuffer(unsigned int sizeInBytes);
+};
@@ -0,0 +1,159 @@
+#include "DrawSorter.h"
+
+#include <chrono>
+#include <stdlib.h>
+
+// Field widths, matching the layout described in the header
+#define SORT_BITS_PASS		2
+#define SORT_BITS_SHADER	8
+#define SORT_BITS_MATERIAL	10
+#define SORT_BITS_MESH		10
+#define SORT_BITS_SUBMESH	4
+#define SORT_BITS_DEPTH		22
+
+static_assert(SORT_BITS_PASS + SORT_BITS_SHADER * 2 + SORT_BITS_MATERIAL + SORT_BITS_MESH + SORT_BITS_SUBMESH + SORT_BITS_DEPTH == 64,
+	"Sort key fields have to fill exactly 64 bits");
+
+#define SORT_MASK(bits) ((1ull << (bits)) - 1)
+
+uint64_t DrawSorter::MakeKey(RenderPass pass, unsigned int vsID, unsigned int psID, unsigned int materialID, unsigned int meshID, unsigned int submesh, float viewDepth, float farDepth)
+{
+	// Quantize depth into the range of the depth field
+	float normalized = farDepth > 0 ? viewDepth / farDepth : 0;
+	if (normalized < 0) normalized = 0;
+	if (normalized > 1) normalized = 1;
+	uint64_t depth = (uint64_t)(normalized * SORT_MASK(SORT_BITS_DEPTH));
+
+	// State bits are the same for every pass
+	uint64_t state =
+		((uint64_t)(vsID & SORT_MASK(SORT_BITS_SHADER)) << (SORT_BITS_SHADER + SORT_BITS_MATERIAL + SORT_BITS_MESH + SORT_BITS_SUBMESH)) |
+		((uint64_t)(psID & SORT_MASK(SORT_BITS_SHADER)) << (SORT_BITS_MATERIAL + SORT_BITS_MESH + SORT_BITS_SUBMESH)) |
+		((uint64_t)(materialID & SORT_MASK(SORT_BITS_MATERIAL)) << (SORT_BITS_MESH + SORT_BITS_SUBMESH)) |
+		((uint64_t)(meshID & SORT_MASK(SORT_BITS_MESH)) << SORT_BITS_SUBMESH) |
+		((uint64_t)(submesh & SORT_MASK(SORT_BITS_SUBMESH)));
+
+	uint64_t key = (uint64_t)pass << (64 - SORT_BITS_PASS);
+
+	if (pass == PASS_REFRACTIVE)
+	{
+		// Farthest first, then state
+		uint64_t invDepth = SORT_MASK(SORT_BITS_DEPTH) - depth;
+		key |= invDepth << (64 - SORT_BITS_PASS - SORT_BITS_DEPTH);
+		key |= state;
+	}
+	else
+	{
+		// State first, then nearest first
+		key |= state << SORT_BITS_DEPTH;
+		key |= depth;
+	}
+
+	return key;
+}
+
+void DrawSorter::Clear()
+{
+	// Keeps capacity around for the next frame
+	keys.clear();
+}
+
+void DrawSorter::Add(uint64_t key, unsigned int index)
+{
+	DrawKey draw;
+	draw.Key = key;
+	draw.Index = index;
+	keys.push_back(draw);
+}
+
+// --------------------------------------------------------
+// LSD radix sort, one byte per pass.  All eight histograms
+// are built in a single read of the keys, and any pass where
+// every key has the same byte is skipped entirely - common
+// since most scenes only use a few shaders and materials.
+// --------------------------------------------------------
+void DrawSorter::Sort()
+{
+	unsigned int count = (unsigned int)keys.size();
+	if (count < 2)
+		return;
+
+	scratch.resize(count);
+
+	unsigned int histograms[8][256] = {};
+	for (unsigned int i = 0; i < count; i++)
+	{
+		uint64_t key = keys[i].Key;
+		for (int b = 0; b < 8; b++)
+			histograms[b][(key >> (b * 8)) & 0xFF]++;
+	}
+
+	DrawKey* src = &keys[0];
+	DrawKey* dst = &scratch[0];
+	for (int b = 0; b < 8; b++)
+	{
+		unsigned int* histogram = histograms[b];
+
+		// Skip if every key landed in one bucket
+		if (histogram[(src[0].Key >> (b * 8)) & 0xFF] == count)
+			continue;
+
+		// Turn counts into starting offsets
+		unsigned int offset = 0;
+		for (int i = 0; i < 256; i++)
+		{
+			unsigned int bucketCount = histogram[i];
+			histogram[i] = offset;
+			offset += bucketCount;
+		}
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int bucket = (src[i].Key >> (b * 8)) & 0xFF;
+			dst[histogram[bucket]++] = src[i];
+		}
+
+		DrawKey* temp = src;
+		src = dst;
+		dst = temp;
+	}
+
+	// An odd number of passes leaves the result in scratch
+	if (src != &keys[0])
+		keys.swap(scratch);
+}
+
+float DrawSorter::Benchmark(unsigned int drawCount, unsigned int iterations)
+{
+	// A handful of shaders and materials, lots of meshes and depths,
+	// which is roughly what a big level looks like
+	std::vector<uint64_t> randomKeys(drawCount);
+	for (unsigned int i = 0; i < drawCount; i++)
+	{
+		randomKeys[i] = MakeKey(
+			rand() % 8 == 0 ? PASS_REFRACTIVE : PASS_OPAQUE,
+			rand() % 4,
+			rand() % 4,
+			rand() % 64,
+			rand() % 256,
+			rand() % 4,
+			(float)rand() / RAND_MAX * 100.0f,
+			100.0f);
+	}
+
+	DrawSorter sorter;
+	float totalMilliseconds = 0;
+	for (unsigned int it = 0; it < iterations; it++)
+	{
+		sorter.Clear();
+		for (unsigned int i = 0; i < drawCount; i++)
+			sorter.Add(randomKeys[i], i);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		sorter.Sort();
+		auto end = std::chrono::high_resolution_clock::now();
+
+		totalMilliseconds += std::chrono::duration<float, std::milli>(end - start).count();
+	}
+
+	return iterations > 0 ? totalMilliseconds / iterations : 0;
+}
@@ -41,6 +41,14 @@ Emitter::Emitter(
 	indexFirstAlive = 0;
 	indexFirstDead = 0;
 
+	// look up shader data once
+	particleDataHandle = ISimpleShader::GetShaderResourceViewHandle("ParticleData");
+	textureHandle = ISimpleShader::GetShaderResourceViewHandle("Texture");
+	colorTintHandle = ISimpleShader::GetVariableHandle("ColorTint");
+	viewHandle = ISimpleShader::GetVariableHandle("view");
+	projectionHandle = ISimpleShader::GetVariableHandle("projection");
+	currentTimeHandle = ISimpleShader::GetVariableHandle("currentTime");
+
 	// set up particle array
 	particles = new Particle[maxParticles];
 	ZeroMemory(particles, sizeof(Particle) * maxParticles);
@@ -57,15 +65,8 @@ Emitter::Emitter(
 		indices[indexCount++] = i + 2;
 		indices[indexCount++] = i + 3;
 	}
-	D3D11_SUBRESOURCE_DATA indexData = {};
-	indexData.pSysMem = indices;
-
-	D3D11_BUFFER_DESC ibDesc = {};
-	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibDesc.CPUAccessFlags = 0;
-	ibDesc.Usage = D3D11_USAGE_DEFAULT;
-	ibDesc.ByteWidth = sizeof(unsigned int) * maxParticles * 6;
-	device->CreateBuffer(&ibDesc, &indexData, indexBuffer.GetAddressOf());
+	// 16-bit unless there are more than 16k particles
+	indexFormat = Mesh::CreateIndexBuffer(device, indices, maxParticles * 6, indexBuffer.GetAddressOf());
 	delete[] indices;
 
 	// create dynamic buffer
@@ -166,19 +167,19 @@ void Emitter::Draw(Camera* camera, float currentTime)
 	UINT offset = 0;
 	ID3D11Buffer* nullBuffer = 0;
 	context->IASetVertexBuffers(0, 1, &nullBuffer, &stride, &offset);
-	context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	context->IASetIndexBuffer(indexBuffer.Get(), indexFormat, 0);
 
 	vs->SetShader();
 	ps->SetShader();
 
-	vs->SetShaderResourceView("ParticleData", particleDataSRV);
-	ps->SetShaderResourceView("Texture", texture);
-	ps->SetFloat4("ColorTint", colorTint);
+	vs->SetShaderResourceView(particleDataHandle, particleDataSRV);
+	ps->SetShaderResourceView(textureHandle, texture);
+	ps->SetFloat4(colorTintHandle, colorTint);
 	ps->CopyAllBufferData();
 
-	vs->SetMatrix4x4("view", camera->GetView());
-	vs->SetMatrix4x4("projection", camera->GetProjection());
-	vs->SetFloat("currentTime", currentTime);
+	vs->SetMatrix4x4(viewHandle, camera->GetView());
+	vs->SetMatrix4x4(projectionHandle, camera->GetProjection());
+	vs->SetFloat(currentTimeHandle, currentTime);
 	vs->CopyAllBufferData();
 
 	// draw particles
@@ -7,6 +7,7 @@
 #include "SimpleShader.h"
 #include "Camera.h"
 #include "Transform.h"
+#include "Mesh.h"
 
 enum Shape { EM_POINT, EM_CUBE, EM_SPHERE };
 
@@ -112,6 +113,7 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> particleDataBuffer;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> particleDataSRV;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	DXGI_FORMAT indexFormat;
 
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> texture;
 	SimpleVertexShader* vs;
@@ -119,6 +121,14 @@ private:
 
 	Transform* transform;
 
+	// shader handles
+	SimpleSRVHandle particleDataHandle;
+	SimpleSRVHandle textureHandle;
+	SimpleVariableHandle colorTintHandle;
+	SimpleVariableHandle viewHandle;
+	SimpleVariableHandle projectionHandle;
+	SimpleVariableHandle currentTimeHandle;
+
 	// helper methods
 	void UpdateSingleParticle(float currentTime, int index);
 	void EmitParticle(float currentTime);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <Windows.h>
+
+// --------------------------------------------------------
+// Last write time checks for files built from other files
+// (mesh caches, binary levels), so each can tell whether
+// it needs rebuilding without knowing about the others
+// --------------------------------------------------------
+class FileTimes
+{
+public:
+	// True if the built file exists and is no older than its
+	// source (or there's no source, in which case the built
+	// file is all we have)
+	static bool IsUpToDate(const char* sourceFile, const char* builtFile)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA builtAttributes;
+		if (!GetFileAttributesExA(builtFile, GetFileExInfoStandard, &builtAttributes))
+			return false;
+
+		WIN32_FILE_ATTRIBUTE_DATA sourceAttributes;
+		if (!GetFileAttributesExA(sourceFile, GetFileExInfoStandard, &sourceAttributes))
+			return true;
+
+		return CompareFileTime(&sourceAttributes.ftLastWriteTime, &builtAttributes.ftLastWriteTime) <= 0;
+	}
+};
@@ -0,0 +1,246 @@
+#include "FrustumCuller.h"
+
+using namespace DirectX;
+
+FrustumCuller::FrustumCuller()
+{
+	// Start with planes that accept everything
+	for (int i = 0; i < 6; i++)
+		planes[i] = XMFLOAT4(0, 0, 0, 1);
+}
+
+// Splats each plane component once, for the batch tests
+static void SplatPlanes(const XMFLOAT4* planes, XMVECTOR* planeX, XMVECTOR* planeY, XMVECTOR* planeZ, XMVECTOR* planeW)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		XMVECTOR plane = XMLoadFloat4(&planes[i]);
+		planeX[i] = XMVectorSplatX(plane);
+		planeY[i] = XMVectorSplatY(plane);
+		planeZ[i] = XMVectorSplatZ(plane);
+		planeW[i] = XMVectorSplatW(plane);
+	}
+}
+
+// Turns an all-bits comparison mask into 1s and 0s, returning
+// how many of the four were set
+static unsigned int StoreMask(FXMVECTOR mask, unsigned char* out)
+{
+	XMUINT4 bits;
+	XMStoreUInt4(&bits, mask);
+	out[0] = bits.x ? 1 : 0;
+	out[1] = bits.y ? 1 : 0;
+	out[2] = bits.z ? 1 : 0;
+	out[3] = bits.w ? 1 : 0;
+	return out[0] + out[1] + out[2] + out[3];
+}
+
+// --------------------------------------------------------
+// Pulls the frustum planes out of the combined view-projection
+// matrix (Gribb/Hartmann).  DirectXMath uses row vectors, so the
+// planes are built from the columns of the matrix, which are the
+// rows of its transpose.
+// --------------------------------------------------------
+void FrustumCuller::SetFrustum(DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 projection)
+{
+	XMMATRIX viewProj = XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection));
+	XMMATRIX cols = XMMatrixTranspose(viewProj);
+
+	XMVECTOR p[6];
+	p[0] = cols.r[3] + cols.r[0]; // Left
+	p[1] = cols.r[3] - cols.r[0]; // Right
+	p[2] = cols.r[3] + cols.r[1]; // Bottom
+	p[3] = cols.r[3] - cols.r[1]; // Top
+	p[4] = cols.r[2];             // Near (D3D clip space z is 0 to w)
+	p[5] = cols.r[3] - cols.r[2]; // Far
+
+	for (int i = 0; i < 6; i++)
+		XMStoreFloat4(&planes[i], XMPlaneNormalize(p[i]));
+}
+
+bool FrustumCuller::IsVisible(const Sphere& sphere)
+{
+	XMVECTOR center = XMVectorSetW(XMLoadFloat3(&sphere.Center), 1.0f);
+
+	for (int i = 0; i < 6; i++)
+	{
+		float dist = XMVectorGetX(XMPlaneDot(XMLoadFloat4(&planes[i]), center));
+		if (dist < -sphere.Radius)
+			return false;
+	}
+
+	return true;
+}
+
+bool FrustumCuller::IsVisible(const AABB& box)
+{
+	XMVECTOR center = XMVectorSetW(XMLoadFloat3(&box.Center), 1.0f);
+	XMVECTOR extents = XMLoadFloat3(&box.Extents);
+
+	for (int i = 0; i < 6; i++)
+	{
+		XMVECTOR plane = XMLoadFloat4(&planes[i]);
+
+		// Distance from the center, and how far the box
+		// reaches along the plane normal
+		float dist = XMVectorGetX(XMPlaneDot(plane, center));
+		float radius = XMVectorGetX(XMVector3Dot(XMVectorAbs(plane), extents));
+
+		if (dist + radius < 0)
+			return false;
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Same as the AABB test, but the box's own axes are turned,
+// so its reach along each plane normal is the extents times
+// how much each of those axes lines up with the normal
+// --------------------------------------------------------
+bool FrustumCuller::IsVisible(const OBB& box)
+{
+	XMVECTOR center = XMVectorSetW(XMLoadFloat3(&box.Center), 1.0f);
+	XMVECTOR extents = XMLoadFloat3(&box.Extents);
+
+	// Rows of the rotation are the box's axes, so transforming by
+	// its transpose dots the plane normal with each of them
+	XMMATRIX toBox = XMMatrixTranspose(XMMatrixRotationQuaternion(XMLoadFloat4(&box.Orientation)));
+
+	for (int i = 0; i < 6; i++)
+	{
+		XMVECTOR plane = XMLoadFloat4(&planes[i]);
+
+		XMVECTOR alignment = XMVectorAbs(XMVector3TransformNormal(plane, toBox));
+		float dist = XMVectorGetX(XMPlaneDot(plane, center));
+		float radius = XMVectorGetX(XMVector3Dot(alignment, extents));
+
+		if (dist + radius < 0)
+			return false;
+	}
+
+	return true;
+}
+
+unsigned int FrustumCuller::CullSpheres(const Sphere* spheres, unsigned int count, unsigned char* visibleOut)
+{
+	unsigned int visibleCount = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		visibleOut[i] = IsVisible(spheres[i]) ? 1 : 0;
+		visibleCount += visibleOut[i];
+	}
+
+	return visibleCount;
+}
+
+// --------------------------------------------------------
+// Tests four spheres per iteration.  Each group of four is
+// transposed into x/y/z/radius registers so a plane test is
+// three multiply-adds and a compare for all four at once.
+// --------------------------------------------------------
+unsigned int FrustumCuller::CullSpheresSIMD(const Sphere* spheres, unsigned int count, unsigned char* visibleOut)
+{
+	XMVECTOR planeX[6], planeY[6], planeZ[6], planeW[6];
+	SplatPlanes(planes, planeX, planeY, planeZ, planeW);
+
+	unsigned int visibleCount = 0;
+	unsigned int batchEnd = count & ~3u;
+	for (unsigned int i = 0; i < batchEnd; i += 4)
+	{
+		// Sphere is 16 bytes, so each one loads as a single vector
+		XMMATRIX group(
+			XMLoadFloat4((const XMFLOAT4*)&spheres[i + 0]),
+			XMLoadFloat4((const XMFLOAT4*)&spheres[i + 1]),
+			XMLoadFloat4((const XMFLOAT4*)&spheres[i + 2]),
+			XMLoadFloat4((const XMFLOAT4*)&spheres[i + 3]));
+		XMMATRIX soa = XMMatrixTranspose(group);
+
+		XMVECTOR negRadius = XMVectorNegate(soa.r[3]);
+		XMVECTOR inside = XMVectorTrueInt();
+
+		for (int p = 0; p < 6; p++)
+		{
+			XMVECTOR dist = XMVectorMultiplyAdd(soa.r[0], planeX[p], planeW[p]);
+			dist = XMVectorMultiplyAdd(soa.r[1], planeY[p], dist);
+			dist = XMVectorMultiplyAdd(soa.r[2], planeZ[p], dist);
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(dist, negRadius));
+		}
+
+		visibleCount += StoreMask(inside, visibleOut + i);
+	}
+
+	// Leftovers that don't fill a group of four
+	visibleCount += CullSpheres(spheres + batchEnd, count - batchEnd, visibleOut + batchEnd);
+
+	return visibleCount;
+}
+
+unsigned int FrustumCuller::CullAABBs(const AABB* boxes, unsigned int count, unsigned char* visibleOut)
+{
+	unsigned int visibleCount = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		visibleOut[i] = IsVisible(boxes[i]) ? 1 : 0;
+		visibleCount += visibleOut[i];
+	}
+
+	return visibleCount;
+}
+
+// --------------------------------------------------------
+// Tests four boxes per iteration, the same way as the spheres
+// but with the radius worked out per plane from the extents
+// and the absolute value of the plane normal.  Boxes are 24
+// bytes, so centers and extents are loaded and transposed
+// separately.
+// --------------------------------------------------------
+unsigned int FrustumCuller::CullAABBsSIMD(const AABB* boxes, unsigned int count, unsigned char* visibleOut)
+{
+	XMVECTOR planeX[6], planeY[6], planeZ[6], planeW[6];
+	SplatPlanes(planes, planeX, planeY, planeZ, planeW);
+
+	XMVECTOR absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; p++)
+	{
+		absX[p] = XMVectorAbs(planeX[p]);
+		absY[p] = XMVectorAbs(planeY[p]);
+		absZ[p] = XMVectorAbs(planeZ[p]);
+	}
+
+	unsigned int visibleCount = 0;
+	unsigned int batchEnd = count & ~3u;
+	for (unsigned int i = 0; i < batchEnd; i += 4)
+	{
+		XMMATRIX centers = XMMatrixTranspose(XMMATRIX(
+			XMLoadFloat3(&boxes[i + 0].Center),
+			XMLoadFloat3(&boxes[i + 1].Center),
+			XMLoadFloat3(&boxes[i + 2].Center),
+			XMLoadFloat3(&boxes[i + 3].Center)));
+		XMMATRIX extents = XMMatrixTranspose(XMMATRIX(
+			XMLoadFloat3(&boxes[i + 0].Extents),
+			XMLoadFloat3(&boxes[i + 1].Extents),
+			XMLoadFloat3(&boxes[i + 2].Extents),
+			XMLoadFloat3(&boxes[i + 3].Extents)));
+
+		XMVECTOR inside = XMVectorTrueInt();
+		for (int p = 0; p < 6; p++)
+		{
+			XMVECTOR dist = XMVectorMultiplyAdd(centers.r[0], planeX[p], planeW[p]);
+			dist = XMVectorMultiplyAdd(centers.r[1], planeY[p], dist);
+			dist = XMVectorMultiplyAdd(centers.r[2], planeZ[p], dist);
+
+			XMVECTOR radius = XMVectorMultiply(extents.r[0], absX[p]);
+			radius = XMVectorMultiplyAdd(extents.r[1], absY[p], radius);
+			radius = XMVectorMultiplyAdd(extents.r[2], absZ[p], radius);
+
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(dist, XMVectorNegate(radius)));
+		}
+
+		visibleCount += StoreMask(inside, visibleOut + i);
+	}
+
+	visibleCount += CullAABBs(boxes + batchEnd, count - batchEnd, visibleOut + batchEnd);
+
+	return visibleCount;
+}
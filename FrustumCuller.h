@@ -0,0 +1,36 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include "Bounds.h"
+
+// --------------------------------------------------------
+// Tests bounding volumes against the six planes of a view
+// frustum.  Only depends on DirectXMath, so it can be driven
+// without a device (or a window) for profiling.
+// --------------------------------------------------------
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+
+	// Extracts the planes from a view and projection matrix
+	void SetFrustum(DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 projection);
+	const DirectX::XMFLOAT4* GetPlanes() { return planes; }
+
+	// Single volume tests
+	bool IsVisible(const Sphere& sphere);
+	bool IsVisible(const AABB& box);
+	bool IsVisible(const OBB& box);
+
+	// Batch tests - writes 1 (visible) or 0 (culled) per volume
+	// into visibleOut and returns the number of visible volumes
+	unsigned int CullSpheres(const Sphere* spheres, unsigned int count, unsigned char* visibleOut);
+	unsigned int CullSpheresSIMD(const Sphere* spheres, unsigned int count, unsigned char* visibleOut);
+	unsigned int CullAABBs(const AABB* boxes, unsigned int count, unsigned char* visibleOut);
+	unsigned int CullAABBsSIMD(const AABB* boxes, unsigned int count, unsigned char* visibleOut);
+
+private:
+	// Left, right, bottom, top, near, far - normals point inward
+	DirectX::XMFLOAT4 planes[6];
+};
@@ -5,6 +5,11 @@
 #include "Vertex.h"
 #include "Input.h"
 #include "TerrainMesh.h"
+#include "AllocationCounter.h"
+#include "ShaderLoader.h"
+#include "FileTimes.h"
+#include "LevelFile.h"
+#include "TransformSystem.h"
 
 #include "ImGUI/imgui.h"
 #include "WICTextureLoader.h"
@@ -15,6 +20,8 @@
 #include "ImGUI/imgui_impl_win32.h"
 #include "ImGUI/imgui_impl_dx11.h"
 #include <iostream>
+#include <psapi.h>
+#include <chrono>
 
 // For the DirectX Math library
 using namespace DirectX;
@@ -25,10 +32,57 @@ using namespace physx;
 
 // Helper macros for making texture and shader loading code more succinct
 #define LoadTexture(file, srv) CreateWICTextureFromFile(device.Get(), context.Get(), GetFullPathTo_Wide(file).c_str(), 0, srv.GetAddressOf())
-#define LoadShader(type, file) new type(device.Get(), context.Get(), GetFullPathTo_Wide(file).c_str())
+#define QueueShader(loader, shader, file) loader.Add(&shader, GetFullPathTo_Wide(file))
 
 #define GET_VARIABLE_NAME(var) (#var)
 
+// Physics always steps at this rate, however fast frames are, and
+// catches up at most this many steps in one frame (anything more
+// is dropped, so a long hitch slows the game down rather than
+// making the next frames take even longer)
+#define PHYSICS_STEP (1.0f / 60.0f)
+#define PHYSICS_MAX_STEPS_PER_FRAME 4
+
+// Loads the binary form of a level when it's up to date, and
+// otherwise parses the text and saves the binary for next time
+static bool LoadLevel(const std::string& textFile, LevelData* level, std::string* error)
+{
+	std::string binaryFile = LevelFile::GetBinaryFileName(textFile);
+	if (FileTimes::IsUpToDate(textFile.c_str(), binaryFile.c_str()) && LevelFile::Load(binaryFile, level, 0))
+		return true;
+
+	if (!LevelFile::Load(textFile, level, error))
+		return false;
+
+	LevelFile::SaveBinary(binaryFile, *level);
+	return true;
+}
+
+// Index of a name in a list, or -1
+static int FindName(const char* names[], int count, const std::string& name)
+{
+	for (int i = 0; i < count; i++)
+		if (name == names[i])
+			return i;
+	return -1;
+}
+
+// Prints the process's current and peak memory, to compare
+// level loads with and without things like CPU mesh copies
+static void LogMemoryUsage(const char* label)
+{
+	PROCESS_MEMORY_COUNTERS_EX counters = {};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters)))
+		return;
+
+	printf("Memory %s: private %.2f MB (peak %.2f MB), working set %.2f MB (peak %.2f MB)\n",
+		label,
+		counters.PrivateUsage / (1024.0 * 1024.0),
+		counters.PeakPagefileUsage / (1024.0 * 1024.0),
+		counters.WorkingSetSize / (1024.0 * 1024.0),
+		counters.PeakWorkingSetSize / (1024.0 * 1024.0));
+}
+
 // --------------------------------------------------------
 // Constructor
 //
@@ -36,8 +90,9 @@ using namespace physx;
 // DirectX itself, and our window, are not ready yet!
 //
 // hInstance - the application's OS-level handle (unique ID)
+// jobWorkers - threads for the job system, besides this one
 // --------------------------------------------------------
-Game::Game(HINSTANCE hInstance)
+Game::Game(HINSTANCE hInstance, unsigned int jobWorkers)
 	: DXCore(
 		hInstance,		   // The application's handle
 		"DirectX Game",	   // Text for the window's title bar
@@ -46,6 +101,12 @@ Game::Game(HINSTANCE hInstance)
 		true)			   // Show extra stats (fps) in title bar?
 {
 	camera = 0;
+	collisionMeshes = 0;
+	physicsAccumulator = 0;
+	physicsStepRunning = false;
+	physicsStepsLastFrame = 0;
+	physicsBlockedMilliseconds = 0;
+	jobs = new JobSystem(jobWorkers);
 
 	// Seed random
 	srand((unsigned int)time(0));
@@ -95,11 +156,18 @@ Game::~Game()
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
 
-	// PhysX
+	// PhysX - nothing can be released mid step, and the cooked
+	// meshes go before the physics that made them
+	if (physicsStepRunning)
+		mScene->fetchResults(true);
+	delete collisionMeshes;
 	mPhysics->release();
-	mDispatcher->release();
-	mFoundation->release();
+	delete mDispatcher;
 	mCooking->release();
+	mFoundation->release();
+
+	// Last, as PhysX and the renderer both use it
+	delete jobs;
 }
 
 // --------------------------------------------------------
@@ -129,6 +197,11 @@ void Game::Init()
 	camera = thirdPCamera->GetCamera();
 
 	interval = 0.005;
+	sortBenchmarkMilliseconds[0] = 0;
+	sortBenchmarkMilliseconds[1] = 0;
+	sortBenchmarkMilliseconds[2] = 0;
+	for (int i = 0; i < 4; i++)
+		transformBenchmarkMilliseconds[i] = 0;
 
 	// Initialize ImGui
 	IMGUI_CHECKVERSION();
@@ -145,7 +218,26 @@ void Game::Init()
 
 	// PhysX
 	InitializePhysX();
+	auto physicsStart = std::chrono::high_resolution_clock::now();
 	CreatePhysXActors();
+	auto physicsEnd = std::chrono::high_resolution_clock::now();
+	printf("Created %d level blocks in %.2f ms: %u meshes cooked, %u loaded from disk, %u shared\n",
+		(int)levelBlocks.size(),
+		std::chrono::duration<float, std::milli>(physicsEnd - physicsStart).count(),
+		collisionMeshes->GetCookCount(),
+		collisionMeshes->GetDiskLoadCount(),
+		collisionMeshes->GetSharedCount());
+	LogMemoryUsage("after loading the level");
+
+	// Collision is cooked, so the CPU copies of the geometry
+	// aren't needed by anything anymore
+	size_t releasedBytes = 0;
+	for (auto mesh : meshes) {
+		releasedBytes += mesh->GetCPUGeometryBytes();
+		mesh->ReleaseCPUGeometry();
+	}
+	printf("Released %.2f KB of CPU mesh geometry\n", releasedBytes / 1024.0);
+	LogMemoryUsage("after releasing CPU geometry");
 }
 
 
@@ -154,26 +246,51 @@ void Game::Init()
 // --------------------------------------------------------
 void Game::LoadAssetsAndCreateEntities()
 {
-	// Load shaders using our succinct LoadShader() macro
-	SimpleVertexShader* vertexShader	= LoadShader(SimpleVertexShader, L"VertexShader.cso");
-	pixelShader							= LoadShader(SimplePixelShader, L"PixelShader.cso");
-	pixelShaderPBR						= LoadShader(SimplePixelShader, L"PixelShaderPBR.cso");
-	SimplePixelShader* solidColorPS		= LoadShader(SimplePixelShader, L"SolidColorPS.cso");
-	SimplePixelShader* simpleTexturePS  = LoadShader(SimplePixelShader, L"SimpleTexturePS.cso");
-	SimplePixelShader* refractionPS     = LoadShader(SimplePixelShader, L"RefractionPS.cso");
-	
-	SimpleVertexShader* skyVS = LoadShader(SimpleVertexShader, L"SkyVS.cso");
-	SimplePixelShader* skyPS  = LoadShader(SimplePixelShader, L"SkyPS.cso");
-
-	SimpleVertexShader* fullscreenVS = LoadShader(SimpleVertexShader, L"FullscreenVS.cso");
-	SimplePixelShader* irradianceMapPS = LoadShader(SimplePixelShader, L"IBLIrradianceMapPS.cso");
-	SimplePixelShader* specularConvolutionPS = LoadShader(SimplePixelShader, L"IBLSpecularConvolutionPS.cso");
-	SimplePixelShader* lookUpTablePS = LoadShader(SimplePixelShader, L"IBLBrdfLookUpTablePS.cso");
-
-	SimpleVertexShader* particleVS = LoadShader(SimpleVertexShader, L"ParticleVS.cso");
-	SimplePixelShader* particlePS = LoadShader(SimplePixelShader, L"ParticlePS.cso");
+	// Queue up every shader and load them all in parallel
+	SimpleVertexShader* vertexShader = 0;
+	SimpleVertexShader* instancedVS = 0;
+	SimplePixelShader* solidColorPS = 0;
+	SimplePixelShader* simpleTexturePS = 0;
+	SimplePixelShader* refractionPS = 0;
+	SimpleVertexShader* skyVS = 0;
+	SimplePixelShader* skyPS = 0;
+	SimpleVertexShader* fullscreenVS = 0;
+	SimplePixelShader* irradianceMapPS = 0;
+	SimplePixelShader* specularConvolutionPS = 0;
+	SimplePixelShader* lookUpTablePS = 0;
+	SimpleVertexShader* particleVS = 0;
+	SimplePixelShader* particlePS = 0;
+	SimplePixelShader* terrainPS = 0;
+	SimpleVertexShader* terrainVS = 0;
+
+	ShaderLoader shaderLoader(device, context);
+	QueueShader(shaderLoader, vertexShader, L"VertexShader.cso");
+	QueueShader(shaderLoader, instancedVS, L"VertexShaderInstanced.cso");
+	QueueShader(shaderLoader, pixelShader, L"PixelShader.cso");
+	QueueShader(shaderLoader, pixelShaderPBR, L"PixelShaderPBR.cso");
+	QueueShader(shaderLoader, solidColorPS, L"SolidColorPS.cso");
+	QueueShader(shaderLoader, simpleTexturePS, L"SimpleTexturePS.cso");
+	QueueShader(shaderLoader, refractionPS, L"RefractionPS.cso");
+
+	QueueShader(shaderLoader, skyVS, L"SkyVS.cso");
+	QueueShader(shaderLoader, skyPS, L"SkyPS.cso");
+
+	QueueShader(shaderLoader, fullscreenVS, L"FullscreenVS.cso");
+	QueueShader(shaderLoader, irradianceMapPS, L"IBLIrradianceMapPS.cso");
+	QueueShader(shaderLoader, specularConvolutionPS, L"IBLSpecularConvolutionPS.cso");
+	QueueShader(shaderLoader, lookUpTablePS, L"IBLBrdfLookUpTablePS.cso");
+
+	QueueShader(shaderLoader, particleVS, L"ParticleVS.cso");
+	QueueShader(shaderLoader, particlePS, L"ParticlePS.cso");
+
+	QueueShader(shaderLoader, terrainPS, L"TerrainPS.cso");
+	QueueShader(shaderLoader, terrainVS, L"TerrainVSCompact.cso");
+
+	shaderLoader.Wait();
+	shaderLoader.LogTimeline();
 
 	shaders.push_back(vertexShader);
+	shaders.push_back(instancedVS);
 	shaders.push_back(pixelShader);
 	shaders.push_back(pixelShaderPBR);
 	shaders.push_back(solidColorPS);
@@ -281,9 +398,6 @@ void Game::LoadAssetsAndCreateEntities()
 	GameEntity* marbleEntity = new GameEntity(sphereMesh, marbleMat);
 	entities.push_back(marbleEntity);
 
-	SimplePixelShader* terrainPS = LoadShader(SimplePixelShader, L"TerrainPS.cso");
-	SimpleVertexShader* terrainVS = LoadShader(SimpleVertexShader, L"TerrainVS.cso");
-
 	shaders.push_back(terrainPS);
 	shaders.push_back(terrainVS);
 
@@ -295,7 +409,8 @@ void Game::LoadAssetsAndCreateEntities()
 		BitDepth_16,
 		5.0f,
 		0.05f,
-		1.0f);
+		1.0f,
+		MESH_VERTEX_COMPACT);
 
 	meshes.push_back(terrainMesh);
 
@@ -383,6 +498,8 @@ void Game::LoadAssetsAndCreateEntities()
 		simpleTexturePS,
 		refractionPS
 	);
+	renderer->SetJobSystem(jobs);
+	renderer->SetInstancedVS(vertexShader, instancedVS);
 }
 
 void Game::InitializePhysX()
@@ -396,10 +513,11 @@ void Game::InitializePhysX()
 
 	mCooking = PxCreateCooking(PX_PHYSICS_VERSION, *mFoundation, PxCookingParams(mToleranceScale));
 	if (!mCooking) throw("PxCreateCooking failed!");
+	collisionMeshes = new CollisionMeshCache(mPhysics, mCooking);
 
 	PxSceneDesc sceneDesc(mPhysics->getTolerancesScale());
 	sceneDesc.gravity = PxVec3(0.0f, -3.62f, 0.0f);
-	mDispatcher = PxDefaultCpuDispatcherCreate(2);
+	mDispatcher = new PhysXDispatcher(jobs);
 	sceneDesc.cpuDispatcher = mDispatcher;
 	sceneDesc.filterShader = PxDefaultSimulationFilterShader;
 	sceneDesc.flags |= PxSceneFlag::eENABLE_ACTIVE_ACTORS;
@@ -412,308 +530,66 @@ void Game::InitializePhysX()
 
 void Game::CreatePhysXActors()
 {
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[1],
-			12,
-			materials[0],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(6, 4, 6),
-			PxVec3(0, 25.5f, 0),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[1],
-			12,
-			materials[0],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(6, 30, 18),
-			PxVec3(-6, 12.5f, 12),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[1],
-			12,
-			materials[0],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(12, 30, 6),
-			PxVec3(9, 12.5f, -6),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[1],
-			12,
-			materials[0],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(6, 26, 6),
-			PxVec3(18, 10.5f, -6),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[1],
-			12,
-			materials[0],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(24, 26, 12),
-			PxVec3(9, 10.5, 3),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[1],
-			12,
-			materials[0],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(4, 26, 12),
-			PxVec3(-1, 10.5, 15),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[1],
-			12,
-			materials[0],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(2, 26, 6),
-			PxVec3(2, 10.5, 18),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[1],
-			12,
-			materials[0],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(8, 22, 6),
-			PxVec3(5, 8.5, 12),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[1],
-			12,
-			materials[0],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(10, 20, 6),
-			PxVec3(8, 7.5, 18),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[1],
-			12,
-			materials[0],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(8, 18, 6),
-			PxVec3(17, 6.5, 18),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[1],
-			12,
-			materials[0],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(6, 18, 6),
-			PxVec3(18, 6.5, 12),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[1],
-			12,
-			materials[0],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(4, 16, 6),
-			PxVec3(23, 5.5, 18),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[1],
-			12,
-			materials[0],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(6, 14, 6),
-			PxVec3(28, 4.5, 18),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[1],
-			12,
-			materials[0],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(6, 12, 6),
-			PxVec3(28, 3.5, 24),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[2],
-			8,
-			materials[1],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(4, 4, 6),
-			PxVec3(5, 25.5f, 0),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[2],
-			8,
-			materials[1],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(4, 4, 6),
-			PxVec3(0, 25.5f, 5),
-			-1.575f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[2],
-			8,
-			materials[1],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(6, 4, 6),
-			PxVec3(18, 25.5f, -6),
-			-1.575f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[2],
-			8,
-			materials[1],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(6, 8, 6),
-			PxVec3(18, 19.5f, 12),
-			-1.575f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[2],
-			8,
-			materials[1],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(4, 4, 6),
-			PxVec3(3, 21.5f, 12),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[2],
-			8,
-			materials[1],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(2, 2, 4),
-			PxVec3(7, 18.5f, 16),
-			-1.575f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[2],
-			8,
-			materials[1],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(2, 2, 6),
-			PxVec3(14, 16.5f, 18),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[2],
-			8,
-			materials[1],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(2, 2, 6),
-			PxVec3(22, 14.5f, 18),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[2],
-			8,
-			materials[1],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(2, 2, 6),
-			PxVec3(26, 12.5f, 18),
-			0.0f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[2],
-			8,
-			materials[1],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(2, 2, 6),
-			PxVec3(28, 10.5f, 22),
-			-1.575f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[2],
-			8,
-			materials[1],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(2, 2, 6),
-			PxVec3(28, 10.5f, 26),
-			1.575f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[2],
-			8,
-			materials[1],
-			mMaterial,
-			mCooking,
-			mPhysics,
-			PxVec3(2, 2, 6),
-			PxVec3(30, 10.5f, 24),
-			3.15f));
-
-	levelBlocks.push_back(
-		new CollisionMesh(meshes[2],
-			8,
-			materials[1],
+	LevelData level;
+	std::string error;
+	if (!LoadLevel(GetFullPathTo("../../Assets/Levels/Level1.level"), &level, &error))
+		printf("Couldn't load the level: %s\n", error.c_str());
+
+	// The level names meshes by model and materials by look,
+	// which resolve to the game's own lists here
+	const char* meshNames[] = { "sphere", "cube", "ramp" };
+	const char* materialNames[] = { "floor", "rough", "metal" };
+
+	std::vector<Mesh*> levelMeshes(level.MeshNames.size(), 0);
+	for (size_t i = 0; i < level.MeshNames.size(); i++) {
+		int found = FindName(meshNames, IM_ARRAYSIZE(meshNames), level.MeshNames[i]);
+		if (found >= 0) levelMeshes[i] = meshes[found];
+		else printf("Level uses unknown mesh \"%s\"\n", level.MeshNames[i].c_str());
+	}
+
+	std::vector<Material*> levelMaterials(level.MaterialNames.size(), 0);
+	for (size_t i = 0; i < level.MaterialNames.size(); i++) {
+		int found = FindName(materialNames, IM_ARRAYSIZE(materialNames), level.MaterialNames[i]);
+		if (found >= 0) levelMaterials[i] = materials[found];
+		else printf("Level uses unknown material \"%s\"\n", level.MaterialNames[i].c_str());
+	}
+
+	// Everything grows once up front, and all of the actors go
+	// into the scene in a single call at the end
+	levelBlocks.reserve(levelBlocks.size() + level.Blocks.size());
+	entities.reserve(entities.size() + level.Blocks.size());
+	std::vector<PxActor*> actors;
+	actors.reserve(level.Blocks.size());
+
+	for (auto& block : level.Blocks) {
+		Mesh* mesh = levelMeshes[block.Mesh];
+		Material* material = levelMaterials[block.Material];
+		if (!mesh || !material)
+			continue;
+
+		CollisionMesh* levelBlock = new CollisionMesh(mesh,
+			material,
 			mMaterial,
-			mCooking,
+			collisionMeshes,
 			mPhysics,
-			PxVec3(2, 2, 6),
-			PxVec3(26, 10.5f, 24),
-			0.0f));
-
-	for (int i = 0; i < levelBlocks.size(); i++) {
-		mScene->addActor(*levelBlocks[i]->GetBody());
-		entities.push_back(levelBlocks[i]->GetEntity());
+			PxVec3(block.Scale[0], block.Scale[1], block.Scale[2]),
+			PxVec3(block.Position[0], block.Position[1], block.Position[2]),
+			block.Rotation,
+			block.Flags);
+		levelBlocks.push_back(levelBlock);
+
+		if (levelBlock->GetBody())
+			actors.push_back(levelBlock->GetBody());
+
+		if (levelBlock->GetEntity()) {
+			entities.push_back(levelBlock->GetEntity());
+			renderer->AddEntity(levelBlock->GetEntity());
+		}
 	}
 
+	if (!actors.empty())
+		mScene->addActors(&actors[0], (PxU32)actors.size());
+
 	marble = new Marble(mPhysics, mScene, mMaterial, entities[0]);
 }
 
@@ -797,9 +673,23 @@ void Game::OnResize()
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
+	// Nothing may touch the scene while it simulates, so the step
+	// left running last frame finishes before anything else
+	physicsBlockedMilliseconds = 0;
+	FinishPhysicsStep();
+
 	// get input
 	Input& input = Input::GetInstance();
 
+	// Check individual input
+	if (input.KeyDown(VK_ESCAPE)) Quit();
+	if (input.KeyPress(VK_TAB)) GenerateLights();
+
+	// PhysX - starts as soon as input is in, so it runs alongside
+	// the rest of the update and the frame's rendering
+	StepPhysics(deltaTime, input);
+	marble->UpdateEntity(physicsAccumulator / PHYSICS_STEP);
+
 	//update the GUI
 	UpdateGUI(deltaTime, input);
 
@@ -810,19 +700,59 @@ void Game::Update(float deltaTime, float totalTime)
 	for (auto& e : emitters)
 		e->Update(deltaTime, totalTime);
 
-	// Check individual input
-	if (input.KeyDown(VK_ESCAPE)) Quit();
-	if (input.KeyPress(VK_TAB)) GenerateLights();
+	// Everything that moved this frame gets its matrices rebuilt
+	// in one go, ahead of culling and drawing
+	TransformSystem::GetInstance().UpdateDirty();
+}
 
-	// PhysX
-	marble->Move(input, deltaTime, thirdPCamera->GetForwardVector(), thirdPCamera->GetRightVector());
+// --------------------------------------------------------
+// Runs however many fixed steps the frame's time covers.  All
+// but the last finish right away, and the last is left running
+// for FinishPhysicsStep to collect.  The marble's poses are
+// recorded as each step starts, at the same moment the step
+// comes off the accumulator, so the two always move together
+// and the marble is drawn exactly two steps behind the time
+// simulated so far - a step running in the background makes
+// no difference to where it appears.
+// --------------------------------------------------------
+void Game::StepPhysics(float deltaTime, Input& input)
+{
+	physicsAccumulator += deltaTime;
+	if (physicsAccumulator > PHYSICS_STEP * PHYSICS_MAX_STEPS_PER_FRAME)
+		physicsAccumulator = PHYSICS_STEP * PHYSICS_MAX_STEPS_PER_FRAME;
+
+	physicsStepsLastFrame = 0;
+	while (physicsAccumulator >= PHYSICS_STEP) {
+		FinishPhysicsStep();
+
+		// forces are cleared after every step, so push every step
+		marble->Move(input, PHYSICS_STEP, thirdPCamera->GetForwardVector(), thirdPCamera->GetRightVector());
+		marble->RecordPose();
+		mScene->simulate(PHYSICS_STEP);
+		physicsStepRunning = true;
+
+		physicsAccumulator -= PHYSICS_STEP;
+		physicsStepsLastFrame++;
+	}
+}
 
-	mScene->simulate(1.0f/60.0f);
-	mScene->fetchResults(true); 
+// --------------------------------------------------------
+// Waits for the running step, if there is one, adding how long
+// the main thread was stuck waiting to the frame's total, then
+// applies its results
+// --------------------------------------------------------
+void Game::FinishPhysicsStep()
+{
+	if (!physicsStepRunning)
+		return;
 
-	marble->ResetPosition();
+	auto start = std::chrono::high_resolution_clock::now();
+	mScene->fetchResults(true);
+	auto end = std::chrono::high_resolution_clock::now();
+	physicsBlockedMilliseconds += std::chrono::duration<float, std::milli>(end - start).count();
+	physicsStepRunning = false;
 
-	marble->UpdateEntity();
+	marble->ResetPosition();
 }
 
 // --------------------------------------------------------
@@ -885,6 +815,59 @@ void Game::UpdateStatsWindow(int framerate)
 	if (ImGui::CollapsingHeader("Scene Properties")) {
 		ImGui::Text(ConcatStringAndInt("Number of Entities: ", entities.size()).c_str());
 		ImGui::Text(ConcatStringAndInt("Number of Lights: ", lightCount).c_str());
+		ImGui::Text(ConcatStringAndInt("Number of Transforms: ", TransformSystem::GetInstance().GetCount()).c_str());
+		ImGui::Text(ConcatStringAndInt("Transforms Updated: ", TransformSystem::GetInstance().GetLastUpdateCount()).c_str());
+
+		// Times rebuilding every matrix in one batch against one
+		// at a time in scattered order, at two scene sizes
+		if (ImGui::Button("Benchmark Transforms")) {
+			transformBenchmarkMilliseconds[0] = TransformSystem::Benchmark(10000, 20, true);
+			transformBenchmarkMilliseconds[1] = TransformSystem::Benchmark(10000, 20, false);
+			transformBenchmarkMilliseconds[2] = TransformSystem::Benchmark(100000, 5, true);
+			transformBenchmarkMilliseconds[3] = TransformSystem::Benchmark(100000, 5, false);
+		}
+		ImGui::Text(ConcatStringAndFloat("10k Batched (ms): ", transformBenchmarkMilliseconds[0]).c_str());
+		ImGui::Text(ConcatStringAndFloat("10k One At A Time (ms): ", transformBenchmarkMilliseconds[1]).c_str());
+		ImGui::Text(ConcatStringAndFloat("100k Batched (ms): ", transformBenchmarkMilliseconds[2]).c_str());
+		ImGui::Text(ConcatStringAndFloat("100k One At A Time (ms): ", transformBenchmarkMilliseconds[3]).c_str());
+	}
+
+	if (ImGui::CollapsingHeader("Physics Stats")) {
+		ImGui::Text(ConcatStringAndInt("Job Workers: ", jobs->GetWorkerCount()).c_str());
+		ImGui::Text(ConcatStringAndInt("Steps This Frame: ", physicsStepsLastFrame).c_str());
+		ImGui::Text(ConcatStringAndFloat("Blocked On PhysX (ms): ", physicsBlockedMilliseconds).c_str());
+		ImGui::Text(ConcatStringAndFloat("Step Time Left Over: ", physicsAccumulator / PHYSICS_STEP).c_str());
+	}
+
+	if (ImGui::CollapsingHeader("Render Stats")) {
+		const RenderStats& stats = renderer->GetStats();
+		ImGui::Text(ConcatStringAndInt("Visible Entities: ", stats.EntitiesVisible).c_str());
+		ImGui::Text(ConcatStringAndInt("Culled Entities: ", stats.EntitiesCulled).c_str());
+		ImGui::Text(ConcatStringAndFloat("Cull Time (ms): ", stats.CullMilliseconds).c_str());
+		ImGui::Text(ConcatStringAndInt("Entity Draw Calls: ", stats.DrawCalls).c_str());
+		ImGui::Text(ConcatStringAndInt("Instanced Groups: ", stats.InstancedGroups).c_str());
+		ImGui::Text(ConcatStringAndInt("Draw Calls Saved: ", stats.DrawCallsSaved).c_str());
+		ImGui::Text(ConcatStringAndInt("Ring Buffer Draws: ", stats.RingSlices).c_str());
+		ImGui::Text(ConcatStringAndInt("Constant Bytes Uploaded: ", stats.ConstantBytesUploaded).c_str());
+		ImGui::Text(ConcatStringAndInt("Constant Uploads Skipped: ", stats.ConstantUploadsSkipped).c_str());
+		ImGui::Text(ConcatStringAndInt("Bind Calls Issued: ", stats.BindCallsIssued).c_str());
+		ImGui::Text(ConcatStringAndInt("Bind Calls Filtered: ", stats.BindCallsFiltered).c_str());
+
+		// Heap allocations are only counted in debug builds
+		if (AllocationCounter::IsInstalled()) {
+			ImGui::Text(ConcatStringAndInt("Draw List Allocations: ", stats.DrawListAllocations).c_str());
+			ImGui::Text(ConcatStringAndInt("Frame Allocations: ", stats.FrameAllocations).c_str());
+		}
+
+		// Times the draw key sort on its own at a few scene sizes
+		if (ImGui::Button("Benchmark Draw Sort")) {
+			sortBenchmarkMilliseconds[0] = DrawSorter::Benchmark(1000, 100);
+			sortBenchmarkMilliseconds[1] = DrawSorter::Benchmark(10000, 20);
+			sortBenchmarkMilliseconds[2] = DrawSorter::Benchmark(100000, 5);
+		}
+		ImGui::Text(ConcatStringAndFloat("Sort 1k Draws (ms): ", sortBenchmarkMilliseconds[0]).c_str());
+		ImGui::Text(ConcatStringAndFloat("Sort 10k Draws (ms): ", sortBenchmarkMilliseconds[1]).c_str());
+		ImGui::Text(ConcatStringAndFloat("Sort 100k Draws (ms): ", sortBenchmarkMilliseconds[2]).c_str());
 	}
 
 	ImGui::End();
@@ -898,7 +881,9 @@ void Game::UpdateSceneWindow()
 		// number of entities
 		ImGui::Text(ConcatStringAndInt("Number of Entities: ", entities.size()).c_str());
 
-		const char* meshTitles[] = { "Sphere", "Cube", "Ramp", "Terrain" };
+		// the terrain isn't offered, as its compact vertices
+		// only work with the terrain's own shader
+		const char* meshTitles[] = { "Sphere", "Cube", "Ramp" };
 
 		const char* materialTitles[] = {
 			"Floor",
@@ -909,7 +894,7 @@ void Game::UpdateSceneWindow()
 		// specific entity headers
 		for (int i = 0; i < entities.size(); i++)
 		{
-			GenerateEntitiesHeader(i, meshTitles, materialTitles);
+			GenerateEntitiesHeader(i, meshTitles, IM_ARRAYSIZE(meshTitles), materialTitles);
 		}
 	}
 
@@ -963,12 +948,12 @@ void Game::UpdateSceneWindow()
 	ImGui::End();
 }
 
-void Game::GenerateEntitiesHeader(int i, const char* meshTitles[], const char* materialTitles[])
+void Game::GenerateEntitiesHeader(int i, const char* meshTitles[], int meshCount, const char* materialTitles[])
 {
 	if (ImGui::CollapsingHeader(ConcatStringAndInt("Entity ", i + 1).c_str())) {
 		// change mesh
 		int currentMesh = FindIndex(meshes, entities[i]->GetMesh());
-		ImGui::Combo(ConcatStringAndInt("Mesh##E", i).c_str(), &currentMesh, meshTitles, meshes.size());
+		ImGui::Combo(ConcatStringAndInt("Mesh##E", i).c_str(), &currentMesh, meshTitles, meshCount);
 		entities[i]->SetMesh(meshes[currentMesh]);
 
 		// change materials
@@ -984,8 +969,11 @@ void Game::GenerateEntitiesHeader(int i, const char* meshTitles[], const char* m
 		entities[i]->GetTransform()->SetPosition(pos.x, pos.y, pos.z);
 
 		XMFLOAT3 rot = entities[i]->GetTransform()->GetPitchYawRoll();
-		ImGui::SliderFloat3(ConcatStringAndInt("Rotation##E", i).c_str(), &rot.x, 0.0f, 6.28319f);
-		entities[i]->GetTransform()->SetRotation(rot.x, rot.y, rot.z);
+		// only written back when edited, as rotations are stored as
+		// quaternions and going through angles every frame would
+		// fight anything else rotating the entity
+		if (ImGui::SliderFloat3(ConcatStringAndInt("Rotation##E", i).c_str(), &rot.x, 0.0f, 6.28319f))
+			entities[i]->GetTransform()->SetRotation(rot.x, rot.y, rot.z);
 
 		XMFLOAT3 scale = entities[i]->GetTransform()->GetScale();
 		ImGui::InputFloat3(ConcatStringAndInt("Scale##E", i).c_str(), &scale.x);
@@ -1053,8 +1041,8 @@ void Game::GenerateCameraHeader()
 
 		// set rotation
 		XMFLOAT3 rot = camera->GetTransform()->GetPitchYawRoll();
-		ImGui::SliderFloat2("Rotation##C", &rot.x, 0.0f, 6.28319f);
-		camera->GetTransform()->SetRotation(rot.x, rot.y, rot.z);
+		if (ImGui::SliderFloat2("Rotation##C", &rot.x, 0.0f, 6.28319f))
+			camera->GetTransform()->SetRotation(rot.x, rot.y, rot.z);
 
 		// show directional vectors
 		XMFLOAT2 forward = thirdPCamera->GetForwardVector();
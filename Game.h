@@ -15,6 +15,9 @@
 #include "Marble.h"
 #include "TerrainEntity.h"
 #include "CollisionMesh.h"
+#include "CollisionMeshCache.h"
+#include "JobSystem.h"
+#include "PhysXDispatcher.h"
 #include "Emitter.h"
 #include <PxPhysics.h>
 #include <PxPhysicsAPI.h>
@@ -28,7 +31,9 @@ class Game
 {
 
 public:
-	Game(HINSTANCE hInstance);
+	// jobWorkers is the worker thread count for the job system
+	// everything (including PhysX) shares
+	Game(HINSTANCE hInstance, unsigned int jobWorkers = JobSystem::DefaultWorkerCount());
 	~Game();
 
 	// Overridden setup and game loop methods, which
@@ -63,6 +68,8 @@ private:
 
 	Marble* marble;
 
+	JobSystem* jobs;
+
 	// Lights
 	std::vector<Light> lights;
 	int lightCount;
@@ -102,12 +109,19 @@ private:
 
 	float interval;
 
+	// Results of the last draw sort benchmark (1k, 10k, 100k draws)
+	float sortBenchmarkMilliseconds[3];
+
+	// Results of the last transform benchmark (10k and 100k
+	// transforms, batched then one at a time)
+	float transformBenchmarkMilliseconds[4];
+
 	// General helpers for setup and drawing
 	void GenerateLights();
 	void UpdateGUI(float dt, Input& input);
 	void UpdateStatsWindow(int framerate);
 	void UpdateSceneWindow();
-	void GenerateEntitiesHeader(int i, const char* meshTitles[], const char* materialTitles[]);
+	void GenerateEntitiesHeader(int i, const char* meshTitles[], int meshCount, const char* materialTitles[]);
 	void GenerateLightsHeader(int i);
 	void GenerateCameraHeader();
 	void GenerateMaterialsHeader(int i, const char* textureTitles[]);
@@ -129,15 +143,26 @@ private:
 	// PhysX stuff
 	physx::PxDefaultAllocator mDefaultAllocatorCallback;
 	physx::PxDefaultErrorCallback mDefaultErrorCallback;
-	physx::PxDefaultCpuDispatcher* mDispatcher;
+	PhysXDispatcher* mDispatcher;
 	physx::PxTolerancesScale mToleranceScale;
 	physx::PxFoundation* mFoundation;
 	physx::PxCooking* mCooking;
 	physx::PxPhysics* mPhysics;
+	CollisionMeshCache* collisionMeshes;
 
 	physx::PxScene* mScene;
 	physx::PxMaterial* mMaterial;
 
+	// Fixed timestep - real time piles up in the accumulator and is
+	// used up a step at a time.  The last step of each frame is left
+	// running while the frame renders, and fetched next update.
+	void StepPhysics(float deltaTime, Input& input);
+	void FinishPhysicsStep();
+	float physicsAccumulator;
+	bool physicsStepRunning;
+	int physicsStepsLastFrame;
+	float physicsBlockedMilliseconds;
+
 	std::vector<CollisionMesh*> levelBlocks;
 };
 
@@ -7,20 +7,98 @@ GameEntity::GameEntity(Mesh* mesh, Material* material)
 	// Save the data
 	this->mesh = mesh;
 	this->material = material;
+	this->listener = 0;
 }
 
 Mesh* GameEntity::GetMesh() { return mesh; }
 Material* GameEntity::GetMaterial() { return material; }
 Transform* GameEntity::GetTransform() { return &transform; }
 
-void GameEntity::SetMesh(Mesh* mesh) { this->mesh = mesh; }
-void GameEntity::SetMaterial(Material* material) { this->material = material; }
+Material* GameEntity::GetSubmeshMaterial(unsigned int submesh)
+{
+	unsigned int slot = mesh->GetSubmesh(submesh).MaterialIndex;
+	if (slot < slotMaterials.size() && slotMaterials[slot])
+		return slotMaterials[slot];
+	return material;
+}
+
+void GameEntity::SetListener(IGameEntityListener* listener) { this->listener = listener; }
+
+// The GUI sets these every frame, so only notify on an actual change
+void GameEntity::SetMesh(Mesh* mesh)
+{
+	if (this->mesh == mesh)
+		return;
+
+	this->mesh = mesh;
+	if (listener) listener->OnDrawStateChanged(this);
+}
+
+void GameEntity::SetMaterial(Material* material)
+{
+	if (this->material == material)
+		return;
+
+	this->material = material;
+	if (listener) listener->OnDrawStateChanged(this);
+}
+
+void GameEntity::SetMaterial(unsigned int slot, Material* material)
+{
+	if (slot >= slotMaterials.size())
+		slotMaterials.resize(slot + 1, 0);
+
+	if (slotMaterials[slot] == material)
+		return;
+
+	slotMaterials[slot] = material;
+	if (listener) listener->OnDrawStateChanged(this);
+}
+
+AABB GameEntity::GetWorldAABB()
+{
+	AABB local = mesh->GetLocalAABB();
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+	XMMATRIX wm = XMLoadFloat4x4(&world);
+
+	// Transform the center, then project the extents onto the
+	// world axes using the absolute value of each basis vector
+	XMVECTOR extents = XMLoadFloat3(&local.Extents);
+	XMVECTOR worldExtents =
+		XMVectorAbs(wm.r[0]) * XMVectorSplatX(extents) +
+		XMVectorAbs(wm.r[1]) * XMVectorSplatY(extents) +
+		XMVectorAbs(wm.r[2]) * XMVectorSplatZ(extents);
+
+	AABB result;
+	XMStoreFloat3(&result.Center, XMVector3TransformCoord(XMLoadFloat3(&local.Center), wm));
+	XMStoreFloat3(&result.Extents, worldExtents);
+	return result;
+}
+
+Sphere GameEntity::GetWorldSphere()
+{
+	Sphere local = mesh->GetLocalSphere();
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+	XMMATRIX wm = XMLoadFloat4x4(&world);
+
+	// Largest axis scale keeps the sphere conservative under non-uniform scale
+	float maxScaleSq = XMVectorGetX(XMVectorMax(
+		XMVector3LengthSq(wm.r[0]),
+		XMVectorMax(XMVector3LengthSq(wm.r[1]), XMVector3LengthSq(wm.r[2]))));
+
+	Sphere result;
+	XMStoreFloat3(&result.Center, XMVector3TransformCoord(XMLoadFloat3(&local.Center), wm));
+	result.Radius = local.Radius * sqrtf(maxScaleSq);
+	return result;
+}
 
 void GameEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Camera* camera)
 {
-	// Tell the material to prepare for a draw
-	material->PrepareMaterial(&transform, camera);
+	mesh->SetBuffers(context);
 
-	// Draw the mesh
-	mesh->SetBuffersAndDraw(context);
+	// Prepare each submesh's material and draw it
+	for (unsigned int i = 0; i < mesh->GetSubmeshCount(); i++) {
+		GetSubmeshMaterial(i)->PrepareMaterial(&transform, camera);
+		mesh->DrawSubmesh(context, i);
+	}
 }
@@ -8,6 +8,19 @@
 #include "Camera.h"
 #include "SimpleShader.h"
 
+class GameEntity;
+
+// --------------------------------------------------------
+// Told when an entity's mesh or material changes, so anything
+// that caches draw state (like the renderer's draw list) can
+// update instead of rebuilding every frame
+// --------------------------------------------------------
+class IGameEntityListener
+{
+public:
+	virtual void OnDrawStateChanged(GameEntity* entity) = 0;
+};
+
 class GameEntity
 {
 public:
@@ -17,8 +30,18 @@ public:
 	Material* GetMaterial();
 	Transform* GetTransform();
 
+	// The material a submesh draws with - its slot's material if
+	// one has been set, otherwise the entity's main material
+	Material* GetSubmeshMaterial(unsigned int submesh);
+
 	void SetMesh(Mesh* mesh);
 	void SetMaterial(Material* material);
+	void SetMaterial(unsigned int slot, Material* material);
+	void SetListener(IGameEntityListener* listener);
+
+	// Mesh bounds moved into world space by this entity's transform
+	AABB GetWorldAABB();
+	Sphere GetWorldSphere();
 
 	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Camera* camera);
 
@@ -26,6 +49,9 @@ private:
 
 	Mesh* mesh;
 	Material* material;
+	std::vector<Material*> slotMaterials;
 	Transform transform;
+
+	IGameEntityListener* listener;
 };
 
@@ -0,0 +1,176 @@
+#include "GeometryBenchmark.h"
+#include "FrustumCuller.h"
+#include "Intersection.h"
+
+#include <DirectXMath.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace DirectX;
+
+// Rays cast per iteration at the boxes and at the mesh
+#define BENCHMARK_RAY_COUNT 64
+
+// Triangles on each side of the grid mesh is twice this
+#define BENCHMARK_GRID_SIZE 64
+
+static float Random(float low, float high)
+{
+	return low + (high - low) * rand() / (float)RAND_MAX;
+}
+
+// Milliseconds per call of a test, run iterations times
+template <typename TestFunction>
+static float Time(unsigned int iterations, TestFunction test)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned int it = 0; it < iterations; it++)
+		test();
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<float, std::milli>(end - start).count() / iterations;
+}
+
+static unsigned int CountDifferences(const unsigned char* a, const unsigned char* b, unsigned int count)
+{
+	unsigned int differences = 0;
+	for (unsigned int i = 0; i < count; i++)
+		differences += a[i] != b[i] ? 1 : 0;
+	return differences;
+}
+
+// A batch time of 0 is a test with no 4-wide version
+static void PrintRow(const char* name, float single, float batch, unsigned int hits, unsigned int differences)
+{
+	if (batch == 0) {
+		printf("  %-14s %8.3f ms  %11s   %7s  %6u hits\n", name, single, "-", "", hits);
+		return;
+	}
+
+	printf("  %-14s %8.3f ms  %8.3f ms   (%.2fx)  %6u hits  %u differ\n",
+		name,
+		single,
+		batch,
+		batch > 0 ? single / batch : 0.0f,
+		hits,
+		differences);
+}
+
+bool GeometryBenchmark::Run(unsigned int volumeCount, unsigned int iterations)
+{
+	// A camera at the origin looking down +Z, with volumes spread
+	// all around it so roughly a tenth of them end up visible
+	XMFLOAT4X4 view, projection;
+	XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0)));
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.01f, 100.0f));
+	FrustumCuller frustum;
+	frustum.SetFrustum(view, projection);
+
+	srand(0);
+	std::vector<Sphere> spheres(volumeCount);
+	std::vector<AABB> boxes(volumeCount);
+	std::vector<OBB> orientedBoxes(volumeCount);
+	for (unsigned int i = 0; i < volumeCount; i++) {
+		XMFLOAT3 center(Random(-100, 100), Random(-100, 100), Random(-100, 100));
+		XMFLOAT3 extents(Random(0.1f, 3), Random(0.1f, 3), Random(0.1f, 3));
+
+		spheres[i].Center = center;
+		spheres[i].Radius = extents.x;
+		boxes[i].Center = center;
+		boxes[i].Extents = extents;
+		orientedBoxes[i].Center = center;
+		orientedBoxes[i].Extents = extents;
+		XMStoreFloat4(&orientedBoxes[i].Orientation, XMQuaternionRotationRollPitchYaw(Random(-3, 3), Random(-3, 3), Random(-3, 3)));
+	}
+
+	std::vector<unsigned char> single(volumeCount);
+	std::vector<unsigned char> batch(volumeCount);
+	unsigned int totalDifferences = 0;
+
+	printf("Geometry benchmark: %u volumes, %u iterations\n", volumeCount, iterations);
+	printf("  %-14s %11s  %11s\n", "", "single", "4-wide");
+
+	unsigned int hits = 0;
+	float singleMilliseconds = Time(iterations, [&]() { hits = frustum.CullSpheres(spheres.data(), volumeCount, single.data()); });
+	float batchMilliseconds = Time(iterations, [&]() { frustum.CullSpheresSIMD(spheres.data(), volumeCount, batch.data()); });
+	unsigned int differences = CountDifferences(single.data(), batch.data(), volumeCount);
+	PrintRow("Cull spheres", singleMilliseconds, batchMilliseconds, hits, differences);
+	totalDifferences += differences;
+
+	singleMilliseconds = Time(iterations, [&]() { hits = frustum.CullAABBs(boxes.data(), volumeCount, single.data()); });
+	batchMilliseconds = Time(iterations, [&]() { frustum.CullAABBsSIMD(boxes.data(), volumeCount, batch.data()); });
+	differences = CountDifferences(single.data(), batch.data(), volumeCount);
+	PrintRow("Cull AABBs", singleMilliseconds, batchMilliseconds, hits, differences);
+	totalDifferences += differences;
+
+	// Oriented boxes only have the single test
+	singleMilliseconds = Time(iterations, [&]() {
+		hits = 0;
+		for (unsigned int i = 0; i < volumeCount; i++)
+			hits += frustum.IsVisible(orientedBoxes[i]) ? 1 : 0;
+	});
+	PrintRow("Cull OBBs", singleMilliseconds, 0, hits, 0);
+
+	// Rays from near the camera out in random directions
+	std::vector<Ray> rays(BENCHMARK_RAY_COUNT);
+	for (auto& ray : rays) {
+		ray.Origin = XMFLOAT3(Random(-1, 1), Random(-1, 1), Random(-1, 1));
+		XMStoreFloat3(&ray.Direction, XMVector3Normalize(XMVectorSet(Random(-1, 1), Random(-1, 1), Random(-1, 1), 0)));
+	}
+
+	std::vector<float> singleDistances(volumeCount);
+	std::vector<float> batchDistances(volumeCount);
+	differences = 0;
+	singleMilliseconds = Time(iterations, [&]() {
+		hits = 0;
+		for (auto& ray : rays)
+			hits += Intersection::RayAABBs(ray, boxes.data(), volumeCount, 1000, singleDistances.data());
+	});
+	batchMilliseconds = Time(iterations, [&]() {
+		for (auto& ray : rays)
+			Intersection::RayAABBsSIMD(ray, boxes.data(), volumeCount, 1000, batchDistances.data());
+	});
+	for (unsigned int i = 0; i < volumeCount; i++)
+		differences += singleDistances[i] != batchDistances[i] ? 1 : 0;
+	PrintRow("Ray vs AABBs", singleMilliseconds, batchMilliseconds, hits, differences);
+	totalDifferences += differences;
+
+	// A bumpy grid, with rays coming down onto it from above
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	for (unsigned int z = 0; z <= BENCHMARK_GRID_SIZE; z++) {
+		for (unsigned int x = 0; x <= BENCHMARK_GRID_SIZE; x++) {
+			Vertex vertex = {};
+			vertex.Position = XMFLOAT3((float)x, Random(0, 0.5f), (float)z);
+			vertices.push_back(vertex);
+		}
+	}
+	for (unsigned int z = 0; z < BENCHMARK_GRID_SIZE; z++) {
+		for (unsigned int x = 0; x < BENCHMARK_GRID_SIZE; x++) {
+			unsigned int corner = z * (BENCHMARK_GRID_SIZE + 1) + x;
+			unsigned int triangles[6] = {
+				corner, corner + BENCHMARK_GRID_SIZE + 1, corner + 1,
+				corner + 1, corner + BENCHMARK_GRID_SIZE + 1, corner + BENCHMARK_GRID_SIZE + 2 };
+			indices.insert(indices.end(), triangles, triangles + 6);
+		}
+	}
+	for (auto& ray : rays) {
+		ray.Origin = XMFLOAT3(Random(0, BENCHMARK_GRID_SIZE), 10, Random(0, BENCHMARK_GRID_SIZE));
+		ray.Direction = XMFLOAT3(Random(-0.1f, 0.1f), -1, Random(-0.1f, 0.1f));
+	}
+
+	ArrayView<Vertex> vertexView(vertices.data(), vertices.size());
+	ArrayView<unsigned int> indexView(indices.data(), indices.size());
+	singleMilliseconds = Time(iterations, [&]() {
+		hits = 0;
+		for (auto& ray : rays) {
+			float distance;
+			hits += Intersection::RayMesh(ray, vertexView, indexView, 1000, &distance) ? 1 : 0;
+		}
+	});
+	PrintRow("Ray vs mesh", singleMilliseconds, 0, hits, 0);
+	printf("  (%u rays, %u triangles)\n", BENCHMARK_RAY_COUNT, (unsigned int)indices.size() / 3);
+
+	return totalDifferences == 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+// --------------------------------------------------------
+// Headless microbenchmarks for FrustumCuller and
+// Intersection - culls volumeCount random spheres, boxes and
+// oriented boxes, casts rays at random boxes and at a grid
+// mesh, and prints the time per call for the single and
+// four-wide versions, along with any volumes the two
+// disagree on.  Only needs DirectXMath.
+// --------------------------------------------------------
+class GeometryBenchmark
+{
+public:
+	// Returns false if a batch test disagreed with the single one
+	static bool Run(unsigned int volumeCount, unsigned int iterations);
+};
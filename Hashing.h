@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// --------------------------------------------------------
+// Hashes for cache keys and change detection - fast, and
+// stable across runs and platforms, but not meant to stand
+// up to anyone trying to cause a collision
+// --------------------------------------------------------
+class Hashing
+{
+public:
+	// 64-bit FNV-1a
+	static uint64_t FNV1a(const void* data, size_t size)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+};
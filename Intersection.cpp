@@ -0,0 +1,217 @@
+#include "Intersection.h"
+
+#include <math.h>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Slab test - where the ray enters and leaves the box along
+// each axis, using the reciprocal of the direction so there
+// are no divides per box.  A zero direction component turns
+// into an infinity, which puts that axis's slab either
+// everywhere or nowhere along the ray, as it should.  The
+// batch version below does the same math four boxes at once,
+// so the two always agree.
+// --------------------------------------------------------
+bool Intersection::RayAABB(const Ray& ray, const AABB& box, float maxDistance, float* distance)
+{
+	XMVECTOR origin = XMLoadFloat3(&ray.Origin);
+	XMVECTOR inverseDirection = XMVectorReciprocal(XMLoadFloat3(&ray.Direction));
+	XMVECTOR center = XMLoadFloat3(&box.Center);
+	XMVECTOR extents = XMLoadFloat3(&box.Extents);
+
+	XMVECTOR low = XMVectorMultiply(XMVectorSubtract(XMVectorSubtract(center, extents), origin), inverseDirection);
+	XMVECTOR high = XMVectorMultiply(XMVectorSubtract(XMVectorAdd(center, extents), origin), inverseDirection);
+	XMFLOAT3 enter, exit;
+	XMStoreFloat3(&enter, XMVectorMin(low, high));
+	XMStoreFloat3(&exit, XMVectorMax(low, high));
+
+	float nearest = enter.x > 0 ? enter.x : 0;
+	if (enter.y > nearest) nearest = enter.y;
+	if (enter.z > nearest) nearest = enter.z;
+
+	float farthest = exit.x < maxDistance ? exit.x : maxDistance;
+	if (exit.y < farthest) farthest = exit.y;
+	if (exit.z < farthest) farthest = exit.z;
+
+	if (nearest > farthest)
+		return false;
+
+	*distance = nearest;
+	return true;
+}
+
+bool Intersection::RaySphere(const Ray& ray, const Sphere& sphere, float maxDistance, float* distance)
+{
+	XMVECTOR direction = XMLoadFloat3(&ray.Direction);
+	XMVECTOR toOrigin = XMVectorSubtract(XMLoadFloat3(&ray.Origin), XMLoadFloat3(&sphere.Center));
+
+	// Solve |origin + t * direction - center| = radius for t
+	float a = XMVectorGetX(XMVector3Dot(direction, direction));
+	float halfB = XMVectorGetX(XMVector3Dot(toOrigin, direction));
+	float c = XMVectorGetX(XMVector3Dot(toOrigin, toOrigin)) - sphere.Radius * sphere.Radius;
+
+	// Starting inside
+	if (c <= 0) {
+		*distance = 0;
+		return true;
+	}
+
+	// Outside and heading away, or missing entirely
+	float discriminant = halfB * halfB - a * c;
+	if (halfB > 0 || discriminant < 0)
+		return false;
+
+	float t = (-halfB - sqrtf(discriminant)) / a;
+	if (t > maxDistance)
+		return false;
+
+	*distance = t;
+	return true;
+}
+
+// --------------------------------------------------------
+// Moller-Trumbore - solves for the hit's barycentric
+// coordinates and distance directly, without building the
+// triangle's plane first.  A ray in the triangle's plane has
+// a zero determinant and misses.
+// --------------------------------------------------------
+bool Intersection::RayTriangle(
+	const Ray& ray,
+	const XMFLOAT3& a,
+	const XMFLOAT3& b,
+	const XMFLOAT3& c,
+	float maxDistance,
+	float* distance)
+{
+	XMVECTOR direction = XMLoadFloat3(&ray.Direction);
+	XMVECTOR vertexA = XMLoadFloat3(&a);
+	XMVECTOR edge1 = XMVectorSubtract(XMLoadFloat3(&b), vertexA);
+	XMVECTOR edge2 = XMVectorSubtract(XMLoadFloat3(&c), vertexA);
+
+	XMVECTOR p = XMVector3Cross(direction, edge2);
+	float determinant = XMVectorGetX(XMVector3Dot(edge1, p));
+	if (determinant == 0)
+		return false;
+	float inverseDeterminant = 1.0f / determinant;
+
+	XMVECTOR s = XMVectorSubtract(XMLoadFloat3(&ray.Origin), vertexA);
+	float u = XMVectorGetX(XMVector3Dot(s, p)) * inverseDeterminant;
+	if (u < 0 || u > 1)
+		return false;
+
+	XMVECTOR q = XMVector3Cross(s, edge1);
+	float v = XMVectorGetX(XMVector3Dot(direction, q)) * inverseDeterminant;
+	if (v < 0 || u + v > 1)
+		return false;
+
+	float t = XMVectorGetX(XMVector3Dot(edge2, q)) * inverseDeterminant;
+	if (t < 0 || t > maxDistance)
+		return false;
+
+	*distance = t;
+	return true;
+}
+
+bool Intersection::RayMesh(const Ray& ray, ArrayView<Vertex> vertices, ArrayView<unsigned int> indices, float maxDistance, float* distance)
+{
+	Submesh whole = { 0, (unsigned int)indices.Size(), 0, 0 };
+	return RayMesh(ray, vertices, indices, ArrayView<Submesh>(&whole, 1), maxDistance, distance);
+}
+
+bool Intersection::RayMesh(const Ray& ray, ArrayView<Vertex> vertices, ArrayView<unsigned int> indices, ArrayView<Submesh> submeshes, float maxDistance, float* distance)
+{
+	// Each hit shortens the ray, so farther triangles bail early
+	bool hit = false;
+	for (const Submesh& submesh : submeshes) {
+		// A range past the end of the indices is skipped, not read
+		if (submesh.IndexStart > indices.Size() || submesh.IndexCount > indices.Size() - submesh.IndexStart)
+			continue;
+
+		const unsigned int* rangeIndices = indices.Data + submesh.IndexStart;
+		const Vertex* rangeVertices = vertices.Data + submesh.BaseVertex;
+		for (unsigned int i = 0; i + 2 < submesh.IndexCount; i += 3) {
+			float t;
+			if (RayTriangle(
+				ray,
+				rangeVertices[rangeIndices[i]].Position,
+				rangeVertices[rangeIndices[i + 1]].Position,
+				rangeVertices[rangeIndices[i + 2]].Position,
+				maxDistance,
+				&t)) {
+				maxDistance = t;
+				hit = true;
+			}
+		}
+	}
+
+	if (hit)
+		*distance = maxDistance;
+	return hit;
+}
+
+unsigned int Intersection::RayAABBs(const Ray& ray, const AABB* boxes, unsigned int count, float maxDistance, float* distancesOut)
+{
+	unsigned int hitCount = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (RayAABB(ray, boxes[i], maxDistance, &distancesOut[i]))
+			hitCount++;
+		else
+			distancesOut[i] = -1;
+	}
+
+	return hitCount;
+}
+
+// --------------------------------------------------------
+// The slab test on four boxes per iteration, transposed so
+// each register holds one axis of all four.  The ray is
+// splatted once up front.
+// --------------------------------------------------------
+unsigned int Intersection::RayAABBsSIMD(const Ray& ray, const AABB* boxes, unsigned int count, float maxDistance, float* distancesOut)
+{
+	XMVECTOR origin = XMLoadFloat3(&ray.Origin);
+	XMVECTOR inverseDirection = XMVectorReciprocal(XMLoadFloat3(&ray.Direction));
+	XMVECTOR originAxis[3] = { XMVectorSplatX(origin), XMVectorSplatY(origin), XMVectorSplatZ(origin) };
+	XMVECTOR inverseAxis[3] = { XMVectorSplatX(inverseDirection), XMVectorSplatY(inverseDirection), XMVectorSplatZ(inverseDirection) };
+	XMVECTOR maxDistances = XMVectorReplicate(maxDistance);
+	XMVECTOR miss = XMVectorReplicate(-1);
+
+	unsigned int hitCount = 0;
+	unsigned int batchEnd = count & ~3u;
+	for (unsigned int i = 0; i < batchEnd; i += 4)
+	{
+		XMMATRIX centers = XMMatrixTranspose(XMMATRIX(
+			XMLoadFloat3(&boxes[i + 0].Center),
+			XMLoadFloat3(&boxes[i + 1].Center),
+			XMLoadFloat3(&boxes[i + 2].Center),
+			XMLoadFloat3(&boxes[i + 3].Center)));
+		XMMATRIX extents = XMMatrixTranspose(XMMATRIX(
+			XMLoadFloat3(&boxes[i + 0].Extents),
+			XMLoadFloat3(&boxes[i + 1].Extents),
+			XMLoadFloat3(&boxes[i + 2].Extents),
+			XMLoadFloat3(&boxes[i + 3].Extents)));
+
+		XMVECTOR nearest = XMVectorZero();
+		XMVECTOR farthest = maxDistances;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			XMVECTOR low = XMVectorMultiply(XMVectorSubtract(XMVectorSubtract(centers.r[axis], extents.r[axis]), originAxis[axis]), inverseAxis[axis]);
+			XMVECTOR high = XMVectorMultiply(XMVectorSubtract(XMVectorAdd(centers.r[axis], extents.r[axis]), originAxis[axis]), inverseAxis[axis]);
+			nearest = XMVectorMax(nearest, XMVectorMin(low, high));
+			farthest = XMVectorMin(farthest, XMVectorMax(low, high));
+		}
+
+		XMVECTOR hit = XMVectorLessOrEqual(nearest, farthest);
+		XMStoreFloat4((XMFLOAT4*)&distancesOut[i], XMVectorSelect(miss, nearest, hit));
+
+		XMUINT4 bits;
+		XMStoreUInt4(&bits, hit);
+		hitCount += (bits.x ? 1 : 0) + (bits.y ? 1 : 0) + (bits.z ? 1 : 0) + (bits.w ? 1 : 0);
+	}
+
+	hitCount += RayAABBs(ray, boxes + batchEnd, count - batchEnd, maxDistance, distancesOut + batchEnd);
+
+	return hitCount;
+}
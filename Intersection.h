@@ -0,0 +1,49 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include "ArrayView.h"
+#include "Bounds.h"
+#include "Submesh.h"
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Ray queries against bounding volumes and triangles, for
+// picking and line of sight.  Distances are along the ray in
+// multiples of its direction's length, and only hits from the
+// origin up to maxDistance count.  Like FrustumCuller, only
+// depends on DirectXMath, so it runs without a device.
+// --------------------------------------------------------
+class Intersection
+{
+public:
+	// Single queries - return whether the ray hits, and where it
+	// first does in distance (0 if the origin is already inside)
+	static bool RayAABB(const Ray& ray, const AABB& box, float maxDistance, float* distance);
+	static bool RaySphere(const Ray& ray, const Sphere& sphere, float maxDistance, float* distance);
+
+	// Both sides of the triangle count as a hit
+	static bool RayTriangle(
+		const Ray& ray,
+		const DirectX::XMFLOAT3& a,
+		const DirectX::XMFLOAT3& b,
+		const DirectX::XMFLOAT3& c,
+		float maxDistance,
+		float* distance);
+
+	// Nearest hit on an indexed triangle list, with indices into
+	// the whole vertex array
+	static bool RayMesh(const Ray& ray, ArrayView<Vertex> vertices, ArrayView<unsigned int> indices, float maxDistance, float* distance);
+
+	// Nearest hit on submeshes, with each range's indices relative
+	// to its BaseVertex - the layout of a Mesh's CPU geometry.  A
+	// Mesh only has that until ReleaseCPUGeometry (which the game
+	// calls on every mesh once collision is cooked), so check
+	// HasCPUGeometry first or keep arrays of your own.
+	static bool RayMesh(const Ray& ray, ArrayView<Vertex> vertices, ArrayView<unsigned int> indices, ArrayView<Submesh> submeshes, float maxDistance, float* distance);
+
+	// Batch tests - writes the distance to each box (or -1 for a
+	// miss) into distancesOut and returns the number hit
+	static unsigned int RayAABBs(const Ray& ray, const AABB* boxes, unsigned int count, float maxDistance, float* distancesOut);
+	static unsigned int RayAABBsSIMD(const Ray& ray, const AABB* boxes, unsigned int count, float maxDistance, float* distancesOut);
+};
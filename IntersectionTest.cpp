@@ -0,0 +1,72 @@
+#include "SelfTest.h"
+#include "Intersection.h"
+
+#include <math.h>
+
+using namespace DirectX;
+
+// A unit quad facing up at the given height, as two triangles
+static void AddQuad(Vertex* vertices, float height)
+{
+	XMFLOAT3 corners[4] = { XMFLOAT3(-1, height, -1), XMFLOAT3(1, height, -1), XMFLOAT3(1, height, 1), XMFLOAT3(-1, height, 1) };
+	for (int i = 0; i < 4; i++) {
+		vertices[i] = Vertex();
+		vertices[i].Position = corners[i];
+	}
+}
+
+// --------------------------------------------------------
+// Two submeshes sharing one vertex array the way a Mesh does,
+// each with indices relative to its BaseVertex - so reading
+// the second range's indices as absolute hits the wrong quad
+// --------------------------------------------------------
+static void RayMeshSubmeshTest()
+{
+	Vertex vertices[8];
+	AddQuad(vertices, 1);
+	AddQuad(vertices + 4, 3);
+	unsigned int indices[12] = { 0, 1, 2, 0, 2, 3, 0, 1, 2, 0, 2, 3 };
+	Submesh submeshes[2] = { { 0, 6, 0, 0 }, { 6, 6, 4, 1 } };
+
+	ArrayView<Vertex> vertexView(vertices, 8);
+	ArrayView<unsigned int> indexView(indices, 12);
+
+	// Straight down from above both quads hits the higher one first
+	Ray down;
+	down.Origin = XMFLOAT3(0.25f, 10, 0.5f);
+	down.Direction = XMFLOAT3(0, -1, 0);
+	float distance = 0;
+	SELF_TEST_CHECK(Intersection::RayMesh(down, vertexView, indexView, ArrayView<Submesh>(submeshes, 2), 100, &distance));
+	SELF_TEST_CHECK(fabsf(distance - 7) < 1e-4f);
+
+	// Only the second submesh
+	SELF_TEST_CHECK(Intersection::RayMesh(down, vertexView, indexView, ArrayView<Submesh>(submeshes + 1, 1), 100, &distance));
+	SELF_TEST_CHECK(fabsf(distance - 7) < 1e-4f);
+
+	// The absolute index version only sees the first four vertices
+	SELF_TEST_CHECK(Intersection::RayMesh(down, vertexView, indexView, 100, &distance));
+	SELF_TEST_CHECK(fabsf(distance - 9) < 1e-4f);
+
+	// Upward from between the quads only reaches the higher one,
+	// and the distance limit still applies
+	Ray up;
+	up.Origin = XMFLOAT3(-0.5f, 2, 0.25f);
+	up.Direction = XMFLOAT3(0, 1, 0);
+	SELF_TEST_CHECK(Intersection::RayMesh(up, vertexView, indexView, ArrayView<Submesh>(submeshes, 2), 100, &distance));
+	SELF_TEST_CHECK(fabsf(distance - 1) < 1e-4f);
+	SELF_TEST_CHECK(!Intersection::RayMesh(up, vertexView, indexView, ArrayView<Submesh>(submeshes, 2), 0.5f, &distance));
+
+	// Off to the side misses everything
+	Ray side = down;
+	side.Origin.x = 5;
+	SELF_TEST_CHECK(!Intersection::RayMesh(side, vertexView, indexView, ArrayView<Submesh>(submeshes, 2), 100, &distance));
+
+	// A range running past the indices is skipped rather than read
+	Submesh broken[2] = { { 6, 12, 4, 0 }, { 0xFFFFFFF0u, 32, 0, 0 } };
+	SELF_TEST_CHECK(!Intersection::RayMesh(down, vertexView, indexView, ArrayView<Submesh>(broken, 2), 100, &distance));
+}
+
+void IntersectionTest()
+{
+	RayMeshSubmeshTest();
+}
@@ -0,0 +1,98 @@
+#include "JobSystem.h"
+
+JobSystem::JobSystem(unsigned int workerCount) :
+	queue(256),
+	queueHead(0),
+	queueCount(0),
+	stopping(false)
+{
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers.push_back(std::thread(&JobSystem::WorkerLoop, this));
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueReady.notify_all();
+
+	for (auto& w : workers)
+		w.join();
+}
+
+unsigned int JobSystem::DefaultWorkerCount()
+{
+	unsigned int threads = std::thread::hardware_concurrency();
+	return threads > 1 ? threads - 1 : 1;
+}
+
+void JobSystem::Submit(JobFunction function, void* data)
+{
+	if (workers.empty()) {
+		function(data);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		// Full, so unroll the ring into one twice the size
+		if (queueCount == queue.size()) {
+			std::vector<Job> grown(queue.size() * 2);
+			for (size_t i = 0; i < queueCount; i++)
+				grown[i] = queue[(queueHead + i) % queue.size()];
+			queue.swap(grown);
+			queueHead = 0;
+		}
+
+		Job& job = queue[(queueHead + queueCount) % queue.size()];
+		job.Function = function;
+		job.Data = data;
+		queueCount++;
+	}
+	queueReady.notify_one();
+}
+
+bool JobSystem::PopJob(Job* job)
+{
+	if (queueCount == 0)
+		return false;
+
+	*job = queue[queueHead];
+	queueHead = (queueHead + 1) % queue.size();
+	queueCount--;
+	return true;
+}
+
+bool JobSystem::RunPendingJob()
+{
+	Job job;
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		if (!PopJob(&job))
+			return false;
+	}
+
+	job.Function(job.Data);
+	return true;
+}
+
+void JobSystem::WorkerLoop()
+{
+	for (;;) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueReady.wait(lock, [this] { return stopping || queueCount > 0; });
+
+			// Anything still queued runs before stopping, as
+			// someone may be waiting on it
+			if (!PopJob(&job))
+				return;
+		}
+
+		job.Function(job.Data);
+	}
+}
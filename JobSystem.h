@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// The game's one pool of worker threads.  PhysX runs its
+// tasks here (through PhysXDispatcher) and so does anything
+// else that splits up work, so the engine never has more
+// busy threads than cores.
+//
+// Jobs are a function pointer and a pointer of data, so
+// submitting one only allocates if the queue is full (it
+// starts with room for 256 and doubles from there), and can
+// happen from any thread - including from inside another
+// job.  With zero workers, everything runs on the thread
+// that submits it.
+// --------------------------------------------------------
+class JobSystem
+{
+public:
+	typedef void (*JobFunction)(void* data);
+
+	explicit JobSystem(unsigned int workerCount);
+	~JobSystem();
+
+	// One per hardware thread, leaving one for the main thread
+	static unsigned int DefaultWorkerCount();
+
+	unsigned int GetWorkerCount() const { return (unsigned int)workers.size(); }
+
+	void Submit(JobFunction function, void* data);
+
+	// Runs one queued job on this thread, if there is one - for
+	// waiting threads to help instead of sleeping
+	bool RunPendingJob();
+
+	// Splits [0, count) into chunks of at least minChunk items and
+	// runs body(begin, end) on each, across the workers and this
+	// thread, returning once every chunk is done
+	template<typename Body>
+	void ParallelFor(unsigned int count, unsigned int minChunk, const Body& body);
+
+private:
+	struct Job
+	{
+		JobFunction Function;
+		void* Data;
+	};
+
+	// Queue of jobs as a ring, which only grows if it's ever full
+	std::vector<Job> queue;
+	size_t queueHead;
+	size_t queueCount;
+
+	std::mutex queueMutex;
+	std::condition_variable queueReady;
+	bool stopping;
+
+	std::vector<std::thread> workers;
+
+	bool PopJob(Job* job);
+	void WorkerLoop();
+
+	// Chunks are kept on the caller's stack, so there's a limit
+	static const unsigned int MaxChunks = 64;
+
+	template<typename Body>
+	struct Chunk
+	{
+		const Body* Function;
+		unsigned int Begin;
+		unsigned int End;
+		std::atomic<unsigned int>* Remaining;
+	};
+
+	template<typename Body>
+	static void RunChunk(void* data);
+};
+
+template<typename Body>
+inline void JobSystem::RunChunk(void* data)
+{
+	Chunk<Body>* chunk = (Chunk<Body>*)data;
+	(*chunk->Function)(chunk->Begin, chunk->End);
+	chunk->Remaining->fetch_sub(1, std::memory_order_release);
+}
+
+template<typename Body>
+inline void JobSystem::ParallelFor(unsigned int count, unsigned int minChunk, const Body& body)
+{
+	if (count == 0)
+		return;
+
+	// One chunk per thread at most, and none smaller than minChunk
+	unsigned int threads = GetWorkerCount() + 1;
+	unsigned int chunkCount = minChunk > 0 ? (count + minChunk - 1) / minChunk : count;
+	if (chunkCount > threads) chunkCount = threads;
+	if (chunkCount > MaxChunks) chunkCount = MaxChunks;
+
+	// Not worth the hand off
+	if (chunkCount <= 1) {
+		body(0, count);
+		return;
+	}
+
+	// Rounding the size up can leave fewer chunks than planned
+	unsigned int chunkSize = (count + chunkCount - 1) / chunkCount;
+	chunkCount = (count + chunkSize - 1) / chunkSize;
+
+	Chunk<Body> chunks[MaxChunks];
+	std::atomic<unsigned int> remaining(chunkCount - 1);
+	for (unsigned int c = 0; c < chunkCount; c++) {
+		chunks[c].Function = &body;
+		chunks[c].Begin = c * chunkSize;
+		chunks[c].End = c + 1 < chunkCount ? (c + 1) * chunkSize : count;
+		chunks[c].Remaining = &remaining;
+	}
+
+	// This thread takes the first chunk itself, then helps with
+	// whatever's queued (which may not even be its own) until
+	// every chunk is done
+	for (unsigned int c = 1; c < chunkCount; c++)
+		Submit(&RunChunk<Body>, &chunks[c]);
+	body(chunks[0].Begin, chunks[0].End);
+
+	while (remaining.load(std::memory_order_acquire) > 0) {
+		if (!RunPendingJob())
+			std::this_thread::yield();
+	}
+}
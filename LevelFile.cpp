@@ -0,0 +1,272 @@
+#include "LevelFile.h"
+
+#include <fstream>
+#include <stdlib.h>
+#include <string.h>
+
+// --------------------------------------------------------
+// Small cursor over the text, which never reads past the
+// end (the text doesn't need to be null terminated)
+// --------------------------------------------------------
+struct TextCursor
+{
+	const char* Position;
+	const char* End;
+	int Line;
+
+	// Skips spaces and tabs, but stops at the end of the line
+	void SkipSpaces()
+	{
+		while (Position < End && (*Position == ' ' || *Position == '\t' || *Position == '\r'))
+			Position++;
+	}
+
+	bool AtLineEnd()
+	{
+		SkipSpaces();
+		return Position >= End || *Position == '\n' || *Position == '#';
+	}
+
+	void NextLine()
+	{
+		while (Position < End && *Position != '\n')
+			Position++;
+		if (Position < End)
+			Position++;
+		Line++;
+	}
+
+	// The next whitespace separated word, as a pointer and length
+	bool Word(const char** word, size_t* length)
+	{
+		if (AtLineEnd())
+			return false;
+
+		*word = Position;
+		while (Position < End && *Position != ' ' && *Position != '\t' && *Position != '\r' && *Position != '\n')
+			Position++;
+		*length = Position - *word;
+		return true;
+	}
+
+	bool Float(float* value)
+	{
+		const char* word;
+		size_t length;
+		if (!Word(&word, &length) || length >= 32)
+			return false;
+
+		// strtof needs a terminator, and words are short
+		char buffer[32];
+		memcpy(buffer, word, length);
+		buffer[length] = 0;
+
+		char* end;
+		*value = strtof(buffer, &end);
+		return end == buffer + length;
+	}
+};
+
+static bool WordIs(const char* word, size_t length, const char* keyword)
+{
+	return strlen(keyword) == length && memcmp(word, keyword, length) == 0;
+}
+
+// Index of a name in a table, adding it if it's new - tables
+// are a handful of entries, so a linear search is fine
+static uint32_t FindOrAddName(std::vector<std::string>& names, const char* word, size_t length)
+{
+	for (size_t i = 0; i < names.size(); i++)
+		if (names[i].size() == length && memcmp(names[i].data(), word, length) == 0)
+			return (uint32_t)i;
+
+	names.push_back(std::string(word, length));
+	return (uint32_t)(names.size() - 1);
+}
+
+static bool ParseError(const TextCursor& cursor, const char* reason, std::string* error)
+{
+	if (error)
+		*error = "line " + std::to_string(cursor.Line) + ": " + reason;
+	return false;
+}
+
+bool LevelFile::ParseText(const char* text, size_t size, LevelData* level, std::string* error)
+{
+	level->MeshNames.clear();
+	level->MaterialNames.clear();
+	level->Blocks.clear();
+
+	// Every block is at least a few dozen characters, so this
+	// reserves a little extra rather than growing over and over
+	level->Blocks.reserve(size / 32);
+
+	TextCursor cursor = { text, text + size, 1 };
+	for (; cursor.Position < cursor.End; cursor.NextLine()) {
+		const char* word;
+		size_t length;
+		if (!cursor.Word(&word, &length))
+			continue;
+
+		if (!WordIs(word, length, "block"))
+			return ParseError(cursor, "expected \"block\"", error);
+
+		LevelBlock block = {};
+		if (!cursor.Word(&word, &length))
+			return ParseError(cursor, "missing mesh name", error);
+		block.Mesh = FindOrAddName(level->MeshNames, word, length);
+
+		if (!cursor.Word(&word, &length))
+			return ParseError(cursor, "missing material name", error);
+		block.Material = FindOrAddName(level->MaterialNames, word, length);
+
+		for (int i = 0; i < 3; i++)
+			if (!cursor.Float(&block.Scale[i]))
+				return ParseError(cursor, "expected three scale values", error);
+		for (int i = 0; i < 3; i++)
+			if (!cursor.Float(&block.Position[i]))
+				return ParseError(cursor, "expected three position values", error);
+		if (!cursor.Float(&block.Rotation))
+			return ParseError(cursor, "expected a rotation", error);
+
+		block.Flags = LEVEL_BLOCK_DEFAULT;
+		while (cursor.Word(&word, &length)) {
+			if (WordIs(word, length, "nocollide"))
+				block.Flags &= ~LEVEL_BLOCK_COLLIDES;
+			else if (WordIs(word, length, "hidden"))
+				block.Flags &= ~LEVEL_BLOCK_VISIBLE;
+			else
+				return ParseError(cursor, "unknown flag", error);
+		}
+
+		level->Blocks.push_back(block);
+	}
+
+	return true;
+}
+
+bool LevelFile::ReadBinary(const unsigned char* data, size_t size, LevelData* level)
+{
+	if (size < sizeof(LevelFileHeader))
+		return false;
+
+	LevelFileHeader h;
+	memcpy(&h, data, sizeof(h));
+
+	unsigned long long expectedSize =
+		sizeof(LevelFileHeader) +
+		(unsigned long long)h.BlockCount * sizeof(LevelBlock) +
+		h.NameBytes;
+
+	if (h.Magic != LEVEL_FILE_MAGIC ||
+		h.Version != LEVEL_FILE_VERSION ||
+		expectedSize != size)
+		return false;
+
+	// The names are a run of null terminated strings, which
+	// must end exactly at the end of the file
+	const char* names = (const char*)data + sizeof(LevelFileHeader) + (size_t)h.BlockCount * sizeof(LevelBlock);
+	const char* namesEnd = names + h.NameBytes;
+	std::vector<std::string> allNames;
+	allNames.reserve(h.MeshNameCount + h.MaterialNameCount);
+	while (names < namesEnd && allNames.size() < (size_t)h.MeshNameCount + h.MaterialNameCount) {
+		const char* terminator = (const char*)memchr(names, 0, namesEnd - names);
+		if (!terminator)
+			return false;
+		allNames.push_back(std::string(names, terminator));
+		names = terminator + 1;
+	}
+	if (names != namesEnd || allNames.size() != (size_t)h.MeshNameCount + h.MaterialNameCount)
+		return false;
+
+	level->MeshNames.assign(allNames.begin(), allNames.begin() + h.MeshNameCount);
+	level->MaterialNames.assign(allNames.begin() + h.MeshNameCount, allNames.end());
+
+	// Blocks are copied in one go, then checked
+	level->Blocks.resize(h.BlockCount);
+	if (h.BlockCount > 0)
+		memcpy(&level->Blocks[0], data + sizeof(LevelFileHeader), (size_t)h.BlockCount * sizeof(LevelBlock));
+
+	for (auto& block : level->Blocks)
+		if (block.Mesh >= h.MeshNameCount || block.Material >= h.MaterialNameCount)
+			return false;
+
+	return true;
+}
+
+void LevelFile::WriteBinary(const LevelData& level, std::vector<unsigned char>& out)
+{
+	std::string names;
+	for (auto& name : level.MeshNames)
+		names.append(name.c_str(), name.size() + 1);
+	for (auto& name : level.MaterialNames)
+		names.append(name.c_str(), name.size() + 1);
+
+	LevelFileHeader h = {};
+	h.Magic = LEVEL_FILE_MAGIC;
+	h.Version = LEVEL_FILE_VERSION;
+	h.BlockCount = (uint32_t)level.Blocks.size();
+	h.MeshNameCount = (uint32_t)level.MeshNames.size();
+	h.MaterialNameCount = (uint32_t)level.MaterialNames.size();
+	h.NameBytes = (uint32_t)names.size();
+
+	size_t blockBytes = level.Blocks.size() * sizeof(LevelBlock);
+	out.resize(sizeof(h) + blockBytes + names.size());
+	memcpy(&out[0], &h, sizeof(h));
+	if (blockBytes > 0)
+		memcpy(&out[sizeof(h)], &level.Blocks[0], blockBytes);
+	if (!names.empty())
+		memcpy(&out[sizeof(h) + blockBytes], names.data(), names.size());
+}
+
+bool LevelFile::Load(const std::string& path, LevelData* level, std::string* error)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		if (error) *error = "couldn't open " + path;
+		return false;
+	}
+
+	std::vector<unsigned char> bytes((size_t)file.tellg());
+	file.seekg(0);
+	if (!bytes.empty() && !file.read((char*)bytes.data(), bytes.size())) {
+		if (error) *error = "couldn't read " + path;
+		return false;
+	}
+
+	uint32_t magic = 0;
+	if (bytes.size() >= sizeof(magic))
+		memcpy(&magic, bytes.data(), sizeof(magic));
+
+	if (magic != LEVEL_FILE_MAGIC)
+		return ParseText((const char*)bytes.data(), bytes.size(), level, error);
+
+	if (!ReadBinary(bytes.data(), bytes.size(), level)) {
+		if (error) *error = path + " is damaged or from another version";
+		return false;
+	}
+	return true;
+}
+
+bool LevelFile::SaveBinary(const std::string& path, const LevelData& level)
+{
+	std::vector<unsigned char> bytes;
+	WriteBinary(level, bytes);
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	out.write((const char*)bytes.data(), bytes.size());
+	return out.good();
+}
+
+std::string LevelFile::GetBinaryFileName(const std::string& textFile)
+{
+	std::string name(textFile);
+	size_t dot = name.find_last_of('.');
+	size_t slash = name.find_last_of("/\\");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		name.erase(dot);
+	return name + ".levelbin";
+}
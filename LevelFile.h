@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Block flags - a block can be solid but invisible (an
+// invisible wall) or visible but not solid (decoration)
+#define LEVEL_BLOCK_COLLIDES 0x1u
+#define LEVEL_BLOCK_VISIBLE 0x2u
+#define LEVEL_BLOCK_DEFAULT (LEVEL_BLOCK_COLLIDES | LEVEL_BLOCK_VISIBLE)
+
+// --------------------------------------------------------
+// One placed mesh.  Mesh and Material index the level's
+// name tables, which the game resolves to its own assets.
+// Rotation is in radians around +Y.
+// --------------------------------------------------------
+struct LevelBlock
+{
+	uint32_t Mesh;
+	uint32_t Material;
+	float Scale[3];
+	float Position[3];
+	float Rotation;
+	uint32_t Flags;
+};
+
+struct LevelData
+{
+	std::vector<std::string> MeshNames;
+	std::vector<std::string> MaterialNames;
+	std::vector<LevelBlock> Blocks;
+};
+
+// --------------------------------------------------------
+// Binary layout - this header, the block array exactly as
+// LevelBlock, then every mesh name followed by every
+// material name, each null terminated
+// --------------------------------------------------------
+#define LEVEL_FILE_MAGIC 0x4C56454Cu // "LEVL"
+#define LEVEL_FILE_VERSION 1
+
+struct LevelFileHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t BlockCount;
+	uint32_t MeshNameCount;
+	uint32_t MaterialNameCount;
+	uint32_t NameBytes;
+};
+
+// --------------------------------------------------------
+// Reads and writes levels, from memory so the parsers can
+// be checked and timed anywhere.  Levels are authored as
+// text, one block per line:
+//
+//   # mesh  material  scale (x y z)  position (x y z)  rotation  [flags]
+//   block cube floor  6 4 6  0 25.5 0  0
+//   block ramp rough  4 4 6  0 25.5 5  -1.575  nocollide
+//
+// Names are added to the tables the first time they're
+// used.  Flags are "nocollide" and "hidden", and a block is
+// solid and visible without them.  The binary form is what
+// ships - it loads with one copy of the block array.
+// --------------------------------------------------------
+class LevelFile
+{
+public:
+	// Parses in a single pass without copying the text.  On a
+	// syntax error, returns false with the line and reason.
+	static bool ParseText(const char* text, size_t size, LevelData* level, std::string* error);
+
+	// Returns false for anything truncated, from another version,
+	// or with a block using a name that isn't in the tables
+	static bool ReadBinary(const unsigned char* data, size_t size, LevelData* level);
+	static void WriteBinary(const LevelData& level, std::vector<unsigned char>& out);
+
+	// Reads a whole file, picking the parser from the magic number
+	static bool Load(const std::string& path, LevelData* level, std::string* error);
+	static bool SaveBinary(const std::string& path, const LevelData& level);
+
+	// "Levels/Level1.level" -> "Levels/Level1.levelbin"
+	static std::string GetBinaryFileName(const std::string& textFile);
+};
@@ -0,0 +1,182 @@
+#include "SelfTest.h"
+#include "LevelFile.h"
+
+#include <string.h>
+
+// Comments, blank lines, CRLF endings, tabs, flags and reused
+// names - and no newline at the very end
+static const char* testLevel =
+	"# a test level\n"
+	"\n"
+	"block cube floor  6 4 6  0 25.5 0  0\r\n"
+	"block\tramp rough  4 4 6  0 25.5 5  -1.575  nocollide   # a ramp\n"
+	"   \n"
+	"block cube rough  1 1 1  -3e2 .5 7  3.14  hidden nocollide\n"
+	"block sphere floor  2 2 2  1 2 3  0";
+
+static bool SameBlock(const LevelBlock& a, const LevelBlock& b)
+{
+	return memcmp(&a, &b, sizeof(LevelBlock)) == 0;
+}
+
+// Parses text that should fail, returning the error
+static std::string ParseFailure(const char* text)
+{
+	LevelData level;
+	std::string error;
+	if (LevelFile::ParseText(text, strlen(text), &level, &error))
+		return "(parsed)";
+	return error;
+}
+
+static void ParseTest(LevelData* level)
+{
+	std::string error;
+	SELF_TEST_CHECK(LevelFile::ParseText(testLevel, strlen(testLevel), level, &error));
+	SELF_TEST_CHECK(error.empty());
+
+	SELF_TEST_CHECK(level->MeshNames.size() == 3);
+	SELF_TEST_CHECK(level->MaterialNames.size() == 2);
+	SELF_TEST_CHECK(level->Blocks.size() == 4);
+	if (level->MeshNames.size() != 3 || level->MaterialNames.size() != 2 || level->Blocks.size() != 4)
+		return;
+
+	SELF_TEST_CHECK(level->MeshNames[0] == "cube" && level->MeshNames[1] == "ramp" && level->MeshNames[2] == "sphere");
+	SELF_TEST_CHECK(level->MaterialNames[0] == "floor" && level->MaterialNames[1] == "rough");
+
+	const LevelBlock& first = level->Blocks[0];
+	SELF_TEST_CHECK(first.Mesh == 0 && first.Material == 0);
+	SELF_TEST_CHECK(first.Scale[0] == 6 && first.Scale[1] == 4 && first.Scale[2] == 6);
+	SELF_TEST_CHECK(first.Position[0] == 0 && first.Position[1] == 25.5f && first.Position[2] == 0);
+	SELF_TEST_CHECK(first.Flags == LEVEL_BLOCK_DEFAULT);
+
+	const LevelBlock& ramp = level->Blocks[1];
+	SELF_TEST_CHECK(ramp.Mesh == 1 && ramp.Material == 1);
+	SELF_TEST_CHECK(ramp.Rotation == -1.575f);
+	SELF_TEST_CHECK(ramp.Flags == LEVEL_BLOCK_VISIBLE);
+
+	const LevelBlock& hidden = level->Blocks[2];
+	SELF_TEST_CHECK(hidden.Mesh == 0 && hidden.Material == 1);
+	SELF_TEST_CHECK(hidden.Position[0] == -300.0f && hidden.Position[1] == 0.5f);
+	SELF_TEST_CHECK(hidden.Flags == 0);
+
+	SELF_TEST_CHECK(level->Blocks[3].Mesh == 2 && level->Blocks[3].Position[2] == 3);
+
+	// Nothing at all is an empty level, not an error
+	LevelData empty;
+	SELF_TEST_CHECK(LevelFile::ParseText("", 0, &empty, &error) && empty.Blocks.empty());
+	SELF_TEST_CHECK(LevelFile::ParseText("# nothing\n\n", 11, &empty, &error) && empty.Blocks.empty());
+}
+
+static void ParseErrorTest()
+{
+	// Each error names the line it's on, counting comments and blanks
+	SELF_TEST_CHECK(ParseFailure("# header\nblok cube floor 1 1 1 0 0 0 0\n") == "line 2: expected \"block\"");
+	SELF_TEST_CHECK(ParseFailure("block\n") == "line 1: missing mesh name");
+	SELF_TEST_CHECK(ParseFailure("\n\nblock cube\n") == "line 3: missing material name");
+	SELF_TEST_CHECK(ParseFailure("block cube floor 1 1\nblock cube floor 1 1 1 0 0 0 0\n") == "line 1: expected three scale values");
+	SELF_TEST_CHECK(ParseFailure("block cube floor 1 1 1 0 0 0 0\nblock cube floor 1 1 1 0 x 0 0\n") == "line 2: expected three position values");
+	SELF_TEST_CHECK(ParseFailure("block cube floor 1 1 1 0 0 0\n") == "line 1: expected a rotation");
+	SELF_TEST_CHECK(ParseFailure("block cube floor 1 1 1 0 0 0 0 solid\n") == "line 1: unknown flag");
+	SELF_TEST_CHECK(ParseFailure("\r\n\r\nblock cube floor 1 1 1 0 0 0 1.5.5\r\n") == "line 3: expected a rotation");
+
+	// The text isn't null terminated, so a value cut off at the end
+	// of the buffer has to fail rather than read past it
+	const char* cut = "block cube floor 1 1 1 0 0 0 12345";
+	LevelData level;
+	std::string error;
+	SELF_TEST_CHECK(!LevelFile::ParseText(cut, strlen(cut) - 5, &level, &error));
+	SELF_TEST_CHECK(error == "line 1: expected a rotation");
+}
+
+static void BinaryTest(const LevelData& parsed)
+{
+	// Text -> binary -> back gives the same level
+	std::vector<unsigned char> bytes;
+	LevelFile::WriteBinary(parsed, bytes);
+	SELF_TEST_CHECK(bytes.size() > sizeof(LevelFileHeader));
+
+	LevelData read;
+	SELF_TEST_CHECK(LevelFile::ReadBinary(bytes.data(), bytes.size(), &read));
+	SELF_TEST_CHECK(read.MeshNames == parsed.MeshNames);
+	SELF_TEST_CHECK(read.MaterialNames == parsed.MaterialNames);
+	SELF_TEST_CHECK(read.Blocks.size() == parsed.Blocks.size());
+	bool sameBlocks = read.Blocks.size() == parsed.Blocks.size();
+	for (size_t i = 0; sameBlocks && i < read.Blocks.size(); i++)
+		sameBlocks = SameBlock(read.Blocks[i], parsed.Blocks[i]);
+	SELF_TEST_CHECK(sameBlocks);
+
+	// And writing that again gives the same bytes
+	std::vector<unsigned char> again;
+	LevelFile::WriteBinary(read, again);
+	SELF_TEST_CHECK(again == bytes);
+
+	// Every truncation is rejected
+	bool anyTruncationRead = false;
+	for (size_t size = 0; size < bytes.size(); size++)
+		if (LevelFile::ReadBinary(bytes.data(), size, &read))
+			anyTruncationRead = true;
+	SELF_TEST_CHECK(!anyTruncationRead);
+
+	// As are extra bytes, and a wrong magic or version
+	std::vector<unsigned char> damaged = bytes;
+	damaged.push_back(0);
+	SELF_TEST_CHECK(!LevelFile::ReadBinary(damaged.data(), damaged.size(), &read));
+
+	LevelFileHeader header;
+	memcpy(&header, bytes.data(), sizeof(header));
+	auto withHeader = [&](const LevelFileHeader& changed) {
+		std::vector<unsigned char> copy = bytes;
+		memcpy(copy.data(), &changed, sizeof(changed));
+		LevelData level;
+		return LevelFile::ReadBinary(copy.data(), copy.size(), &level);
+	};
+
+	LevelFileHeader changed = header;
+	changed.Magic ^= 1;
+	SELF_TEST_CHECK(!withHeader(changed));
+	changed = header;
+	changed.Version++;
+	SELF_TEST_CHECK(!withHeader(changed));
+
+	// Counts that don't match what's in the file
+	changed = header;
+	changed.BlockCount++;
+	SELF_TEST_CHECK(!withHeader(changed));
+	changed = header;
+	changed.BlockCount = 0xFFFFFFFF;
+	SELF_TEST_CHECK(!withHeader(changed));
+	changed = header;
+	changed.MeshNameCount++;
+	SELF_TEST_CHECK(!withHeader(changed));
+	changed = header;
+	changed.MaterialNameCount--;
+	SELF_TEST_CHECK(!withHeader(changed));
+	changed = header;
+	changed.NameBytes--;
+	SELF_TEST_CHECK(!withHeader(changed));
+
+	// A block pointing past the name tables
+	damaged = bytes;
+	LevelBlock block;
+	memcpy(&block, &damaged[sizeof(LevelFileHeader)], sizeof(block));
+	block.Material = (uint32_t)parsed.MaterialNames.size();
+	memcpy(&damaged[sizeof(LevelFileHeader)], &block, sizeof(block));
+	SELF_TEST_CHECK(!LevelFile::ReadBinary(damaged.data(), damaged.size(), &read));
+
+	// A name missing its terminator
+	damaged = bytes;
+	damaged.back() = 'x';
+	SELF_TEST_CHECK(!LevelFile::ReadBinary(damaged.data(), damaged.size(), &read));
+}
+
+void LevelFileTest()
+{
+	LevelData parsed;
+	ParseTest(&parsed);
+	ParseErrorTest();
+	BinaryTest(parsed);
+
+	SELF_TEST_CHECK(LevelFile::GetBinaryFileName("Levels/Level1.level") == "Levels/Level1.levelbin");
+	SELF_TEST_CHECK(LevelFile::GetBinaryFileName("Levels.v2/Level1") == "Levels.v2/Level1.levelbin");
+}
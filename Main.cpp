@@ -4,6 +4,38 @@
 
 #include <Windows.h>
 #include "Game.h"
+#include "AllocationCounter.h"
+#include "DrawSorter.h"
+#include "GeometryBenchmark.h"
+#include "JobSystem.h"
+#include "PhysicsBenchmark.h"
+#include "SelfTest.h"
+#include "TransformSystem.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Integer following an option on the command line, if it's
+// there.  Value is left alone when the option has no number,
+// and false comes back only for one below the minimum.
+static bool GetOptionValue(const char* commandLine, const char* option, long minimum, int* value)
+{
+	const char* found = strstr(commandLine, option);
+	if (!found)
+		return true;
+
+	char* end;
+	long parsed = strtol(found + strlen(option), &end, 10);
+	if (end == found + strlen(option))
+		return true;
+	if (parsed < minimum || parsed > INT_MAX)
+		return false;
+
+	*value = (int)parsed;
+	return true;
+}
 
 // --------------------------------------------------------
 // Entry point for a graphical (non-console) Windows application
@@ -19,11 +51,132 @@ int WINAPI WinMain(
 	// way of determining if we forgot to clean something up
 	//  - You may want to use something more advanced, like Visual Leak Detector
 	_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
+
+	// Count allocations so the stats window can show any made while rendering
+	AllocationCounter::Install();
 #endif
 
+	// -physicsbenchmark [marbles] runs the headless PhysX stress
+	// test instead of the game, printing to the calling console
+	if (strstr(lpCmdLine, "-physicsbenchmark")) {
+		if (!AttachConsole(ATTACH_PARENT_PROCESS))
+			AllocConsole();
+		FILE* console;
+		freopen_s(&console, "CONOUT$", "w", stdout);
+
+		int marbles = 2000;
+		if (!GetOptionValue(lpCmdLine, "-physicsbenchmark", 1, &marbles)) {
+			printf("-physicsbenchmark needs a positive number of marbles\n");
+			return 1;
+		}
+		unsigned int maxWorkers = std::thread::hardware_concurrency();
+		if (maxWorkers == 0) maxWorkers = 1;
+		return PhysicsBenchmark::Run(maxWorkers, marbles, 300) ? 0 : 1;
+	}
+
+	// -geometrybenchmark [volumes] times the culling and ray
+	// tests on their own, printing to the calling console
+	if (strstr(lpCmdLine, "-geometrybenchmark")) {
+		if (!AttachConsole(ATTACH_PARENT_PROCESS))
+			AllocConsole();
+		FILE* console;
+		freopen_s(&console, "CONOUT$", "w", stdout);
+
+		int volumes = 100000;
+		if (!GetOptionValue(lpCmdLine, "-geometrybenchmark", 1, &volumes)) {
+			printf("-geometrybenchmark needs a positive number of volumes\n");
+			return 1;
+		}
+		return GeometryBenchmark::Run(volumes, 20) ? 0 : 1;
+	}
+
+	// -sortbenchmark [draws] times the draw key sort on its own,
+	// at 1k, 10k and 100k draws or just the count given
+	if (strstr(lpCmdLine, "-sortbenchmark")) {
+		if (!AttachConsole(ATTACH_PARENT_PROCESS))
+			AllocConsole();
+		FILE* console;
+		freopen_s(&console, "CONOUT$", "w", stdout);
+
+		int draws = 0;
+		if (!GetOptionValue(lpCmdLine, "-sortbenchmark", 1, &draws)) {
+			printf("-sortbenchmark needs a positive number of draws\n");
+			return 1;
+		}
+
+		// Fewer iterations as the sorts get bigger
+		unsigned int drawCounts[3] = { 1000, 10000, 100000 };
+		unsigned int iterations[3] = { 100, 20, 5 };
+		unsigned int runs = 3;
+		if (draws > 0) {
+			drawCounts[0] = (unsigned int)draws;
+			iterations[0] = draws < 10000 ? 100 : draws < 100000 ? 20 : 5;
+			runs = 1;
+		}
+
+		printf("Draw sort benchmark\n");
+		for (unsigned int i = 0; i < runs; i++)
+			printf("  %7u draws: %8.3f ms/sort\n", drawCounts[i], DrawSorter::Benchmark(drawCounts[i], iterations[i]));
+		return 0;
+	}
+
+	// -transformbenchmark [count] times rebuilding every matrix
+	// in one batch against one at a time in scattered order, at
+	// 10k and 100k transforms or just the count given
+	if (strstr(lpCmdLine, "-transformbenchmark")) {
+		if (!AttachConsole(ATTACH_PARENT_PROCESS))
+			AllocConsole();
+		FILE* console;
+		freopen_s(&console, "CONOUT$", "w", stdout);
+
+		int transforms = 0;
+		if (!GetOptionValue(lpCmdLine, "-transformbenchmark", 1, &transforms)) {
+			printf("-transformbenchmark needs a positive number of transforms\n");
+			return 1;
+		}
+
+		unsigned int transformCounts[2] = { 10000, 100000 };
+		unsigned int iterations[2] = { 20, 5 };
+		unsigned int runs = 2;
+		if (transforms > 0) {
+			transformCounts[0] = (unsigned int)transforms;
+			iterations[0] = transforms < 100000 ? 20 : 5;
+			runs = 1;
+		}
+
+		printf("Transform benchmark\n");
+		printf("  %17s  %11s  %11s\n", "", "batched", "scattered");
+		for (unsigned int i = 0; i < runs; i++) {
+			float batched = TransformSystem::Benchmark(transformCounts[i], iterations[i], true);
+			float scattered = TransformSystem::Benchmark(transformCounts[i], iterations[i], false);
+			printf("  %7u transforms  %8.3f ms  %8.3f ms   (%.2fx)\n",
+				transformCounts[i], batched, scattered, batched > 0 ? scattered / batched : 0.0f);
+		}
+		return 0;
+	}
+
+	// -selftest [name] runs the headless checks (all of them,
+	// or just the named one), printing to the calling console
+	if (strstr(lpCmdLine, "-selftest")) {
+		if (!AttachConsole(ATTACH_PARENT_PROCESS))
+			AllocConsole();
+		FILE* console;
+		freopen_s(&console, "CONOUT$", "w", stdout);
+
+		char name[64] = {};
+		sscanf_s(strstr(lpCmdLine, "-selftest") + strlen("-selftest"), "%63s", name, (unsigned int)sizeof(name));
+		return SelfTest::Run(name[0] ? name : 0) ? 0 : 1;
+	}
+
+	// -workers N overrides the job system's thread count (zero
+	// runs every job on the main thread, negative is ignored)
+	int workers = (int)JobSystem::DefaultWorkerCount();
+	if (!GetOptionValue(lpCmdLine, "-workers", 0, &workers))
+		workers = (int)JobSystem::DefaultWorkerCount();
+
 	// Create the Game object using
 	// the app handle we got from WinMain
-	Game dxGame(hInstance);
+	Game dxGame(hInstance, (unsigned int)workers);
 
 	// Result variable for function calls below
 	HRESULT hr = S_OK;
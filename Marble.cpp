@@ -19,6 +19,9 @@ Marble::Marble(physx::PxPhysics* physics, physx::PxScene* scene, physx::PxMateri
 	scene->addActor(*body);
 
 	shape->release();
+
+	previousPose = body->getGlobalPose();
+	currentPose = previousPose;
 }
 
 Marble::~Marble() {}
@@ -73,14 +76,26 @@ void Marble::Move(Input& input, float dt, DirectX::XMFLOAT2 forward, DirectX::XM
 	body->wakeUp();
 }
 
-void Marble::UpdateEntity()
+void Marble::RecordPose()
 {
-	// apply actor transforms to entity
-	PxVec3 pos = body->getGlobalPose().p;
-	PxQuat rot = body->getGlobalPose().q;
+	previousPose = currentPose;
+	currentPose = body->getGlobalPose();
+}
 
-	entity->GetTransform()->SetPosition(pos.x, pos.y, pos.z);
-	entity->GetTransform()->SetRotationQuat(rot.x, rot.y, rot.z, rot.w);
+void Marble::UpdateEntity(float alpha)
+{
+	// apply the interpolated actor transform to the entity
+	XMVECTOR previousPos = XMVectorSet(previousPose.p.x, previousPose.p.y, previousPose.p.z, 0);
+	XMVECTOR currentPos = XMVectorSet(currentPose.p.x, currentPose.p.y, currentPose.p.z, 0);
+	XMVECTOR previousRot = XMVectorSet(previousPose.q.x, previousPose.q.y, previousPose.q.z, previousPose.q.w);
+	XMVECTOR currentRot = XMVectorSet(currentPose.q.x, currentPose.q.y, currentPose.q.z, currentPose.q.w);
+
+	XMFLOAT3 pos;
+	XMFLOAT4 rot;
+	XMStoreFloat3(&pos, XMVectorLerp(previousPos, currentPos, alpha));
+	XMStoreFloat4(&rot, XMQuaternionSlerp(previousRot, currentRot, alpha));
+
+	entity->GetTransform()->SetPose(pos, rot);
 }
 
 void Marble::ResetPosition()
@@ -90,6 +105,10 @@ void Marble::ResetPosition()
 		body->setLinearVelocity(PxVec3(0, 0, 0));
 		body->setAngularVelocity(PxVec3(0, 0, 0));
 		body->setGlobalPose(PxTransform(PxVec3(0, 35, 0)));
+
+		// a teleport, so don't interpolate across it
+		previousPose = body->getGlobalPose();
+		currentPose = previousPose;
 	}
 }
 
@@ -14,12 +14,23 @@ public:
 	~Marble();
 
 	void Move(Input& input, float dt, DirectX::XMFLOAT2 forward, DirectX::XMFLOAT2 right);
-	void UpdateEntity();
 	void ResetPosition();
 
+	// Call just before each physics step starts (with the last
+	// one's results fetched), to keep the last two poses for
+	// interpolating between
+	void RecordPose();
+
+	// Places the entity alpha (0 to 1) of the way from the
+	// previous physics pose to the latest one
+	void UpdateEntity(float alpha);
+
 	GameEntity* GetEntity();
 private:
 	physx::PxRigidDynamic* body;
 	GameEntity* entity;
+
+	physx::PxTransform previousPose;
+	physx::PxTransform currentPose;
 };
 
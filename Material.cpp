@@ -1,5 +1,6 @@
 #include "Material.h"
 
+unsigned int Material::nextSortID = 0;
 
 
 Material::Material(
@@ -16,6 +17,7 @@ Material::Material(
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler, 
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> clampSampler)
 {
+	this->sortID = nextSortID++;
 	this->vs = vs;
 	this->ps = ps;
 	this->color = color;
@@ -28,6 +30,23 @@ Material::Material(
 	this->sampler = sampler;
 	this->clampSampler = clampSampler;
 	this->uvScale = uvScale;
+
+	// Handles work with any shader, so these stay valid
+	// even when the renderer swaps this material's shaders
+	worldHandle = ISimpleShader::GetVariableHandle("world");
+	normalMatrixHandle = ISimpleShader::GetVariableHandle("normalMatrix");
+	viewHandle = ISimpleShader::GetVariableHandle("view");
+	projectionHandle = ISimpleShader::GetVariableHandle("projection");
+	uvScaleHandle = ISimpleShader::GetVariableHandle("uvScale");
+	colorHandle = ISimpleShader::GetVariableHandle("Color");
+	shininessHandle = ISimpleShader::GetVariableHandle("Shininess");
+	perMaterialHandle = ISimpleShader::GetBufferHandle("perMaterial");
+	albedoHandle = ISimpleShader::GetShaderResourceViewHandle("AlbedoTexture");
+	normalHandle = ISimpleShader::GetShaderResourceViewHandle("NormalTexture");
+	roughnessHandle = ISimpleShader::GetShaderResourceViewHandle("RoughnessTexture");
+	metalHandle = ISimpleShader::GetShaderResourceViewHandle("MetalTexture");
+	basicSamplerHandle = ISimpleShader::GetSamplerHandle("BasicSampler");
+	clampSamplerHandle = ISimpleShader::GetSamplerHandle("ClampSampler");
 }
 
 
@@ -42,49 +61,49 @@ void Material::PrepareMaterial(Transform* transform, Camera* cam)
 	ps->SetShader();
 	
 	// Set vertex shader data
-	vs->SetMatrix4x4("world", transform->GetWorldMatrix());
-	vs->SetMatrix4x4("worldInverseTranspose", transform->GetWorldInverseTransposeMatrix());
-	vs->SetMatrix4x4("view", cam->GetView());
-	vs->SetMatrix4x4("projection", cam->GetProjection());
-	vs->SetFloat2("uvScale", uvScale);
+	vs->SetMatrix4x4(worldHandle, transform->GetWorldMatrix());
+	vs->SetData(normalMatrixHandle, &transform->GetNormalMatrix(), sizeof(NormalMatrix));
+	vs->SetMatrix4x4(viewHandle, cam->GetView());
+	vs->SetMatrix4x4(projectionHandle, cam->GetProjection());
+	vs->SetFloat2(uvScaleHandle, uvScale);
 	vs->CopyAllBufferData();
 
 	// Set pixel shader data
-	ps->SetFloat4("Color", color); 
-	ps->SetFloat("Shininess", shininess);
-	ps->CopyBufferData("perMaterial");
+	ps->SetFloat4(colorHandle, color); 
+	ps->SetFloat(shininessHandle, shininess);
+	ps->CopyBufferData(perMaterialHandle);
 
 	// Set SRVs
-	ps->SetShaderResourceView("AlbedoTexture", albedoSRV);
-	ps->SetShaderResourceView("NormalTexture", normalSRV);
-	ps->SetShaderResourceView("RoughnessTexture", roughnessSRV);
-	ps->SetShaderResourceView("MetalTexture", metalSRV);
+	ps->SetShaderResourceView(albedoHandle, albedoSRV);
+	ps->SetShaderResourceView(normalHandle, normalSRV);
+	ps->SetShaderResourceView(roughnessHandle, roughnessSRV);
+	ps->SetShaderResourceView(metalHandle, metalSRV);
 
 	// Set sampler
-	ps->SetSamplerState("BasicSampler", sampler);
-	ps->SetSamplerState("ClampSampler", clampSampler);
+	ps->SetSamplerState(basicSamplerHandle, sampler);
+	ps->SetSamplerState(clampSamplerHandle, clampSampler);
 }
 
 void Material::SetPerMaterialDataAndResources(bool copyToGPUNow)
 {
-	vs->SetFloat2("uvScale", uvScale);
+	vs->SetFloat2(uvScaleHandle, uvScale);
 	if (copyToGPUNow) {
-		vs->CopyBufferData("perMaterial");
+		vs->CopyBufferData(perMaterialHandle);
 	}
 
-	ps->SetFloat4("Color", color);
-	ps->SetFloat("Shininess", shininess);
+	ps->SetFloat4(colorHandle, color);
+	ps->SetFloat(shininessHandle, shininess);
 	if (copyToGPUNow) {
-		ps->CopyBufferData("perMaterial");
+		ps->CopyBufferData(perMaterialHandle);
 	}
 
 	// Set SRVs
-	ps->SetShaderResourceView("AlbedoTexture", albedoSRV);
-	ps->SetShaderResourceView("NormalTexture", normalSRV);
-	ps->SetShaderResourceView("RoughnessTexture", roughnessSRV);
-	ps->SetShaderResourceView("MetalTexture", metalSRV);
+	ps->SetShaderResourceView(albedoHandle, albedoSRV);
+	ps->SetShaderResourceView(normalHandle, normalSRV);
+	ps->SetShaderResourceView(roughnessHandle, roughnessSRV);
+	ps->SetShaderResourceView(metalHandle, metalSRV);
 
 	// Set sampler
-	ps->SetSamplerState("BasicSampler", sampler);
-	ps->SetSamplerState("ClampSampler", clampSampler);
+	ps->SetSamplerState(basicSamplerHandle, sampler);
+	ps->SetSamplerState(clampSamplerHandle, clampSampler);
 }
@@ -34,6 +34,7 @@ public:
 	DirectX::XMFLOAT4 GetColor() { return color; }
 	float GetShininess() { return shininess; }
 	bool IsRefractive() { return isRefractive; }
+	unsigned int GetSortID() { return sortID; }
 
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetAlbedo() { return albedoSRV; }
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetNormal() { return normalSRV; }
@@ -63,11 +64,31 @@ private:
 	float shininess;
 	bool isRefractive;
 
+	// Small unique id for render sort keys
+	unsigned int sortID;
+	static unsigned int nextSortID;
+
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> albedoSRV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> normalSRV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> roughnessSRV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalSRV;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> clampSampler;
+
+	// Shader handles, resolved once so drawing doesn't look up names
+	SimpleVariableHandle worldHandle;
+	SimpleVariableHandle normalMatrixHandle;
+	SimpleVariableHandle viewHandle;
+	SimpleVariableHandle projectionHandle;
+	SimpleVariableHandle uvScaleHandle;
+	SimpleVariableHandle colorHandle;
+	SimpleVariableHandle shininessHandle;
+	SimpleBufferHandle perMaterialHandle;
+	SimpleSRVHandle albedoHandle;
+	SimpleSRVHandle normalHandle;
+	SimpleSRVHandle roughnessHandle;
+	SimpleSRVHandle metalHandle;
+	SimpleSamplerHandle basicSamplerHandle;
+	SimpleSamplerHandle clampSamplerHandle;
 };
 
@@ -1,4 +1,6 @@
 #include "Mesh.h"
+#include "FileTimes.h"
+#include "VertexCompression.h"
 #include <DirectXMath.h>
 #include <fstream>
 
@@ -8,107 +10,292 @@
 
 using namespace DirectX;
 
-Mesh::Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device)
+unsigned int Mesh::nextSortID = 0;
+
+Mesh::Mesh(const Vertex* vertArray, int numVerts, const unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device)
+	: Mesh()
 {
 	CreateBuffers(vertArray, numVerts, indexArray, numIndices, device);
 }
 
 Mesh::Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> device)
+	: Mesh()
+{
+	sourceFile = objFile;
+
+	// A current cache file already holds the final vertices, indices,
+	// submeshes and bounds, so all that's left is the upload
+	std::string cacheFile = MeshCacheFile::GetCacheFileName(objFile);
+	if (FileTimes::IsUpToDate(objFile, cacheFile.c_str()) && cache.Open(cacheFile) && cache.GetHeader()->SubmeshCount > 0) {
+		// The CPU geometry is read straight out of the mapping rather than
+		// copied, so it's just file backed pages until it's released
+		const MeshCacheHeader* header = cache.GetHeader();
+		cpuVertices = ArrayView<Vertex>(cache.GetVertices(), header->VertexCount);
+		cpuIndices = ArrayView<unsigned int>(cache.GetIndices(), header->IndexCount);
+		submeshes.assign(cache.GetSubmeshes(), cache.GetSubmeshes() + header->SubmeshCount);
+		localAABB = header->LocalAABB;
+		localSphere = header->LocalSphere;
+
+		UploadBuffers(cache.GetVertices(), sizeof(Vertex), header->VertexCount, cache.GetIndices(), header->IndexCount, device);
+		return;
+	}
+
+	// Stale or unusable, and about to be rewritten
+	cache.Close();
+
+	if (!ImportModel(objFile, vertices, indices, submeshes, &localAABB, &localSphere))
+		return;
+
+	cpuVertices = ArrayView<Vertex>(&vertices[0], vertices.size());
+	cpuIndices = ArrayView<unsigned int>(&indices[0], indices.size());
+
+	UploadBuffers(&vertices[0], sizeof(Vertex), (int)vertices.size(), &indices[0], (int)indices.size(), device);
+
+	// Save the results so the next load can skip Assimp entirely
+	MeshCacheFile::Write(cacheFile, &vertices[0], (unsigned int)vertices.size(), &indices[0], (unsigned int)indices.size(), &submeshes[0], (unsigned int)submeshes.size(), localAABB, localSphere);
+}
+
+bool Mesh::ImportModel(const char* modelFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices, std::vector<Submesh>& submeshes, AABB* aabb, Sphere* sphere, VertexCacheStats* before, VertexCacheStats* after)
 {
 	// create importer
 	Assimp::Importer importer;
 
 	// create the file and process it as necessary
-	const aiScene* scene = importer.ReadFile(objFile,
-		aiProcess_CalcTangentSpace | 
+	// (tangents are calculated below, so Assimp doesn't need to)
+	const aiScene* scene = importer.ReadFile(modelFile,
 		aiProcess_Triangulate | 
 		aiProcess_JoinIdenticalVertices | 
 		aiProcess_SortByPType | 
 		aiProcess_ConvertToLeftHanded);
 
-	if (!scene) {
+	if (!scene || scene->mNumMeshes == 0) {
 		printf("Error loading model!\n" );
+		return false;
 	}
 
-	// Grab the first mesh
-	aiMesh* mesh = scene->mMeshes[0];
-
-	// build vertices
-	for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-		Vertex v = {};
-		v.Position.x = mesh->mVertices[i].x;
-		v.Position.y = mesh->mVertices[i].y;
-		v.Position.z = mesh->mVertices[i].z;
+	// Size everything up front so the loop below only copies
+	unsigned int totalVerts = 0;
+	unsigned int totalIndices = 0;
+	for (unsigned int m = 0; m < scene->mNumMeshes; m++) {
+		totalVerts += scene->mMeshes[m]->mNumVertices;
+		totalIndices += scene->mMeshes[m]->mNumFaces * 3;
+	}
 
-		if (mesh->HasNormals()) {
-			v.Normal.x = mesh->mNormals[i].x;
-			v.Normal.y = mesh->mNormals[i].y;
-			v.Normal.z = mesh->mNormals[i].z;
+	verts.clear();
+	indices.clear();
+	submeshes.clear();
+	verts.reserve(totalVerts);
+	indices.reserve(totalIndices);
+
+	VertexCacheStats totalBefore = {};
+	VertexCacheStats totalAfter = {};
+
+	// Pack every mesh in the file into the same arrays, one
+	// submesh each, with indices relative to the submesh's
+	// first vertex
+	for (unsigned int m = 0; m < scene->mNumMeshes; m++) {
+		aiMesh* mesh = scene->mMeshes[m];
+
+		// SortByPType splits out any points and lines, which we can't draw
+		if (mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE)
+			continue;
+
+		Submesh submesh;
+		submesh.IndexStart = (unsigned int)indices.size();
+		submesh.BaseVertex = (unsigned int)verts.size();
+		submesh.MaterialIndex = mesh->mMaterialIndex;
+
+		// build vertices
+		verts.resize(submesh.BaseVertex + mesh->mNumVertices);
+		for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+			Vertex& v = verts[submesh.BaseVertex + i];
+			v = {};
+			v.Position.x = mesh->mVertices[i].x;
+			v.Position.y = mesh->mVertices[i].y;
+			v.Position.z = mesh->mVertices[i].z;
+
+			if (mesh->HasNormals()) {
+				v.Normal.x = mesh->mNormals[i].x;
+				v.Normal.y = mesh->mNormals[i].y;
+				v.Normal.z = mesh->mNormals[i].z;
+			}
+
+			if (mesh->HasTextureCoords(0)) {
+				v.UV.x = mesh->mTextureCoords[0][i].x;
+				v.UV.y = mesh->mTextureCoords[0][i].y;
+			}
 		}
 
-		if (mesh->HasTextureCoords(0)) {
-			v.UV.x = mesh->mTextureCoords[0][i].x;
-			v.UV.y = mesh->mTextureCoords[0][i].y;
+		// build indices (everything is a triangle after Triangulate)
+		for (unsigned int f = 0; f < mesh->mNumFaces; f++) {
+			for (unsigned int i = 0; i < mesh->mFaces[f].mNumIndices; i++) {
+				indices.push_back(mesh->mFaces[f].mIndices[i]);
+			}
 		}
 
-		if (mesh->HasTangentsAndBitangents()) {
-			v.Tangent.x = mesh->mTangents[i].x;
-			v.Tangent.y = mesh->mTangents[i].y;
-			v.Tangent.z = mesh->mTangents[i].z;
-		}
+		submesh.IndexCount = (unsigned int)indices.size() - submesh.IndexStart;
+		if (submesh.IndexCount == 0)
+			continue;
 
-		vertices.push_back(v);
-	}
+		// Reorder for the vertex cache, overdraw and fetch - each submesh is
+		// drawn on its own, so each is optimized on its own
+		VertexCacheStats submeshBefore, submeshAfter;
+		MeshOptimizer::Optimize(&verts[submesh.BaseVertex], sizeof(Vertex), mesh->mNumVertices, &indices[submesh.IndexStart], submesh.IndexCount, &submeshBefore, &submeshAfter);
+		MeshOptimizer::AccumulateStats(&totalBefore, submeshBefore);
+		MeshOptimizer::AccumulateStats(&totalAfter, submeshAfter);
 
-	// build indices
-	for (unsigned int f = 0; f < mesh->mNumFaces; f++) {
-		for (unsigned int i = 0; i < mesh->mFaces[f].mNumIndices; i++) {
-			unsigned int index = mesh->mFaces[f].mIndices[i];
-			indices.push_back(index);
-		}
+		// Tangents only ever need the submesh's own triangles
+		CalculateTangents(&verts[submesh.BaseVertex], mesh->mNumVertices, &indices[submesh.IndexStart], submesh.IndexCount);
+		submeshes.push_back(submesh);
 	}
 
-	CreateBuffers(&vertices[0], (int)vertices.size(), &indices[0], (int)indices.size(), device);
+	if (submeshes.empty())
+		return false;
+
+	if (before) *before = totalBefore;
+	if (after) *after = totalAfter;
+
+	CalculateBounds(&verts[0], (int)verts.size(), aabb, sphere);
+	return true;
 }
 
-Mesh::Mesh() { }
+Mesh::Mesh()
+{
+	sortID = nextSortID++;
+	numVertices = 0;
+	numIndices = 0;
+	vertexFormat = MESH_VERTEX_FULL;
+	vertexStride = sizeof(Vertex);
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	positionOffset = XMFLOAT3(0, 0, 0);
+	positionScale = XMFLOAT3(1, 1, 1);
+}
 
 
 Mesh::~Mesh(void) { }
 
+// --------------------------------------------------------
+// Frees (or unmaps) the CPU side geometry once nothing else
+// needs it - the GPU buffers are all drawing uses
+// --------------------------------------------------------
+void Mesh::ReleaseCPUGeometry()
+{
+	cpuVertices = ArrayView<Vertex>();
+	cpuIndices = ArrayView<unsigned int>();
+
+	// swap rather than clear, so the capacity actually goes away
+	std::vector<Vertex>().swap(vertices);
+	std::vector<unsigned int>().swap(indices);
+	cache.Close();
+}
+
 
-void Mesh::CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device)
+void Mesh::CreateBuffers(const Vertex* sourceVerts, int numVerts, const unsigned int* sourceIndices, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device, MeshVertexFormat format)
 {
+	// Generated meshes (like terrain) come out in whatever order was
+	// easiest to build, so reorder them the same way imports are -
+	// on a copy, since the caller's arrays may be laid out on purpose
+	std::vector<Vertex> vertexCopy(sourceVerts, sourceVerts + numVerts);
+	std::vector<unsigned int> indexCopy(sourceIndices, sourceIndices + numIndices);
+	Vertex* vertArray = vertexCopy.data();
+	unsigned int* indexArray = indexCopy.data();
+	MeshOptimizer::Optimize(vertArray, sizeof(Vertex), numVerts, indexArray, numIndices, 0, 0);
+
 	// Always calculate the tangents before copying to buffer
 	CalculateTangents(vertArray, numVerts, indexArray, numIndices);
 
+	// Bounds are needed for culling, so grab them while we have the data
+	CalculateBounds(vertArray, numVerts, &localAABB, &localSphere);
+
+	// Meshes built in code are a single submesh
+	Submesh whole = { 0, (unsigned int)numIndices, 0, 0 };
+	submeshes.assign(1, whole);
+
+	if (format == MESH_VERTEX_COMPACT) {
+		std::vector<CompactVertex> compact(numVerts);
+		CompressVertices(vertArray, numVerts, &compact[0]);
+		vertexFormat = MESH_VERTEX_COMPACT;
+		UploadBuffers(&compact[0], sizeof(CompactVertex), numVerts, indexArray, numIndices, device);
+		return;
+	}
+
+	UploadBuffers(vertArray, sizeof(Vertex), numVerts, indexArray, numIndices, device);
+}
+
+// Packs vertices into CompactVertex, quantizing positions across
+// the bounds (which must already be calculated)
+void Mesh::CompressVertices(const Vertex* verts, int numVerts, CompactVertex* compact)
+{
+	XMVECTOR center = XMLoadFloat3(&localAABB.Center);
+	XMVECTOR extents = XMLoadFloat3(&localAABB.Extents);
+	XMStoreFloat3(&positionOffset, center - extents);
+	XMStoreFloat3(&positionScale, extents * 2.0f);
+
+	for (int i = 0; i < numVerts; i++) {
+		const Vertex& v = verts[i];
+		CompactVertex& c = compact[i];
+
+		c.Position[0] = VertexCompression::QuantizeUnorm16(v.Position.x, positionOffset.x, positionScale.x);
+		c.Position[1] = VertexCompression::QuantizeUnorm16(v.Position.y, positionOffset.y, positionScale.y);
+		c.Position[2] = VertexCompression::QuantizeUnorm16(v.Position.z, positionOffset.z, positionScale.z);
+		c.Position[3] = 0;
+
+		c.UV[0] = VertexCompression::FloatToHalf(v.UV.x);
+		c.UV[1] = VertexCompression::FloatToHalf(v.UV.y);
+
+		VertexCompression::EncodeOctahedral(&v.Normal.x, c.Normal);
+		VertexCompression::EncodeOctahedral(&v.Tangent.x, c.Tangent);
+	}
+}
 
+void Mesh::UploadBuffers(const void* vertexData, unsigned int stride, int numVerts, const unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device)
+{
 	// Create the vertex buffer
 	D3D11_BUFFER_DESC vbd;
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * numVerts; // Number of vertices
+	vbd.ByteWidth = stride * numVerts; // Number of vertices
 	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	vbd.CPUAccessFlags = 0;
 	vbd.MiscFlags = 0;
 	vbd.StructureByteStride = 0;
 	D3D11_SUBRESOURCE_DATA initialVertexData;
-	initialVertexData.pSysMem = vertArray;
+	initialVertexData.pSysMem = vertexData;
 	device->CreateBuffer(&vbd, &initialVertexData, vb.GetAddressOf());
 
 	// Create the index buffer
+	indexFormat = CreateIndexBuffer(device, indexArray, numIndices, ib.ReleaseAndGetAddressOf());
+
+	// Save the counts and vertex size
+	this->numVertices = numVerts;
+	this->numIndices = numIndices;
+	this->vertexStride = stride;
+}
+
+DXGI_FORMAT Mesh::CreateIndexBuffer(Microsoft::WRL::ComPtr<ID3D11Device> device, const unsigned int* indices, int numIndices, ID3D11Buffer** buffer)
+{
+	// Submesh indices are relative to their base vertex, so this only
+	// depends on the largest submesh rather than the whole mesh
+	unsigned int maxIndex = 0;
+	for (int i = 0; i < numIndices; i++)
+		if (indices[i] > maxIndex) maxIndex = indices[i];
+
+	std::vector<unsigned short> shortIndices;
+	bool useShort = maxIndex <= 0xFFFF;
+	if (useShort)
+		shortIndices.assign(indices, indices + numIndices);
+
 	D3D11_BUFFER_DESC ibd;
 	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * numIndices; // Number of indices
+	ibd.ByteWidth = (useShort ? sizeof(unsigned short) : sizeof(unsigned int)) * numIndices; // Number of indices
 	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	ibd.CPUAccessFlags = 0;
 	ibd.MiscFlags = 0;
 	ibd.StructureByteStride = 0;
 	D3D11_SUBRESOURCE_DATA initialIndexData;
-	initialIndexData.pSysMem = indexArray;
-	device->CreateBuffer(&ibd, &initialIndexData, ib.GetAddressOf());
+	initialIndexData.pSysMem = useShort ? (const void*)shortIndices.data() : (const void*)indices;
+	device->CreateBuffer(&ibd, &initialIndexData, buffer);
 
-	// Save the indices
-	this->numIndices = numIndices;
+	return useShort ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
 }
 
 
@@ -188,17 +375,60 @@ void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices,
 	}
 }
 
+// Calculates an AABB around all vertices, then a sphere centered
+// on that box which is just big enough to hold every vertex
+void Mesh::CalculateBounds(Vertex* verts, int numVerts, AABB* aabb, Sphere* sphere)
+{
+	*aabb = {};
+	*sphere = {};
+	if (numVerts <= 0)
+		return;
+
+	XMVECTOR minPos = XMLoadFloat3(&verts[0].Position);
+	XMVECTOR maxPos = minPos;
+	for (int i = 1; i < numVerts; i++)
+	{
+		XMVECTOR pos = XMLoadFloat3(&verts[i].Position);
+		minPos = XMVectorMin(minPos, pos);
+		maxPos = XMVectorMax(maxPos, pos);
+	}
 
+	XMVECTOR center = (minPos + maxPos) * 0.5f;
+	XMStoreFloat3(&aabb->Center, center);
+	XMStoreFloat3(&aabb->Extents, (maxPos - minPos) * 0.5f);
+
+	// Tighter than the box's half diagonal for round meshes
+	XMVECTOR maxDistSq = XMVectorZero();
+	for (int i = 0; i < numVerts; i++)
+	{
+		XMVECTOR pos = XMLoadFloat3(&verts[i].Position);
+		maxDistSq = XMVectorMax(maxDistSq, XMVector3LengthSq(pos - center));
+	}
 
+	sphere->Center = aabb->Center;
+	sphere->Radius = sqrtf(XMVectorGetX(maxDistSq));
+}
 
-void Mesh::SetBuffersAndDraw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+void Mesh::SetBuffers(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
 {
 	// Set buffers in the input assembler
-	UINT stride = sizeof(Vertex);
+	UINT stride = vertexStride;
 	UINT offset = 0;
 	context->IASetVertexBuffers(0, 1, vb.GetAddressOf(), &stride, &offset);
-	context->IASetIndexBuffer(ib.Get(), DXGI_FORMAT_R32_UINT, 0);
+	context->IASetIndexBuffer(ib.Get(), indexFormat, 0);
+}
+
+void Mesh::DrawSubmesh(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, unsigned int submesh)
+{
+	const Submesh& s = submeshes[submesh];
+	context->DrawIndexed(s.IndexCount, s.IndexStart, s.BaseVertex);
+}
+
+void Mesh::SetBuffersAndDraw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+{
+	SetBuffers(context);
 
-	// Draw this mesh
-	context->DrawIndexed(this->numIndices, 0, 0);
+	// Draw every submesh with whatever material is already set
+	for (unsigned int i = 0; i < submeshes.size(); i++)
+		DrawSubmesh(context, i);
 }
@@ -4,13 +4,28 @@
 #include <wrl/client.h>
 
 #include "Vertex.h"
+#include "Bounds.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "ArrayView.h"
 
+#include <string>
 #include <vector>
 
+// What's actually in a mesh's vertex buffer - Vertex, or the
+// packed CompactVertex, which needs a shader that decodes it
+enum MeshVertexFormat
+{
+	MESH_VERTEX_FULL,
+	MESH_VERTEX_COMPACT
+};
+
 class Mesh
 {
 public:
-	Mesh(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device);
+	// Copies the arrays, optimizing and adding tangents to the
+	// copies - the caller's data is left as it was
+	Mesh(const Vertex* vertArray, int numVerts, const unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device);
 	Mesh(const char* objFile, Microsoft::WRL::ComPtr<ID3D11Device> device);
 	Mesh();
 	~Mesh(void);
@@ -18,22 +33,92 @@ public:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer() { return vb; }
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer() { return ib; }
 
-	std::vector<Vertex> GetVertices() { return vertices; }
-	int GetNumVertices() { return vertices.size(); }
-	std::vector<unsigned int> GetIndices() { return indices; }
+	int GetNumVertices() { return numVertices; }
 	int GetIndexCount() { return numIndices; }
+	unsigned int GetSortID() { return sortID; }
+
+	// Model file the mesh was loaded from, or empty if built in code
+	const std::string& GetSourceFile() { return sourceFile; }
+
+	MeshVertexFormat GetVertexFormat() { return vertexFormat; }
+	unsigned int GetVertexStride() { return vertexStride; }
+	DXGI_FORMAT GetIndexFormat() { return indexFormat; }
+
+	// Compact positions are stored in [0, 1] across the mesh's bounds,
+	// and decode as offset + position * scale
+	DirectX::XMFLOAT3 GetPositionOffset() { return positionOffset; }
+	DirectX::XMFLOAT3 GetPositionScale() { return positionScale; }
+
+	// Ranges of the shared buffers, each with its own material slot
+	unsigned int GetSubmeshCount() { return (unsigned int)submeshes.size(); }
+	const Submesh& GetSubmesh(unsigned int index) { return submeshes[index]; }
+	ArrayView<Submesh> GetSubmeshes() { return ArrayView<Submesh>(submeshes.data(), submeshes.size()); }
+
+	// Object space bounds, calculated when the buffers are made
+	AABB GetLocalAABB() { return localAABB; }
+	Sphere GetLocalSphere() { return localSphere; }
 
+	// CPU side copy of what's in the buffers, for things like cooking
+	// collision.  Loaded meshes keep it (in the mapped cache file when
+	// there is one) until it's released, and meshes built in code only
+	// ever have the GPU buffers.  Indices are relative to each
+	// submesh's BaseVertex, just like the index buffer.
+	ArrayView<Vertex> GetVertices() { return cpuVertices; }
+	ArrayView<unsigned int> GetIndices() { return cpuIndices; }
+	bool HasCPUGeometry() { return !cpuVertices.Empty(); }
+	size_t GetCPUGeometryBytes() { return cpuVertices.SizeInBytes() + cpuIndices.SizeInBytes(); }
+	void ReleaseCPUGeometry();
+
+	// Binding once and drawing several submeshes only needs SetBuffers
+	// followed by DrawSubmesh for each
+	void SetBuffers(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	void DrawSubmesh(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, unsigned int submesh);
 	void SetBuffersAndDraw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
 
+	// Creates an immutable index buffer, with 16-bit indices if every
+	// index fits, and returns the format to bind it with
+	static DXGI_FORMAT CreateIndexBuffer(Microsoft::WRL::ComPtr<ID3D11Device> device, const unsigned int* indices, int numIndices, ID3D11Buffer** buffer);
+
+	// Loads every mesh in a model through Assimp into one set of arrays
+	// and does all of the CPU side work (optimization, tangents, bounds),
+	// leaving exactly what gets cached and uploaded.  Vertex cache stats
+	// from before and after optimizing are optional.
+	static bool ImportModel(const char* modelFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices, std::vector<Submesh>& submeshes, AABB* aabb, Sphere* sphere, VertexCacheStats* before = 0, VertexCacheStats* after = 0);
+
 protected:
+	// Owned CPU geometry when the mesh was imported, or the mapped
+	// cache it was loaded from - the views point into one of them
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
+	MeshCacheFile cache;
+	ArrayView<Vertex> cpuVertices;
+	ArrayView<unsigned int> cpuIndices;
+
+	std::vector<Submesh> submeshes;
+	std::string sourceFile;
 
 	Microsoft::WRL::ComPtr<ID3D11Buffer> vb;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> ib;
+	int numVertices;
 	int numIndices;
 
-	void CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device);
-	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	MeshVertexFormat vertexFormat;
+	unsigned int vertexStride;
+	DXGI_FORMAT indexFormat;
+	DirectX::XMFLOAT3 positionOffset;
+	DirectX::XMFLOAT3 positionScale;
+
+	// Small unique id for render sort keys
+	unsigned int sortID;
+	static unsigned int nextSortID;
+
+	AABB localAABB;
+	Sphere localSphere;
+
+	void CreateBuffers(const Vertex* sourceVerts, int numVerts, const unsigned int* sourceIndices, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device, MeshVertexFormat format = MESH_VERTEX_FULL);
+	void UploadBuffers(const void* vertexData, unsigned int stride, int numVerts, const unsigned int* indexArray, int numIndices, Microsoft::WRL::ComPtr<ID3D11Device> device);
+	void CompressVertices(const Vertex* verts, int numVerts, CompactVertex* compact);
+	static void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	static void CalculateBounds(Vertex* verts, int numVerts, AABB* aabb, Sphere* sphere);
 };
 
@@ -0,0 +1,158 @@
+#include "MeshCache.h"
+
+#include <fstream>
+
+// --------------------------------------------------------
+// Every submesh's range has to fit in the index array, and
+// every index in it (after adding its BaseVertex) has to land
+// in the vertex array, or drawing or cooking collision from
+// the mapping would read past the end of it
+// --------------------------------------------------------
+static bool SubmeshesInBounds(const MeshCacheHeader* h, const unsigned int* indices, const Submesh* submeshes)
+{
+	for (uint32_t s = 0; s < h->SubmeshCount; s++)
+	{
+		const Submesh& submesh = submeshes[s];
+		if (submesh.IndexStart > h->IndexCount ||
+			submesh.IndexCount > h->IndexCount - submesh.IndexStart ||
+			submesh.BaseVertex >= h->VertexCount)
+			return false;
+
+		unsigned int verticesLeft = h->VertexCount - submesh.BaseVertex;
+		for (unsigned int i = 0; i < submesh.IndexCount; i++)
+		{
+			if (indices[submesh.IndexStart + i] >= verticesLeft)
+				return false;
+		}
+	}
+	return true;
+}
+
+MeshCacheFile::MeshCacheFile() :
+	file(INVALID_HANDLE_VALUE),
+	mapping(0),
+	view(0),
+	header(0)
+{
+}
+
+MeshCacheFile::~MeshCacheFile()
+{
+	Close();
+}
+
+bool MeshCacheFile::Open(const std::string& path)
+{
+	Close();
+
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(MeshCacheHeader))
+	{
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (mapping)
+		view = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+	{
+		Close();
+		return false;
+	}
+
+	// Check the header before trusting any of the counts
+	const MeshCacheHeader* h = (const MeshCacheHeader*)view;
+	unsigned long long expectedSize =
+		sizeof(MeshCacheHeader) +
+		(unsigned long long)h->VertexCount * sizeof(Vertex) +
+		(unsigned long long)h->IndexCount * sizeof(unsigned int) +
+		(unsigned long long)h->SubmeshCount * sizeof(Submesh);
+
+	if (h->Magic != MESH_CACHE_MAGIC ||
+		h->Version != MESH_CACHE_VERSION ||
+		h->VertexStride != sizeof(Vertex) ||
+		expectedSize != (unsigned long long)fileSize.QuadPart)
+	{
+		Close();
+		return false;
+	}
+
+	// The counts are good, so the ranges can be checked against them
+	header = h;
+	if (!SubmeshesInBounds(header, GetIndices(), GetSubmeshes()))
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MeshCacheFile::Close()
+{
+	if (view) UnmapViewOfFile(view);
+	if (mapping) CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+
+	file = INVALID_HANDLE_VALUE;
+	mapping = 0;
+	view = 0;
+	header = 0;
+}
+
+const Vertex* MeshCacheFile::GetVertices()
+{
+	return (const Vertex*)(view + sizeof(MeshCacheHeader));
+}
+
+const unsigned int* MeshCacheFile::GetIndices()
+{
+	return (const unsigned int*)(GetVertices() + header->VertexCount);
+}
+
+const Submesh* MeshCacheFile::GetSubmeshes()
+{
+	return (const Submesh*)(GetIndices() + header->IndexCount);
+}
+
+bool MeshCacheFile::Write(
+	const std::string& path,
+	const Vertex* vertices, unsigned int vertexCount,
+	const unsigned int* indices, unsigned int indexCount,
+	const Submesh* submeshes, unsigned int submeshCount,
+	AABB localAABB, Sphere localSphere)
+{
+	MeshCacheHeader h = {};
+	h.Magic = MESH_CACHE_MAGIC;
+	h.Version = MESH_CACHE_VERSION;
+	h.VertexStride = sizeof(Vertex);
+	h.VertexCount = vertexCount;
+	h.IndexCount = indexCount;
+	h.SubmeshCount = submeshCount;
+	h.LocalAABB = localAABB;
+	h.LocalSphere = localSphere;
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	out.write((const char*)&h, sizeof(h));
+	out.write((const char*)vertices, sizeof(Vertex) * vertexCount);
+	out.write((const char*)indices, sizeof(unsigned int) * indexCount);
+	out.write((const char*)submeshes, sizeof(Submesh) * submeshCount);
+	return out.good();
+}
+
+std::string MeshCacheFile::GetCacheFileName(const char* modelFile)
+{
+	std::string name(modelFile);
+	size_t dot = name.find_last_of('.');
+	size_t slash = name.find_last_of("/\\");
+	if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		name.erase(dot);
+	return name + ".meshcache";
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Windows.h>
+#include <stdint.h>
+#include <string>
+
+#include "Vertex.h"
+#include "Bounds.h"
+#include "Submesh.h"
+
+// --------------------------------------------------------
+// Cache file layout - the header, then the vertex array,
+// index array and submesh table, each exactly as the mesh
+// uses them.  The whole file is mapped and read in place,
+// so the version and vertex stride must match this build.
+// --------------------------------------------------------
+#define MESH_CACHE_MAGIC 0x4853454Du // "MESH"
+#define MESH_CACHE_VERSION 3
+
+struct MeshCacheHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t VertexStride;
+	uint32_t VertexCount;
+	uint32_t IndexCount;
+	uint32_t SubmeshCount;
+	AABB LocalAABB;
+	Sphere LocalSphere;
+};
+
+// --------------------------------------------------------
+// Read-only view of a memory mapped mesh cache file
+// --------------------------------------------------------
+class MeshCacheFile
+{
+public:
+	MeshCacheFile();
+	~MeshCacheFile();
+	MeshCacheFile(const MeshCacheFile&) = delete;
+	MeshCacheFile& operator=(const MeshCacheFile&) = delete;
+
+	// Maps the file and checks the header, sizes and submesh
+	// ranges, failing (so the cache gets rebuilt) on anything off
+	bool Open(const std::string& path);
+	void Close();
+
+	const MeshCacheHeader* GetHeader() { return header; }
+	const Vertex* GetVertices();
+	const unsigned int* GetIndices();
+	const Submesh* GetSubmeshes();
+
+	static bool Write(
+		const std::string& path,
+		const Vertex* vertices, unsigned int vertexCount,
+		const unsigned int* indices, unsigned int indexCount,
+		const Submesh* submeshes, unsigned int submeshCount,
+		AABB localAABB, Sphere localSphere);
+
+	// "Models/sphere.obj" -> "Models/sphere.meshcache"
+	static std::string GetCacheFileName(const char* modelFile);
+
+private:
+	HANDLE file;
+	HANDLE mapping;
+	const unsigned char* view;
+	const MeshCacheHeader* header;
+};
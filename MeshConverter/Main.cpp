@@ -0,0 +1,201 @@
+#include "../FileTimes.h"
+#include "../Mesh.h"
+#include "../MeshCache.h"
+#include "../LevelFile.h"
+
+#include <chrono>
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Command line mesh converter
+//
+//   MeshConverter model.obj [more models...]
+//     Imports each model through Assimp and writes the final
+//     vertices, indices, bounds and submeshes to a .meshcache
+//     file next to it - the same file the game writes itself
+//     the first time it loads a model.  Prints simulated vertex
+//     cache stats from before and after optimizing each one.
+//
+//   MeshConverter -benchmark model.obj [more models...]
+//     Times loading each model through Assimp against loading
+//     it from its cache (writing the cache first if needed).
+//     Neither side includes the GPU upload, which is the same.
+//
+// Text levels (.level files) can be given in place of models,
+// and are converted to the binary .levelbin the game loads, or
+// benchmarked parsing the text against reading the binary.
+// --------------------------------------------------------
+
+#define BENCHMARK_ITERATIONS 20
+
+static bool Convert(const char* modelFile)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	std::vector<Submesh> submeshes;
+	AABB aabb;
+	Sphere sphere;
+	VertexCacheStats before, after;
+	if (!Mesh::ImportModel(modelFile, verts, indices, submeshes, &aabb, &sphere, &before, &after))
+	{
+		printf("%s: import failed\n", modelFile);
+		return false;
+	}
+
+	std::string cacheFile = MeshCacheFile::GetCacheFileName(modelFile);
+	if (!MeshCacheFile::Write(cacheFile, &verts[0], (unsigned int)verts.size(), &indices[0], (unsigned int)indices.size(), &submeshes[0], (unsigned int)submeshes.size(), aabb, sphere))
+	{
+		printf("%s: couldn't write %s\n", modelFile, cacheFile.c_str());
+		return false;
+	}
+
+	printf("%s -> %s (%u verts, %u indices, %u submeshes)\n", modelFile, cacheFile.c_str(), (unsigned int)verts.size(), (unsigned int)indices.size(), (unsigned int)submeshes.size());
+	printf("  ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (cache size %u)\n", before.ACMR, after.ACMR, before.ATVR, after.ATVR, MeshOptimizer::CacheSize);
+	return true;
+}
+
+static void Benchmark(const char* modelFile)
+{
+	std::string cacheFile = MeshCacheFile::GetCacheFileName(modelFile);
+	if (!FileTimes::IsUpToDate(modelFile, cacheFile.c_str()) && !Convert(modelFile))
+		return;
+
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	std::vector<Submesh> submeshes;
+	AABB aabb;
+	Sphere sphere;
+
+	// Assimp import plus tangents and bounds, like an uncached Mesh
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		Mesh::ImportModel(modelFile, verts, indices, submeshes, &aabb, &sphere);
+	auto end = std::chrono::high_resolution_clock::now();
+	float importMilliseconds = std::chrono::duration<float, std::milli>(end - start).count() / BENCHMARK_ITERATIONS;
+
+	// Map, check the header and copy out, like a cached Mesh
+	start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+	{
+		MeshCacheFile cache;
+		if (!cache.Open(cacheFile))
+		{
+			printf("%s: couldn't open %s\n", modelFile, cacheFile.c_str());
+			return;
+		}
+
+		const MeshCacheHeader* header = cache.GetHeader();
+		verts.assign(cache.GetVertices(), cache.GetVertices() + header->VertexCount);
+		indices.assign(cache.GetIndices(), cache.GetIndices() + header->IndexCount);
+		submeshes.assign(cache.GetSubmeshes(), cache.GetSubmeshes() + header->SubmeshCount);
+	}
+	end = std::chrono::high_resolution_clock::now();
+	float cacheMilliseconds = std::chrono::duration<float, std::milli>(end - start).count() / BENCHMARK_ITERATIONS;
+
+	printf("%-40s import %8.3f ms   cache %8.3f ms   (%.1fx)\n",
+		modelFile,
+		importMilliseconds,
+		cacheMilliseconds,
+		cacheMilliseconds > 0 ? importMilliseconds / cacheMilliseconds : 0.0f);
+}
+
+static bool IsLevelFile(const char* file)
+{
+	size_t length = strlen(file);
+	return length > 6 && strcmp(file + length - 6, ".level") == 0;
+}
+
+static bool ConvertLevel(const char* levelFile)
+{
+	LevelData level;
+	std::string error;
+	if (!LevelFile::Load(levelFile, &level, &error))
+	{
+		printf("%s: %s\n", levelFile, error.c_str());
+		return false;
+	}
+
+	std::string binaryFile = LevelFile::GetBinaryFileName(levelFile);
+	if (!LevelFile::SaveBinary(binaryFile, level))
+	{
+		printf("%s: couldn't write %s\n", levelFile, binaryFile.c_str());
+		return false;
+	}
+
+	printf("%s -> %s (%u blocks, %u meshes, %u materials)\n", levelFile, binaryFile.c_str(), (unsigned int)level.Blocks.size(), (unsigned int)level.MeshNames.size(), (unsigned int)level.MaterialNames.size());
+	return true;
+}
+
+// Parse and read throughput, from memory so disk speed doesn't
+// count - building the actors needs PhysX, so the game times that
+static void BenchmarkLevel(const char* levelFile)
+{
+	std::ifstream file(levelFile, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		printf("%s: couldn't open\n", levelFile);
+		return;
+	}
+	std::vector<char> text((size_t)file.tellg());
+	file.seekg(0);
+	file.read(text.data(), text.size());
+
+	LevelData level;
+	std::string error;
+	if (!LevelFile::ParseText(text.data(), text.size(), &level, &error))
+	{
+		printf("%s: %s\n", levelFile, error.c_str());
+		return;
+	}
+
+	std::vector<unsigned char> binary;
+	LevelFile::WriteBinary(level, binary);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		LevelFile::ParseText(text.data(), text.size(), &level, &error);
+	auto end = std::chrono::high_resolution_clock::now();
+	float textMilliseconds = std::chrono::duration<float, std::milli>(end - start).count() / BENCHMARK_ITERATIONS;
+
+	start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < BENCHMARK_ITERATIONS; i++)
+		LevelFile::ReadBinary(binary.data(), binary.size(), &level);
+	end = std::chrono::high_resolution_clock::now();
+	float binaryMilliseconds = std::chrono::duration<float, std::milli>(end - start).count() / BENCHMARK_ITERATIONS;
+
+	float blocks = (float)level.Blocks.size();
+	printf("%-40s text %8.3f ms (%.0f blocks/s)   binary %8.3f ms (%.0f blocks/s)\n",
+		levelFile,
+		textMilliseconds,
+		textMilliseconds > 0 ? blocks * 1000.0f / textMilliseconds : 0.0f,
+		binaryMilliseconds,
+		binaryMilliseconds > 0 ? blocks * 1000.0f / binaryMilliseconds : 0.0f);
+}
+
+int main(int argc, char* argv[])
+{
+	bool benchmark = argc > 1 && strcmp(argv[1], "-benchmark") == 0;
+	int first = benchmark ? 2 : 1;
+
+	if (first >= argc)
+	{
+		printf("Usage: MeshConverter [-benchmark] model|level [more...]\n");
+		return 1;
+	}
+
+	int failures = 0;
+	for (int i = first; i < argc; i++)
+	{
+		if (benchmark && IsLevelFile(argv[i]))
+			BenchmarkLevel(argv[i]);
+		else if (benchmark)
+			Benchmark(argv[i]);
+		else if (IsLevelFile(argv[i]) ? !ConvertLevel(argv[i]) : !Convert(argv[i]))
+			failures++;
+	}
+
+	return failures > 0 ? 1 : 0;
+}
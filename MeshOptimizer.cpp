@@ -0,0 +1,300 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const unsigned int* indices, unsigned int indexCount, unsigned int vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats = {};
+	stats.Triangles = indexCount / 3;
+
+	// Each vertex remembers when it entered the cache - it's still in a
+	// FIFO cache as long as fewer than cacheSize misses happened since
+	std::vector<unsigned int> entered(vertexCount, 0);
+	std::vector<unsigned char> used(vertexCount, 0);
+	unsigned int misses = 0;
+
+	for (unsigned int i = 0; i < indexCount; i++) {
+		unsigned int v = indices[i];
+		if (v >= vertexCount)
+			continue;
+
+		if (!used[v]) {
+			used[v] = 1;
+			stats.VerticesUsed++;
+		}
+
+		if (entered[v] == 0 || misses - entered[v] >= cacheSize) {
+			misses++;
+			entered[v] = misses;
+		}
+	}
+
+	stats.Transforms = misses;
+	stats.ACMR = stats.Triangles > 0 ? (float)stats.Transforms / stats.Triangles : 0;
+	stats.ATVR = stats.VerticesUsed > 0 ? (float)stats.Transforms / stats.VerticesUsed : 0;
+	return stats;
+}
+
+void MeshOptimizer::AccumulateStats(VertexCacheStats* total, const VertexCacheStats& stats)
+{
+	total->Triangles += stats.Triangles;
+	total->Transforms += stats.Transforms;
+	total->VerticesUsed += stats.VerticesUsed;
+	total->ACMR = total->Triangles > 0 ? (float)total->Transforms / total->Triangles : 0;
+	total->ATVR = total->VerticesUsed > 0 ? (float)total->Transforms / total->VerticesUsed : 0;
+}
+
+// --------------------------------------------------------
+// Tipsify - repeatedly picks a "fanning" vertex and emits all
+// of its remaining triangles.  The next fanning vertex is the
+// one touched this round that's most likely to still be in
+// the cache when its own triangles go out, falling back to
+// recently touched vertices and then a linear scan.
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeVertexCache(unsigned int* indices, unsigned int indexCount, unsigned int vertexCount, unsigned int cacheSize, std::vector<unsigned int>* clusterStarts)
+{
+	unsigned int triCount = indexCount / 3;
+	if (clusterStarts) clusterStarts->clear();
+	if (triCount == 0 || vertexCount == 0)
+		return;
+
+	// Triangle adjacency per vertex, packed as offsets into one array
+	std::vector<unsigned int> liveTriangles(vertexCount, 0);
+	for (unsigned int i = 0; i < triCount * 3; i++)
+		liveTriangles[indices[i]]++;
+
+	std::vector<unsigned int> adjacencyStart(vertexCount + 1, 0);
+	for (unsigned int v = 0; v < vertexCount; v++)
+		adjacencyStart[v + 1] = adjacencyStart[v] + liveTriangles[v];
+
+	std::vector<unsigned int> adjacency(triCount * 3);
+	std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (unsigned int t = 0; t < triCount; t++)
+		for (unsigned int c = 0; c < 3; c++)
+			adjacency[fill[indices[t * 3 + c]]++] = t;
+
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	std::vector<unsigned char> emitted(triCount, 0);
+	std::vector<unsigned int> deadEnds;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> output;
+	output.reserve(triCount * 3);
+
+	unsigned int time = cacheSize + 1;
+	unsigned int scan = 0;
+	int fanning = 0;
+
+	while (fanning >= 0) {
+		candidates.clear();
+
+		// Emit every triangle still using the fanning vertex
+		for (unsigned int a = adjacencyStart[fanning]; a < adjacencyStart[fanning + 1]; a++) {
+			unsigned int t = adjacency[a];
+			if (emitted[t])
+				continue;
+
+			for (unsigned int c = 0; c < 3; c++) {
+				unsigned int v = indices[t * 3 + c];
+				output.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+
+				if (time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+			emitted[t] = 1;
+		}
+
+		// Prefer the candidate that's been in the cache longest but will
+		// still be there once all of its own triangles are emitted
+		int next = -1;
+		int best = -1;
+		for (auto v : candidates) {
+			if (liveTriangles[v] == 0)
+				continue;
+
+			int priority = 0;
+			if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+				priority = (int)(time - cacheTime[v]);
+
+			if (priority > best) {
+				best = priority;
+				next = (int)v;
+			}
+		}
+
+		// Nothing nearby, so back up through recently used vertices,
+		// then scan forward for anything left at all
+		while (next < 0 && !deadEnds.empty()) {
+			unsigned int v = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveTriangles[v] > 0)
+				next = (int)v;
+		}
+
+		while (next < 0 && scan < vertexCount) {
+			if (liveTriangles[scan] > 0)
+				next = (int)scan;
+			scan++;
+		}
+
+		fanning = next;
+	}
+
+	memcpy(indices, &output[0], sizeof(unsigned int) * output.size());
+
+	// Cluster wherever a triangle misses on all three vertices, as
+	// nothing before it was helping that triangle anyway
+	if (clusterStarts) {
+		std::vector<unsigned int> entered(vertexCount, 0);
+		unsigned int misses = 0;
+		for (unsigned int t = 0; t < triCount; t++) {
+			unsigned int triMisses = 0;
+			for (unsigned int c = 0; c < 3; c++) {
+				unsigned int v = indices[t * 3 + c];
+				if (entered[v] == 0 || misses - entered[v] >= cacheSize) {
+					misses++;
+					entered[v] = misses;
+					triMisses++;
+				}
+			}
+
+			if (t == 0 || triMisses == 3)
+				clusterStarts->push_back(t);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Orders clusters by how far they face away from the mesh's
+// center (Nehab, Barczak & Sander 2006), so the outer shell
+// tends to fill the depth buffer before the parts it hides
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeOverdraw(unsigned int* indices, unsigned int indexCount, const void* vertices, unsigned int vertexSize, unsigned int vertexCount, const std::vector<unsigned int>& clusterStarts)
+{
+	unsigned int triCount = indexCount / 3;
+	unsigned int clusterCount = (unsigned int)clusterStarts.size();
+	if (clusterCount < 2)
+		return;
+
+	// Positions are read through the indices, so leave anything
+	// that points past the vertices alone rather than read off the end
+	for (unsigned int i = 0; i < triCount * 3; i++) {
+		if (indices[i] >= vertexCount)
+			return;
+	}
+
+	const unsigned char* bytes = (const unsigned char*)vertices;
+	auto position = [&](unsigned int v) { return (const float*)(bytes + (size_t)v * vertexSize); };
+
+	// Area weighted centroid and normal of each cluster, and of the mesh
+	std::vector<float> clusterData(clusterCount * 7, 0.0f);
+	float meshCentroid[3] = {};
+	float meshArea = 0;
+
+	for (unsigned int k = 0; k < clusterCount; k++) {
+		unsigned int end = k + 1 < clusterCount ? clusterStarts[k + 1] : triCount;
+		float* data = &clusterData[k * 7];
+
+		for (unsigned int t = clusterStarts[k]; t < end; t++) {
+			const float* p0 = position(indices[t * 3 + 0]);
+			const float* p1 = position(indices[t * 3 + 1]);
+			const float* p2 = position(indices[t * 3 + 2]);
+
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float n[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0] };
+			float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			for (int c = 0; c < 3; c++) {
+				float centroid = (p0[c] + p1[c] + p2[c]) / 3.0f;
+				data[c] += centroid * area;
+				data[3 + c] += n[c];
+				meshCentroid[c] += centroid * area;
+			}
+			data[6] += area;
+			meshArea += area;
+		}
+	}
+
+	if (meshArea <= 0)
+		return;
+
+	for (int c = 0; c < 3; c++)
+		meshCentroid[c] /= meshArea;
+
+	std::vector<float> sortKeys(clusterCount, 0.0f);
+	for (unsigned int k = 0; k < clusterCount; k++) {
+		const float* data = &clusterData[k * 7];
+		if (data[6] <= 0)
+			continue;
+
+		float normalLength = sqrtf(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+		if (normalLength <= 0)
+			continue;
+
+		float dot = 0;
+		for (int c = 0; c < 3; c++)
+			dot += (data[c] / data[6] - meshCentroid[c]) * (data[3 + c] / normalLength);
+		sortKeys[k] = dot;
+	}
+
+	// Stable, so clusters that tie keep Tipsify's order
+	std::vector<unsigned int> order(clusterCount);
+	for (unsigned int k = 0; k < clusterCount; k++)
+		order[k] = k;
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<unsigned int> output;
+	output.reserve(triCount * 3);
+	for (auto k : order) {
+		unsigned int end = k + 1 < clusterCount ? clusterStarts[k + 1] : triCount;
+		output.insert(output.end(), indices + clusterStarts[k] * 3, indices + end * 3);
+	}
+
+	memcpy(indices, &output[0], sizeof(unsigned int) * output.size());
+}
+
+void MeshOptimizer::OptimizeVertexFetch(void* vertices, unsigned int vertexSize, unsigned int vertexCount, unsigned int* indices, unsigned int indexCount)
+{
+	if (vertexCount == 0)
+		return;
+
+	// New position of each old vertex, in order of first use
+	const unsigned int unassigned = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(vertexCount, unassigned);
+	unsigned int nextVertex = 0;
+	for (unsigned int i = 0; i < indexCount; i++) {
+		unsigned int& r = remap[indices[i]];
+		if (r == unassigned)
+			r = nextVertex++;
+		indices[i] = r;
+	}
+
+	for (unsigned int v = 0; v < vertexCount; v++)
+		if (remap[v] == unassigned)
+			remap[v] = nextVertex++;
+
+	unsigned char* bytes = (unsigned char*)vertices;
+	std::vector<unsigned char> original(bytes, bytes + (size_t)vertexCount * vertexSize);
+	for (unsigned int v = 0; v < vertexCount; v++)
+		memcpy(bytes + (size_t)remap[v] * vertexSize, &original[(size_t)v * vertexSize], vertexSize);
+}
+
+void MeshOptimizer::Optimize(void* vertices, unsigned int vertexSize, unsigned int vertexCount, unsigned int* indices, unsigned int indexCount, VertexCacheStats* before, VertexCacheStats* after)
+{
+	if (before) *before = AnalyzeVertexCache(indices, indexCount, vertexCount);
+
+	std::vector<unsigned int> clusterStarts;
+	OptimizeVertexCache(indices, indexCount, vertexCount, CacheSize, &clusterStarts);
+	OptimizeOverdraw(indices, indexCount, vertices, vertexSize, vertexCount, clusterStarts);
+	OptimizeVertexFetch(vertices, vertexSize, vertexCount, indices, indexCount);
+
+	if (after) *after = AnalyzeVertexCache(indices, indexCount, vertexCount);
+}
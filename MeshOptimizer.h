@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+
+// --------------------------------------------------------
+// Results of running an index buffer through a simulated
+// FIFO post-transform vertex cache
+//
+//  ACMR - vertex shader runs per triangle (0.5 is ideal for
+//         a large regular grid, 3.0 means no reuse at all)
+//  ATVR - vertex shader runs per vertex used (1.0 is ideal)
+// --------------------------------------------------------
+struct VertexCacheStats
+{
+	unsigned int Triangles;
+	unsigned int Transforms;
+	unsigned int VerticesUsed;
+	float ACMR;
+	float ATVR;
+};
+
+// --------------------------------------------------------
+// CPU side mesh optimization, meant to run once when a mesh
+// is imported or baked rather than every load:
+//
+//  1. OptimizeVertexCache - Tipsify (Sander, Nehab & Barczak
+//     2007) reorders triangles for post-transform cache reuse
+//  2. OptimizeOverdraw - sorts the clusters Tipsify leaves so
+//     outward facing ones draw first and occlude the rest
+//  3. OptimizeVertexFetch - renumbers vertices in the order
+//     they're first used so fetches walk memory forwards
+//
+// Everything works on raw arrays with 32-bit indices that
+// start at vertex 0, so a submesh can be optimized on its own.
+// --------------------------------------------------------
+class MeshOptimizer
+{
+public:
+	// Entries in the simulated and targeted FIFO cache
+	static const unsigned int CacheSize = 16;
+
+	static VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, unsigned int indexCount, unsigned int vertexCount, unsigned int cacheSize = CacheSize);
+
+	// Adds one set of stats to a running total and recalculates its ratios
+	static void AccumulateStats(VertexCacheStats* total, const VertexCacheStats& stats);
+
+	// Reorders triangles in place.  Fills clusterStarts with the first
+	// triangle of each run that starts from a cold cache, which is
+	// where the overdraw pass can reorder without hurting reuse much.
+	static void OptimizeVertexCache(unsigned int* indices, unsigned int indexCount, unsigned int vertexCount, unsigned int cacheSize, std::vector<unsigned int>* clusterStarts);
+
+	// Reorders whole clusters in place, given positions as the first
+	// three floats of each strided vertex.  Does nothing if any
+	// index is past vertexCount.
+	static void OptimizeOverdraw(unsigned int* indices, unsigned int indexCount, const void* vertices, unsigned int vertexSize, unsigned int vertexCount, const std::vector<unsigned int>& clusterStarts);
+
+	// Reorders vertices in place and rewrites the indices to match.
+	// Unused vertices keep their relative order at the end.
+	static void OptimizeVertexFetch(void* vertices, unsigned int vertexSize, unsigned int vertexCount, unsigned int* indices, unsigned int indexCount);
+
+	// Runs all three passes, with before and after cache stats
+	static void Optimize(void* vertices, unsigned int vertexSize, unsigned int vertexCount, unsigned int* indices, unsigned int indexCount, VertexCacheStats* before, VertexCacheStats* after);
+};
@@ -0,0 +1,177 @@
+#include "SelfTest.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <vector>
+
+// Position first, like Vertex, plus something that has to
+// travel along with it when vertices are reordered
+struct TestVertex
+{
+	float Position[3];
+	unsigned int Id;
+};
+
+// Quads on a flat grid, with the triangles shuffled so the
+// starting order is about as bad for the cache as it gets
+static void MakeShuffledGrid(unsigned int size, std::vector<TestVertex>* vertices, std::vector<unsigned int>* indices)
+{
+	for (unsigned int z = 0; z <= size; z++) {
+		for (unsigned int x = 0; x <= size; x++) {
+			TestVertex v = { { (float)x, (float)((x * 7 + z * 3) % 5) * 0.1f, (float)z }, (unsigned int)vertices->size() };
+			vertices->push_back(v);
+		}
+	}
+
+	std::vector<unsigned int> triangles;
+	for (unsigned int z = 0; z < size; z++) {
+		for (unsigned int x = 0; x < size; x++) {
+			unsigned int corner = z * (size + 1) + x;
+			unsigned int quad[6] = { corner, corner + size + 1, corner + 1, corner + 1, corner + size + 1, corner + size + 2 };
+			triangles.insert(triangles.end(), quad, quad + 6);
+		}
+	}
+
+	srand(3);
+	unsigned int triCount = (unsigned int)triangles.size() / 3;
+	for (unsigned int t = triCount; t > 1; t--) {
+		unsigned int swap = (unsigned int)rand() % t;
+		for (int c = 0; c < 3; c++)
+			std::swap(triangles[(t - 1) * 3 + c], triangles[swap * 3 + c]);
+	}
+	*indices = triangles;
+}
+
+// Each triangle as the ids of its vertices, rotated so the
+// smallest comes first (keeping the winding), then sorted - two
+// meshes with the same triangles give the same list, no matter
+// how the triangles or vertices were reordered
+static std::vector<unsigned int> TriangleSet(const std::vector<TestVertex>& vertices, const std::vector<unsigned int>& indices)
+{
+	std::vector<unsigned long long> keys;
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		unsigned int ids[3] = { vertices[indices[t]].Id, vertices[indices[t + 1]].Id, vertices[indices[t + 2]].Id };
+		int first = ids[0] < ids[1] ? (ids[0] < ids[2] ? 0 : 2) : (ids[1] < ids[2] ? 1 : 2);
+		unsigned long long key = 0;
+		for (int c = 0; c < 3; c++)
+			key = (key << 21) | ids[(first + c) % 3];
+		keys.push_back(key);
+	}
+	std::sort(keys.begin(), keys.end());
+
+	std::vector<unsigned int> set;
+	for (auto key : keys) {
+		set.push_back((unsigned int)(key >> 42));
+		set.push_back((unsigned int)(key >> 21) & 0x1FFFFF);
+		set.push_back((unsigned int)key & 0x1FFFFF);
+	}
+	return set;
+}
+
+static void AnalyzerTest()
+{
+	// One triangle - three transforms, no reuse
+	unsigned int single[3] = { 0, 1, 2 };
+	VertexCacheStats stats = MeshOptimizer::AnalyzeVertexCache(single, 3, 3);
+	SELF_TEST_CHECK(stats.Triangles == 1 && stats.Transforms == 3 && stats.VerticesUsed == 3);
+	SELF_TEST_CHECK(stats.ACMR == 3.0f && stats.ATVR == 1.0f);
+
+	// A quad shares an edge, so four transforms for two triangles
+	unsigned int quad[6] = { 0, 1, 2, 2, 1, 3 };
+	stats = MeshOptimizer::AnalyzeVertexCache(quad, 6, 4);
+	SELF_TEST_CHECK(stats.Transforms == 4);
+	SELF_TEST_CHECK(stats.ACMR == 2.0f && stats.ATVR == 1.0f);
+
+	// FIFO, not LRU - hitting vertex 0 in the second triangle doesn't
+	// keep it around, so it's the first one pushed out by 4 and 5
+	// (an LRU cache would still have it, for 6 transforms)
+	unsigned int fifo[9] = { 0, 1, 2, 3, 0, 1, 4, 5, 0 };
+	stats = MeshOptimizer::AnalyzeVertexCache(fifo, 9, 6, 4);
+	SELF_TEST_CHECK(stats.Transforms == 7);
+	SELF_TEST_CHECK(stats.VerticesUsed == 6);
+
+	// Too small a cache to hold a triangle's worth of reuse
+	unsigned int repeated[9] = { 0, 1, 2, 3, 4, 5, 0, 1, 2 };
+	SELF_TEST_CHECK(MeshOptimizer::AnalyzeVertexCache(repeated, 9, 6, 3).Transforms == 9);
+	SELF_TEST_CHECK(MeshOptimizer::AnalyzeVertexCache(repeated, 9, 6, 6).Transforms == 6);
+
+	// Out of range indices are skipped rather than counted
+	unsigned int outOfRange[3] = { 0, 1, 99 };
+	stats = MeshOptimizer::AnalyzeVertexCache(outOfRange, 3, 2);
+	SELF_TEST_CHECK(stats.Transforms == 2 && stats.VerticesUsed == 2);
+
+	// Running totals recompute the ratios from the sums
+	VertexCacheStats total = {};
+	MeshOptimizer::AccumulateStats(&total, MeshOptimizer::AnalyzeVertexCache(single, 3, 3));
+	MeshOptimizer::AccumulateStats(&total, MeshOptimizer::AnalyzeVertexCache(quad, 6, 4));
+	SELF_TEST_CHECK(total.Triangles == 3 && total.Transforms == 7 && total.VerticesUsed == 7);
+	SELF_TEST_CHECK(total.ACMR == 7.0f / 3.0f && total.ATVR == 1.0f);
+}
+
+static void PassesTest()
+{
+	std::vector<TestVertex> vertices;
+	std::vector<unsigned int> indices;
+	MakeShuffledGrid(32, &vertices, &indices);
+	unsigned int vertexCount = (unsigned int)vertices.size();
+	unsigned int indexCount = (unsigned int)indices.size();
+	std::vector<unsigned int> originalSet = TriangleSet(vertices, indices);
+
+	// Tipsify only reorders triangles, and marks where each cluster starts
+	std::vector<unsigned int> tipsified = indices;
+	std::vector<unsigned int> clusterStarts;
+	MeshOptimizer::OptimizeVertexCache(tipsified.data(), indexCount, vertexCount, MeshOptimizer::CacheSize, &clusterStarts);
+	SELF_TEST_CHECK(TriangleSet(vertices, tipsified) == originalSet);
+	SELF_TEST_CHECK(!clusterStarts.empty() && clusterStarts[0] == 0);
+	SELF_TEST_CHECK(std::is_sorted(clusterStarts.begin(), clusterStarts.end()));
+	SELF_TEST_CHECK(clusterStarts.back() < indexCount / 3);
+
+	// The overdraw pass only moves whole clusters around
+	std::vector<unsigned int> sorted = tipsified;
+	MeshOptimizer::OptimizeOverdraw(sorted.data(), indexCount, vertices.data(), sizeof(TestVertex), vertexCount, clusterStarts);
+	SELF_TEST_CHECK(TriangleSet(vertices, sorted) == originalSet);
+
+	// ...and won't read positions through an index that's out of range
+	std::vector<unsigned int> bad = tipsified;
+	bad[5] = vertexCount;
+	MeshOptimizer::OptimizeOverdraw(bad.data(), indexCount, vertices.data(), sizeof(TestVertex), vertexCount, clusterStarts);
+	bad[5] = tipsified[5];
+	SELF_TEST_CHECK(bad == tipsified);
+
+	// Vertex fetch renumbers in order of first use, carrying the
+	// vertex data along
+	std::vector<TestVertex> fetched = vertices;
+	std::vector<unsigned int> renumbered = sorted;
+	MeshOptimizer::OptimizeVertexFetch(fetched.data(), sizeof(TestVertex), vertexCount, renumbered.data(), indexCount);
+	SELF_TEST_CHECK(TriangleSet(fetched, renumbered) == originalSet);
+	unsigned int nextNew = 0;
+	bool inFirstUseOrder = true;
+	for (auto index : renumbered) {
+		if (index > nextNew)
+			inFirstUseOrder = false;
+		if (index == nextNew)
+			nextNew++;
+	}
+	SELF_TEST_CHECK(inFirstUseOrder);
+	SELF_TEST_CHECK(nextNew == vertexCount);
+
+	// All together - same triangles, and a lot better for the
+	// cache than the shuffled order (a grid optimized for a 16
+	// entry FIFO comes in well under 0.8 transforms per triangle)
+	std::vector<TestVertex> optimizedVertices = vertices;
+	std::vector<unsigned int> optimizedIndices = indices;
+	VertexCacheStats before, after;
+	MeshOptimizer::Optimize(optimizedVertices.data(), sizeof(TestVertex), vertexCount, optimizedIndices.data(), indexCount, &before, &after);
+	SELF_TEST_CHECK(TriangleSet(optimizedVertices, optimizedIndices) == originalSet);
+	SELF_TEST_CHECK(before.Triangles == after.Triangles && before.VerticesUsed == after.VerticesUsed);
+	SELF_TEST_CHECK(after.ACMR < before.ACMR);
+	SELF_TEST_CHECK_AT_MOST(after.ACMR, 0.8);
+	SELF_TEST_CHECK(after.ATVR >= 1.0f);
+}
+
+void MeshOptimizerTest()
+{
+	AnalyzerTest();
+	PassesTest();
+}
@@ -0,0 +1,27 @@
+#include "PhysXDispatcher.h"
+
+using namespace physx;
+
+PhysXDispatcher::PhysXDispatcher(JobSystem* jobs) :
+	jobs(jobs)
+{
+}
+
+void PhysXDispatcher::submitTask(PxBaseTask& task)
+{
+	jobs->Submit(&PhysXDispatcher::RunTask, &task);
+}
+
+uint32_t PhysXDispatcher::getWorkerCount() const
+{
+	return jobs->GetWorkerCount();
+}
+
+// Same as the default dispatcher - run it, then let PhysX
+// know it's finished so dependent tasks can start
+void PhysXDispatcher::RunTask(void* data)
+{
+	PxBaseTask* task = (PxBaseTask*)data;
+	task->run();
+	task->release();
+}
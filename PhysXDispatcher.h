@@ -0,0 +1,23 @@
+#pragma once
+
+#include <PxPhysicsAPI.h>
+
+#include "JobSystem.h"
+
+// --------------------------------------------------------
+// Runs PhysX's tasks on the game's JobSystem, in place of
+// the PxDefaultCpuDispatcher and its own set of threads
+// --------------------------------------------------------
+class PhysXDispatcher : public physx::PxCpuDispatcher
+{
+public:
+	PhysXDispatcher(JobSystem* jobs);
+
+	void submitTask(physx::PxBaseTask& task) override;
+	uint32_t getWorkerCount() const override;
+
+private:
+	JobSystem* jobs;
+
+	static void RunTask(void* data);
+};
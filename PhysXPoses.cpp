@@ -0,0 +1,37 @@
+#include "PhysXPoses.h"
+
+using namespace physx;
+using namespace DirectX;
+
+void PhysXPoses::Attach(PxRigidActor* actor, Transform* transform)
+{
+	actor->userData = transform;
+	Write(actor, transform);
+}
+
+unsigned int PhysXPoses::WriteActiveActors(PxScene* scene)
+{
+	PxU32 count = 0;
+	PxActor** actors = scene->getActiveActors(count);
+
+	unsigned int written = 0;
+	for (PxU32 i = 0; i < count; i++) {
+		PxRigidActor* actor = actors[i]->is<PxRigidActor>();
+		Transform* transform = (Transform*)actors[i]->userData;
+		if (!actor || !transform)
+			continue;
+
+		Write(actor, transform);
+		written++;
+	}
+
+	return written;
+}
+
+void PhysXPoses::Write(PxRigidActor* actor, Transform* transform)
+{
+	PxTransform pose = actor->getGlobalPose();
+	transform->SetPose(
+		XMFLOAT3(pose.p.x, pose.p.y, pose.p.z),
+		XMFLOAT4(pose.q.x, pose.q.y, pose.q.z, pose.q.w));
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <PxPhysicsAPI.h>
+
+#include "Transform.h"
+
+// --------------------------------------------------------
+// Ties PhysX actors to the Transforms that show them (through
+// the actor's userData), and copies the pose of every actor
+// that moved in the last step across in one pass - position
+// and quaternion as they are, with nothing for actors that
+// are asleep or static.
+//
+// The scene needs PxSceneFlag::eENABLE_ACTIVE_ACTORS, or
+// PhysX won't keep the list of actors that moved.
+// --------------------------------------------------------
+class PhysXPoses
+{
+public:
+	static void Attach(physx::PxRigidActor* actor, Transform* transform);
+
+	// Call after fetchResults, returning how many were written
+	static unsigned int WriteActiveActors(physx::PxScene* scene);
+
+	// The pose of one actor, written the same way
+	static void Write(physx::PxRigidActor* actor, Transform* transform);
+};
@@ -0,0 +1,161 @@
+#include "PhysicsBenchmark.h"
+#include "JobSystem.h"
+#include "PhysXDispatcher.h"
+#include "PhysXPoses.h"
+#include "TransformSystem.h"
+
+#include <PxPhysicsAPI.h>
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+using namespace physx;
+
+// Steps run before timing, so the marbles are already piling up
+#define BENCHMARK_WARMUP_STEPS 30
+
+// The marbles on a floor, with the job system running PhysX
+static PxScene* CreateScene(PxPhysics* physics, PxMaterial* material, PhysXDispatcher* dispatcher, unsigned int marbleCount, std::vector<PxRigidDynamic*>* bodies)
+{
+	PxSceneDesc sceneDesc(physics->getTolerancesScale());
+	sceneDesc.gravity = PxVec3(0.0f, -9.81f, 0.0f);
+	sceneDesc.cpuDispatcher = dispatcher;
+	sceneDesc.filterShader = PxDefaultSimulationFilterShader;
+	sceneDesc.flags |= PxSceneFlag::eENABLE_ACTIVE_ACTORS;
+	PxScene* scene = physics->createScene(sceneDesc);
+
+	scene->addActor(*PxCreatePlane(*physics, PxPlane(0, 1.0f, 0, 0), *material));
+
+	// A square column of marbles, loosely spaced so they tumble
+	// into each other rather than resting in a neat stack
+	PxShape* shape = physics->createShape(PxSphereGeometry(0.5f), *material, true);
+	unsigned int side = 16;
+	for (unsigned int i = 0; i < marbleCount; i++) {
+		unsigned int layer = i / (side * side);
+		unsigned int x = i % side;
+		unsigned int z = (i / side) % side;
+		PxVec3 position(x * 1.1f + (layer % 2) * 0.3f, 1.0f + layer * 1.1f, z * 1.1f + (layer % 3) * 0.2f);
+
+		PxRigidDynamic* body = physics->createRigidDynamic(PxTransform(position));
+		body->attachShape(*shape);
+		PxRigidBodyExt::updateMassAndInertia(*body, 10.0f);
+		scene->addActor(*body);
+		if (bodies)
+			bodies->push_back(body);
+	}
+	shape->release();
+
+	return scene;
+}
+
+static float TimeScene(PxPhysics* physics, PxMaterial* material, unsigned int workers, unsigned int marbleCount, unsigned int steps)
+{
+	JobSystem jobs(workers);
+	PhysXDispatcher dispatcher(&jobs);
+	PxScene* scene = CreateScene(physics, material, &dispatcher, marbleCount, 0);
+
+	for (unsigned int s = 0; s < BENCHMARK_WARMUP_STEPS; s++) {
+		scene->simulate(1.0f / 60.0f);
+		scene->fetchResults(true);
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned int s = 0; s < steps; s++) {
+		scene->simulate(1.0f / 60.0f);
+		scene->fetchResults(true);
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	scene->release();
+	return std::chrono::duration<float, std::milli>(end - start).count() / steps;
+}
+
+// --------------------------------------------------------
+// Times getting every step's poses into the marbles' matrices
+// two ways, each including the matrix update afterwards:
+//  - per body, through Euler angles, the way entities used
+//    to be updated (quaternion to angles, then back again)
+//  - PhysXPoses, which only visits bodies that moved and
+//    stores their quaternions as they are
+// --------------------------------------------------------
+static void TimePoseWrites(PxPhysics* physics, PxMaterial* material, unsigned int workers, unsigned int marbleCount, unsigned int steps)
+{
+	JobSystem jobs(workers);
+	PhysXDispatcher dispatcher(&jobs);
+	std::vector<PxRigidDynamic*> bodies;
+	PxScene* scene = CreateScene(physics, material, &dispatcher, marbleCount, &bodies);
+
+	Transform* transforms = new Transform[marbleCount];
+	for (unsigned int i = 0; i < marbleCount; i++)
+		PhysXPoses::Attach(bodies[i], &transforms[i]);
+
+	TransformSystem& system = TransformSystem::GetInstance();
+	float eulerMilliseconds = 0;
+	float bulkMilliseconds = 0;
+	unsigned int activeTotal = 0;
+	for (unsigned int s = 0; s < BENCHMARK_WARMUP_STEPS + steps; s++) {
+		scene->simulate(1.0f / 60.0f);
+		scene->fetchResults(true);
+		if (s < BENCHMARK_WARMUP_STEPS)
+			continue;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < marbleCount; i++) {
+			PxTransform pose = bodies[i]->getGlobalPose();
+			DirectX::XMFLOAT3 euler = Transform::QuatToEuler(DirectX::XMFLOAT4(pose.q.x, pose.q.y, pose.q.z, pose.q.w));
+			transforms[i].SetPosition(pose.p.x, pose.p.y, pose.p.z);
+			transforms[i].SetRotation(euler.x, euler.y, euler.z);
+		}
+		system.UpdateDirty();
+		auto middle = std::chrono::high_resolution_clock::now();
+		activeTotal += PhysXPoses::WriteActiveActors(scene);
+		system.UpdateDirty();
+		auto end = std::chrono::high_resolution_clock::now();
+
+		eulerMilliseconds += std::chrono::duration<float, std::milli>(middle - start).count();
+		bulkMilliseconds += std::chrono::duration<float, std::milli>(end - middle).count();
+	}
+
+	printf("Pose writes: %u marbles, %.0f moving per step on average\n", marbleCount, activeTotal / (float)steps);
+	printf("  through Euler angles: %8.3f ms/step\n", eulerMilliseconds / steps);
+	printf("  active actors:        %8.3f ms/step\n", bulkMilliseconds / steps);
+
+	delete[] transforms;
+	scene->release();
+}
+
+bool PhysicsBenchmark::Run(unsigned int maxWorkers, unsigned int marbleCount, unsigned int steps)
+{
+	PxDefaultAllocator allocator;
+	PxDefaultErrorCallback errorCallback;
+	PxFoundation* foundation = PxCreateFoundation(PX_PHYSICS_VERSION, allocator, errorCallback);
+	if (!foundation)
+		return false;
+
+	PxPhysics* physics = PxCreatePhysics(PX_PHYSICS_VERSION, *foundation, PxTolerancesScale(), false, NULL);
+	if (!physics) {
+		foundation->release();
+		return false;
+	}
+	PxMaterial* material = physics->createMaterial(0.5f, 0.5f, 0.3f);
+
+	printf("Physics benchmark: %u marbles, %u steps\n", marbleCount, steps);
+	float single = 0;
+	for (unsigned int workers = 1; workers <= maxWorkers; workers++) {
+		float milliseconds = TimeScene(physics, material, workers, marbleCount, steps);
+		if (workers == 1)
+			single = milliseconds;
+
+		printf("  %2u workers: %8.3f ms/step   (%.2fx)\n",
+			workers,
+			milliseconds,
+			milliseconds > 0 ? single / milliseconds : 0.0f);
+	}
+
+	TimePoseWrites(physics, material, maxWorkers, marbleCount, steps);
+
+	material->release();
+	physics->release();
+	foundation->release();
+	return true;
+}
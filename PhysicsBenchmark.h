@@ -0,0 +1,17 @@
+#pragma once
+
+// --------------------------------------------------------
+// Headless PhysX stress test - piles up a lot of dynamic
+// marbles in a scene with nothing rendering, and times
+// stepping it with the JobSystem at each worker count from
+// 1 to maxWorkers, then times copying the poses into
+// Transforms.  Runs before (and instead of) the game, since
+// PhysX only allows one foundation per process.
+// --------------------------------------------------------
+class PhysicsBenchmark
+{
+public:
+	// Prints a row per worker count, returning false if
+	// PhysX couldn't be started
+	static bool Run(unsigned int maxWorkers, unsigned int marbleCount, unsigned int steps);
+};
@@ -4,7 +4,9 @@
 #include "ImGUI/imgui_impl_win32.h"
 #include "ImGUI/imgui_impl_dx11.h"
 
-#include <algorithm>
+#include "AllocationCounter.h"
+
+#include <chrono>
 
 // For the DirectX Math library
 using namespace DirectX;
@@ -40,7 +42,6 @@ Renderer::Renderer(
 		windowHeight(height),
 		sky(sky),
 		terrain(terrain),
-		entities(entities),
 		lights(lights),
 		emitters(emitters),
 		lightCount(lightCount),
@@ -54,22 +55,60 @@ Renderer::Renderer(
 		fullscreenVS(fullscreenVS),
 		solidColorPS(solidColorPS),
 		simpleTexturePS(simpleTexturePS),
-		refractionPS(refractionPS) {
+		refractionPS(refractionPS),
+		instanceCapacity(0) {
 
 	// initialize structs
 	vsPerFrameData = {};
 	psPerFrameData = {};
+	stats = {};
+	jobs = 0;
+
+	// per object data for single draws, sized for a few hundred entities to start
+	perObjectRing = new ConstantBufferRing(device, context, 256 * 256);
+
+	// state cache shared with all shaders on this context
+	stateCache = SimpleStateCache::ForContext(context);
+
+	// build the draw list from whatever exists already
+	for (auto ge : entities) {
+		AddEntity(ge);
+	}
+
+	// look up everything the renderer sets on shaders by handle
+	perObjectHandle = ISimpleShader::GetBufferHandle("perObject");
+	externalDataHandle = ISimpleShader::GetBufferHandle("externalData");
+	worldHandle = ISimpleShader::GetVariableHandle("world");
+	normalMatrixHandle = ISimpleShader::GetVariableHandle("normalMatrix");
+	viewHandle = ISimpleShader::GetVariableHandle("view");
+	projectionHandle = ISimpleShader::GetVariableHandle("projection");
+	colorHandle = ISimpleShader::GetVariableHandle("Color");
+	screenSizeHandle = ISimpleShader::GetVariableHandle("screenSize");
+	viewMatrixHandle = ISimpleShader::GetVariableHandle("viewMatrix");
+	projMatrixHandle = ISimpleShader::GetVariableHandle("projMatrix");
+	useRefractionSilhouetteHandle = ISimpleShader::GetVariableHandle("useRefractionSilhouette");
+	refractionFromNormalMapHandle = ISimpleShader::GetVariableHandle("refractionFromNormalMap");
+	indexOfRefractionHandle = ISimpleShader::GetVariableHandle("indexOfRefraction");
+	refractionScaleHandle = ISimpleShader::GetVariableHandle("refractionScale");
+	brdfLookUpMapHandle = ISimpleShader::GetShaderResourceViewHandle("BrdfLookUpMap");
+	irradianceIBLMapHandle = ISimpleShader::GetShaderResourceViewHandle("IrradianceIBLMap");
+	specularIBLMapHandle = ISimpleShader::GetShaderResourceViewHandle("SpecularIBLMap");
+	pixelsHandle = ISimpleShader::GetShaderResourceViewHandle("Pixels");
+	screenPixelsHandle = ISimpleShader::GetShaderResourceViewHandle("ScreenPixels");
+	refractionSilhouetteHandle = ISimpleShader::GetShaderResourceViewHandle("RefractionSilhouette");
+	environmentMapHandle = ISimpleShader::GetShaderResourceViewHandle("EnvironmentMap");
 
 	D3D11_BUFFER_DESC bufferDesc = {};
 	const SimpleConstantBuffer* scb = 0;
+	SimpleBufferHandle perFrameHandle = ISimpleShader::GetBufferHandle("perFrame");
 
 	// make a new vs per frame buffer
-	scb = lightVS->GetBufferInfo("perFrame");
+	scb = lightVS->GetBufferInfo(perFrameHandle);
 	scb->ConstantBuffer.Get()->GetDesc(&bufferDesc);
 	device->CreateBuffer(&bufferDesc, 0, vsPerFrameConstantBuffer.GetAddressOf());
 
 	// make a new ps per frame buffer
-	scb = PBRShader->GetBufferInfo("perFrame");
+	scb = PBRShader->GetBufferInfo(perFrameHandle);
 	scb->ConstantBuffer.Get()->GetDesc(&bufferDesc);
 	device->CreateBuffer(&bufferDesc, 0, psPerFrameConstantBuffer.GetAddressOf());
 
@@ -106,7 +145,7 @@ Renderer::Renderer(
 }
 
 Renderer::~Renderer() {
-	
+	delete perObjectRing;
 }
 
 void Renderer::PreResize()
@@ -142,6 +181,14 @@ void Renderer::PostResize(
 
 void Renderer::Render(Camera* camera, float totalTime)
 {
+	unsigned int frameAllocStart = AllocationCounter::GetCount();
+	ISimpleShader::ResetUploadStats();
+
+	// Start from a clean slate, since render targets from outside the
+	// frame (like IBL generation) can silently unbind SRVs
+	stateCache->Invalidate();
+	stateCache->ResetStats();
+
 	// Background color for clearing
 	const float color[4] = { 0, 0, 0, 1 };
 
@@ -178,73 +225,211 @@ void Renderer::Render(Camera* camera, float totalTime)
 		context->UpdateSubresource(psPerFrameConstantBuffer.Get(), 0, 0, &psPerFrameData, 0, 0);
 	}
 
-	// sort entities by material
-	std::vector<GameEntity*> toDraw(entities);
-	std::sort(toDraw.begin(), toDraw.end(), [](const auto& e1, const auto& e2) {
-		return e1->GetMaterial() < e2->GetMaterial();
-		});
+	unsigned int drawListAllocStart = AllocationCounter::GetCount();
+
+	// drop anything outside the view before sorting or touching state
+	CullEntities(camera);
+
+	// build a sort key per submesh of each visible entity - opaque keys
+	// keep matching shaders, materials and meshes together (so instanced
+	// groups stay contiguous), refractive keys put the farthest first
+	XMMATRIX view = XMLoadFloat4x4(&vsPerFrameData.ViewMatrix);
+	float farClip = camera->GetFarClip();
+	submeshDraws.clear();
+	drawSorter.Clear();
+	for (auto index : visibleIndices) {
+		const DrawListEntry& entry = drawList[index];
+		Mesh* mesh = entry.Entity->GetMesh();
+
+		// view depth of the bounding sphere found while culling
+		XMVECTOR center = XMLoadFloat3(&worldSpheres[index].Center);
+		float depth = XMVectorGetZ(XMVector3TransformCoord(center, view));
+
+		for (unsigned int s = 0; s < mesh->GetSubmeshCount(); s++) {
+			SubmeshDraw draw;
+			draw.Entity = entry.Entity;
+			draw.Mat = entry.Entity->GetSubmeshMaterial(s);
+			draw.Submesh = s;
+
+			// each submesh's instances sort together
+			uint64_t key = DrawSorter::MakeKey(
+				draw.Mat->IsRefractive() ? PASS_REFRACTIVE : PASS_OPAQUE,
+				draw.Mat->GetVS()->GetSortID(),
+				draw.Mat->GetPS()->GetSortID(),
+				draw.Mat->GetSortID(),
+				entry.MeshID,
+				s,
+				depth,
+				farClip);
+			drawSorter.Add(key, (unsigned int)submeshDraws.size());
+			submeshDraws.push_back(draw);
+		}
+	}
+	drawSorter.Sort();
+
+	// Collect all refractive draws for later, and the
+	// per-instance matrices of everything else
+	refractiveDraws.clear();
+	opaqueDraws.clear();
+	instanceData.clear();
+	for (unsigned int i = 0; i < drawSorter.GetCount(); i++) {
+		const SubmeshDraw& draw = submeshDraws[drawSorter.GetDraw(i).Index];
+		if (draw.Mat->IsRefractive()) {
+			refractiveDraws.push_back(draw);
+			continue;
+		}
+
+		Transform* trans = draw.Entity->GetTransform();
+		InstanceData instance;
+		instance.World = trans->GetWorldMatrix();
+		instance.Normal = trans->GetNormalMatrix();
+		instanceData.push_back(instance);
+		opaqueDraws.push_back(draw);
+	}
+
+	// upload every instance at once and bind it to the second input slot
+	if (!instanceData.empty()) {
+		EnsureInstanceBufferCapacity((unsigned int)instanceData.size());
+
+		D3D11_MAPPED_SUBRESOURCE mapped = {};
+		context->Map(instanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+		memcpy(mapped.pData, &instanceData[0], sizeof(InstanceData) * instanceData.size());
+		context->Unmap(instanceBuffer.Get(), 0);
+
+		UINT stride = sizeof(InstanceData);
+		UINT offset = 0;
+		context->IASetVertexBuffers(1, 1, instanceBuffer.GetAddressOf(), &stride, &offset);
+	}
 
-	// Collect all refractive entities for later
-	std::vector<GameEntity*> refractiveEntities;
+	// split opaque draws into runs that share mesh, submesh and material,
+	// writing per object data for single draws into the ring as we go -
+	// a material whose vs has no instanced variant gets a run per draw
+	drawGroups.clear();
+	bool ringMapped = perObjectRing->Begin();
+	for (unsigned int groupStart = 0; groupStart < opaqueDraws.size(); ) {
+		Material* material = opaqueDraws[groupStart].Mat;
+		Mesh* mesh = opaqueDraws[groupStart].Entity->GetMesh();
+		unsigned int submesh = opaqueDraws[groupStart].Submesh;
+		SimpleVertexShader* instancedVS = GetInstancedVS(material->GetVS());
+
+		unsigned int groupEnd = groupStart + 1;
+		while (instancedVS &&
+			groupEnd < opaqueDraws.size() &&
+			opaqueDraws[groupEnd].Mat == material &&
+			opaqueDraws[groupEnd].Entity->GetMesh() == mesh &&
+			opaqueDraws[groupEnd].Submesh == submesh) {
+			groupEnd++;
+		}
+
+		DrawGroup group = {};
+		group.Start = groupStart;
+		group.Count = groupEnd - groupStart;
+		group.VS = group.Count > 1 ? instancedVS : material->GetVS();
+
+		// no slice means it falls back to the shader's own buffer
+		if (group.Count == 1 && ringMapped) {
+			const SimpleConstantBuffer* perObject = group.VS->GetBufferInfo(perObjectHandle);
+			if (perObject && perObjectRing->Allocate(perObject->Size, &group.PerObject)) {
+				group.VS->SetSliceMatrix4x4(group.PerObject.Data, worldHandle, instanceData[groupStart].World);
+				group.VS->SetSliceData(group.PerObject.Data, normalMatrixHandle, &instanceData[groupStart].Normal, sizeof(NormalMatrix));
+			}
+		}
+
+		drawGroups.push_back(group);
+		groupStart = groupEnd;
+	}
+	perObjectRing->End();
+
+	// everything up to here only touches buffers the renderer keeps,
+	// so once they've grown this should stay at zero
+	stats.DrawListAllocations = AllocationCounter::GetCount() - drawListAllocStart;
+
+	stats.DrawCalls = 0;
+	stats.DrawCallsSaved = 0;
+	stats.InstancedGroups = 0;
+	stats.RingSlices = 0;
 
-	// draw entities
+	// draw each group, instanced if it has more than one entity
 	SimpleVertexShader* currentVS = 0;
 	SimplePixelShader* currentPS = 0;
 	Material* currentMaterial = 0;
 	Mesh* currentMesh = 0;
-	for (auto ge : toDraw) {
-		// skip refractive materials
-		if (ge->GetMaterial()->IsRefractive())
-		{
-			refractiveEntities.push_back(ge);
-			continue;
-		}
+	for (auto& group : drawGroups) {
+		const SubmeshDraw& draw = opaqueDraws[group.Start];
+		Material* material = draw.Mat;
+		Mesh* mesh = draw.Entity->GetMesh();
+		const Submesh& submesh = mesh->GetSubmesh(draw.Submesh);
+
+		unsigned int instanceCount = group.Count;
+		bool useInstancing = instanceCount > 1;
+		SimpleVertexShader* vs = group.VS;
 
-		// track current material
-		if (currentMaterial != ge->GetMaterial()) {
-			currentMaterial = ge->GetMaterial();
+		// track current material (and which vs holds its data)
+		if (currentMaterial != material || currentVS != vs) {
+			currentMaterial = material;
 
 			// swap vertex shader if necessary
-			if (currentVS != currentMaterial->GetVS()) {
-				currentVS = currentMaterial->GetVS();
+			if (currentVS != vs) {
+				currentVS = vs;
 				currentVS->SetShader();
 
-				context->VSSetConstantBuffers(0, 1, vsPerFrameConstantBuffer.GetAddressOf());
+				stateCache->SetConstantBuffer(SIMPLE_STAGE_VERTEX, 0, vsPerFrameConstantBuffer.Get());
 			}
 
 			// swap pixel shader if necessary
 			if (currentPS != currentMaterial->GetPS()) {
 				currentPS = currentMaterial->GetPS();
-				currentPS->SetShaderResourceView("BrdfLookUpMap", sky->GetBRDFLookUpTexture());
-				currentPS->SetShaderResourceView("IrradianceIBLMap", sky->GetIrradianceMap());
-				currentPS->SetShaderResourceView("SpecularIBLMap", sky->GetConvolvedSpecularMap());
+				currentPS->SetShaderResourceView(brdfLookUpMapHandle, sky->GetBRDFLookUpTexture());
+				currentPS->SetShaderResourceView(irradianceIBLMapHandle, sky->GetIrradianceMap());
+				currentPS->SetShaderResourceView(specularIBLMapHandle, sky->GetConvolvedSpecularMap());
 				currentPS->SetShader();
 
-				context->PSSetConstantBuffers(0, 1, psPerFrameConstantBuffer.GetAddressOf());
+				stateCache->SetConstantBuffer(SIMPLE_STAGE_PIXEL, 0, psPerFrameConstantBuffer.Get());
 			}
 
+			// sub in the group's vs (maybe the instanced variant)
+			// so the per material data lands in it
+			SimpleVertexShader* prevVS = currentMaterial->GetVS();
+			currentMaterial->SetVS(currentVS);
 			currentMaterial->SetPerMaterialDataAndResources(true);
+			currentMaterial->SetVS(prevVS);
 		}
 
-		if (currentMesh != ge->GetMesh()) {
-			currentMesh = ge->GetMesh();
+		// submeshes share their mesh's buffers, so only a new mesh rebinds
+		if (currentMesh != mesh) {
+			currentMesh = mesh;
 
-			UINT stride = sizeof(Vertex);
+			UINT stride = currentMesh->GetVertexStride();
 			UINT offset = 0;
 			context->IASetVertexBuffers(0, 1, currentMesh->GetVertexBuffer().GetAddressOf(), &stride, &offset);
-			context->IASetIndexBuffer(currentMesh->GetIndexBuffer().Get(), DXGI_FORMAT_R32_UINT, 0);
+			context->IASetIndexBuffer(currentMesh->GetIndexBuffer().Get(), currentMesh->GetIndexFormat(), 0);
 		}
 
-		if (currentVS != 0) {
-			Transform* trans = ge->GetTransform();
-			currentVS->SetMatrix4x4("world", trans->GetWorldMatrix());
-			currentVS->SetMatrix4x4("worldInverseTranspose", trans->GetWorldInverseTransposeMatrix());
-			currentVS->CopyBufferData("perObject");
+		if (useInstancing) {
+			// matrices are already in the instance buffer
+			context->DrawIndexedInstanced(submesh.IndexCount, instanceCount, submesh.IndexStart, submesh.BaseVertex, group.Start);
+
+			stats.InstancedGroups++;
+			stats.DrawCallsSaved += instanceCount - 1;
 		}
+		else {
+			if (group.PerObject.NumConstants > 0) {
+				// data is already in the ring, just point the vs at it
+				currentVS->SetConstantBufferSlice(perObjectHandle, perObjectRing->GetBuffer(), group.PerObject.FirstConstant, group.PerObject.NumConstants);
+				stats.RingSlices++;
+			}
+			else {
+				// the ring ran out this frame - an earlier draw may have
+				// left a slice of it bound, so put the vs's buffer back
+				currentVS->RestoreConstantBuffer(perObjectHandle);
+				currentVS->SetMatrix4x4(worldHandle, instanceData[group.Start].World);
+				currentVS->SetData(normalMatrixHandle, &instanceData[group.Start].Normal, sizeof(NormalMatrix));
+				currentVS->CopyBufferData(perObjectHandle);
+			}
 
-		if (currentMesh != 0) {
-			context->DrawIndexed(currentMesh->GetIndexCount(), 0, 0);
+			context->DrawIndexed(submesh.IndexCount, submesh.IndexStart, submesh.BaseVertex);
 		}
+		stats.DrawCalls++;
 	}
 
 	// Draw the light sources
@@ -260,7 +445,7 @@ void Renderer::Render(Camera* camera, float totalTime)
 	renderTargets[0] = backBufferRTV.Get();
 	context->OMSetRenderTargets(1, renderTargets, 0);
 	simpleTexturePS->SetShader();
-	simpleTexturePS->SetShaderResourceView("Pixels", sceneColorsSRV);
+	simpleTexturePS->SetShaderResourceView(pixelsHandle, sceneColorsSRV);
 	context->Draw(3, 0);
 
 	// Loop and render the refractive objects to the silhouette texture (if use silhouettes)
@@ -273,10 +458,12 @@ void Renderer::Render(Camera* camera, float totalTime)
 		context->OMSetDepthStencilState(refractionSilhouetteDepthState.Get(), 0);
 
 		// Loop and draw each one
-		for (auto ge : refractiveEntities)
+		for (auto& draw : refractiveDraws)
 		{
+			GameEntity* ge = draw.Entity;
+
 			// Get this material and sub the refraction PS for now
-			Material* mat = ge->GetMaterial();
+			Material* mat = draw.Mat;
 			SimplePixelShader* prevPS = mat->GetPS();
 			mat->SetPS(solidColorPS);
 
@@ -285,14 +472,15 @@ void Renderer::Render(Camera* camera, float totalTime)
 			mat->SetPerMaterialDataAndResources(true);
 
 			// Set up the refraction specific data
-			solidColorPS->SetFloat3("Color", XMFLOAT3(1, 1, 1));
-			solidColorPS->CopyBufferData("externalData");
+			solidColorPS->SetFloat3(colorHandle, XMFLOAT3(1, 1, 1));
+			solidColorPS->CopyBufferData(externalDataHandle);
 
 			// Reset "per frame" buffer for VS
-			context->VSSetConstantBuffers(0, 1, vsPerFrameConstantBuffer.GetAddressOf());
+			stateCache->SetConstantBuffer(SIMPLE_STAGE_VERTEX, 0, vsPerFrameConstantBuffer.Get());
 
 			// Draw
-			ge->GetMesh()->SetBuffersAndDraw(context);
+			ge->GetMesh()->SetBuffers(context);
+			ge->GetMesh()->DrawSubmesh(context, draw.Submesh);
 
 			// Reset this material's PS
 			mat->SetPS(prevPS);
@@ -306,9 +494,10 @@ void Renderer::Render(Camera* camera, float totalTime)
 	renderTargets[0] = backBufferRTV.Get();
 	context->OMSetRenderTargets(1, renderTargets, depthBufferDSV.Get());
 
-	for (auto ge : refractiveEntities)
+	for (auto& draw : refractiveDraws)
 	{
-		Material* material = ge->GetMaterial();
+		GameEntity* ge = draw.Entity;
+		Material* material = draw.Mat;
 		SimplePixelShader* prevPS = material->GetPS();
 		material->SetPS(refractionPS);
 
@@ -317,26 +506,27 @@ void Renderer::Render(Camera* camera, float totalTime)
 		material->SetPerMaterialDataAndResources(true);
 
 		// Set up the refraction specific data
-		refractionPS->SetFloat2("screenSize", XMFLOAT2((float)windowWidth, (float)windowHeight));
-		refractionPS->SetMatrix4x4("viewMatrix", camera->GetView());
-		refractionPS->SetMatrix4x4("projMatrix", camera->GetProjection());
-		refractionPS->SetInt("useRefractionSilhouette", useRefractionSilhouette);
-		refractionPS->SetInt("refractionFromNormalMap", refractionFromNormalMap);
-		refractionPS->SetFloat("indexOfRefraction", indexOfRefraction);
-		refractionPS->SetFloat("refractionScale", refractionScale);
-		refractionPS->CopyBufferData("perObject");
+		refractionPS->SetFloat2(screenSizeHandle, XMFLOAT2((float)windowWidth, (float)windowHeight));
+		refractionPS->SetMatrix4x4(viewMatrixHandle, camera->GetView());
+		refractionPS->SetMatrix4x4(projMatrixHandle, camera->GetProjection());
+		refractionPS->SetInt(useRefractionSilhouetteHandle, useRefractionSilhouette);
+		refractionPS->SetInt(refractionFromNormalMapHandle, refractionFromNormalMap);
+		refractionPS->SetFloat(indexOfRefractionHandle, indexOfRefraction);
+		refractionPS->SetFloat(refractionScaleHandle, refractionScale);
+		refractionPS->CopyBufferData(perObjectHandle);
 
 		// Set textures
-		refractionPS->SetShaderResourceView("ScreenPixels", sceneColorsSRV);
-		refractionPS->SetShaderResourceView("RefractionSilhouette", silhouetteSRV);
-		refractionPS->SetShaderResourceView("EnvironmentMap", sky->GetSkySRV());
+		refractionPS->SetShaderResourceView(screenPixelsHandle, sceneColorsSRV);
+		refractionPS->SetShaderResourceView(refractionSilhouetteHandle, silhouetteSRV);
+		refractionPS->SetShaderResourceView(environmentMapHandle, sky->GetSkySRV());
 
 		// Reset "per frame" buffers
-		context->VSSetConstantBuffers(0, 1, vsPerFrameConstantBuffer.GetAddressOf());
-		context->PSSetConstantBuffers(0, 1, psPerFrameConstantBuffer.GetAddressOf());
+		stateCache->SetConstantBuffer(SIMPLE_STAGE_VERTEX, 0, vsPerFrameConstantBuffer.Get());
+		stateCache->SetConstantBuffer(SIMPLE_STAGE_PIXEL, 0, psPerFrameConstantBuffer.Get());
 
 		// Draw
-		ge->GetMesh()->SetBuffersAndDraw(context);
+		ge->GetMesh()->SetBuffers(context);
+		ge->GetMesh()->DrawSubmesh(context, draw.Submesh);
 
 		// Reset this material's PS
 		material->SetPS(prevPS);
@@ -375,6 +565,50 @@ void Renderer::Render(Camera* camera, float totalTime)
 
 	ID3D11ShaderResourceView* nullSRVs[16] = {};
 	context->PSSetShaderResources(0, 16, nullSRVs);
+
+	// ImGui and the unbind above went around the state cache
+	stats.BindCallsIssued = stateCache->GetCallsIssued();
+	stats.BindCallsFiltered = stateCache->GetCallsFiltered();
+	stateCache->Invalidate();
+
+	stats.FrameAllocations = AllocationCounter::GetCount() - frameAllocStart;
+	stats.ConstantBytesUploaded = ISimpleShader::BytesUploaded;
+	stats.ConstantUploadsSkipped = ISimpleShader::UploadsSkipped;
+}
+
+void Renderer::AddEntity(GameEntity* entity)
+{
+	DrawListEntry entry;
+	entry.Entity = entity;
+	entry.MeshID = entity->GetMesh()->GetSortID();
+	drawList.push_back(entry);
+
+	entity->SetListener(this);
+}
+
+void Renderer::RemoveEntity(GameEntity* entity)
+{
+	for (size_t i = 0; i < drawList.size(); i++) {
+		if (drawList[i].Entity != entity)
+			continue;
+
+		// order doesn't matter, everything is sorted each frame
+		drawList[i] = drawList.back();
+		drawList.pop_back();
+
+		entity->SetListener(0);
+		return;
+	}
+}
+
+void Renderer::OnDrawStateChanged(GameEntity* entity)
+{
+	for (auto& entry : drawList) {
+		if (entry.Entity == entity) {
+			entry.MeshID = entity->GetMesh()->GetSortID();
+			return;
+		}
+	}
 }
 
 Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Renderer::GetColorsRenderTargetSRV()
@@ -397,6 +631,78 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Renderer::GetSilhouetteRenderTa
 	return silhouetteSRV;
 }
 
+// --------------------------------------------------------
+// The instanced variant of a vertex shader, or null if
+// there isn't one and its draws can't be instanced
+// --------------------------------------------------------
+SimpleVertexShader* Renderer::GetInstancedVS(SimpleVertexShader* vs)
+{
+	auto variant = instancedVariants.find(vs);
+	return variant == instancedVariants.end() ? 0 : variant->second;
+}
+
+void Renderer::EnsureInstanceBufferCapacity(unsigned int count)
+{
+	if (instanceBuffer && count <= instanceCapacity)
+		return;
+
+	// grow geometrically so a few new entities don't recreate it every frame
+	instanceCapacity = instanceCapacity > 0 ? instanceCapacity : 64;
+	while (instanceCapacity < count)
+		instanceCapacity *= 2;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = sizeof(InstanceData) * instanceCapacity;
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	instanceBuffer.Reset();
+	device->CreateBuffer(&desc, 0, instanceBuffer.GetAddressOf());
+}
+
+void Renderer::CullEntities(Camera* camera)
+{
+	auto cullStart = std::chrono::high_resolution_clock::now();
+
+	frustumCuller = camera->GetFrustum();
+
+	// gather world space spheres for the batch test
+	size_t count = drawList.size();
+	worldSpheres.resize(count);
+	visibility.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		worldSpheres[i] = drawList[i].Entity->GetWorldSphere();
+	}
+
+	// the sphere tests are pure math, so large scenes spread them
+	// over the job system (the gather above touches transforms,
+	// which update lazily and share parents, so it stays here)
+	if (jobs) {
+		jobs->ParallelFor((unsigned int)count, 4096, [this](unsigned int begin, unsigned int end) {
+			frustumCuller.CullSpheresSIMD(worldSpheres.data() + begin, end - begin, visibility.data() + begin);
+		});
+	}
+	else {
+		frustumCuller.CullSpheresSIMD(worldSpheres.data(), (unsigned int)count, visibility.data());
+	}
+
+	// spheres are loose around long, thin blocks, so refine the
+	// survivors with their boxes
+	visibleIndices.clear();
+	for (size_t i = 0; i < count; i++) {
+		if (visibility[i] && frustumCuller.IsVisible(drawList[i].Entity->GetWorldAABB())) {
+			visibleIndices.push_back((unsigned int)i);
+		}
+	}
+
+	auto cullEnd = std::chrono::high_resolution_clock::now();
+
+	stats.EntitiesVisible = (unsigned int)visibleIndices.size();
+	stats.EntitiesCulled = (unsigned int)(count - visibleIndices.size());
+	stats.CullMilliseconds = std::chrono::duration<float, std::milli>(cullEnd - cullStart).count();
+}
+
 void Renderer::DrawPointLights(Camera* camera)
 {
 	// Turn on these shaders
@@ -404,8 +710,8 @@ void Renderer::DrawPointLights(Camera* camera)
 	lightPS->SetShader();
 
 	// Set up vertex shader
-	lightVS->SetMatrix4x4("view", camera->GetView());
-	lightVS->SetMatrix4x4("projection", camera->GetProjection());
+	lightVS->SetMatrix4x4(viewHandle, camera->GetView());
+	lightVS->SetMatrix4x4(projectionHandle, camera->GetProjection());
 
 	for (int i = 0; i < lightCount; i++)
 	{
@@ -426,20 +732,25 @@ void Renderer::DrawPointLights(Camera* camera)
 		XMMATRIX worldMat = scaleMat * rotMat * transMat;
 
 		XMFLOAT4X4 world;
-		XMFLOAT4X4 worldInvTrans;
 		XMStoreFloat4x4(&world, worldMat);
-		XMStoreFloat4x4(&worldInvTrans, XMMatrixInverse(0, XMMatrixTranspose(worldMat)));
+
+		// No rotation and the same scale on every axis, so the
+		// inverse transpose is just one over the scale
+		NormalMatrix normalMatrix = {};
+		normalMatrix.Rows[0].x = 1.0f / scale;
+		normalMatrix.Rows[1].y = 1.0f / scale;
+		normalMatrix.Rows[2].z = 1.0f / scale;
 
 		// Set up the world matrix for this light
-		lightVS->SetMatrix4x4("world", world);
-		lightVS->SetMatrix4x4("worldInverseTranspose", worldInvTrans);
+		lightVS->SetMatrix4x4(worldHandle, world);
+		lightVS->SetData(normalMatrixHandle, &normalMatrix, sizeof(NormalMatrix));
 
 		// Set up the pixel shader data
 		XMFLOAT3 finalColor = light.Color;
 		finalColor.x *= light.Intensity;
 		finalColor.y *= light.Intensity;
 		finalColor.z *= light.Intensity;
-		lightPS->SetFloat3("Color", finalColor);
+		lightPS->SetFloat3(colorHandle, finalColor);
 
 		// Copy data
 		lightVS->CopyAllBufferData();
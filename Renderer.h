@@ -7,8 +7,13 @@
 #include "Lights.h"
 #include "Emitter.h"
 #include "Sky.h"
+#include "FrustumCuller.h"
+#include "DrawSorter.h"
+#include "ConstantBufferRing.h"
+#include "JobSystem.h"
 
 #include <wrl/client.h>
+#include <unordered_map>
 
 struct VSPerFrameData 
 {
@@ -24,7 +29,61 @@ struct PSPerFrameData
 	int SpecIBLTotalMipLevels;
 };
 
-class Renderer
+// Per-instance data for the instanced vertex shader,
+// laid out to match its _PER_INSTANCE inputs
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 World;
+	NormalMatrix Normal;
+};
+
+// Numbers from the most recent frame, for the stats window
+struct RenderStats
+{
+	unsigned int EntitiesVisible;
+	unsigned int EntitiesCulled;
+	float CullMilliseconds;
+	unsigned int DrawCalls;
+	unsigned int DrawCallsSaved;
+	unsigned int InstancedGroups;
+	unsigned int RingSlices;
+	unsigned int DrawListAllocations;
+	unsigned int FrameAllocations;
+	unsigned int ConstantBytesUploaded;
+	unsigned int ConstantUploadsSkipped;
+	unsigned int BindCallsIssued;
+	unsigned int BindCallsFiltered;
+};
+
+// An entity in the persistent draw list, along with the
+// id of the mesh it had when last updated
+struct DrawListEntry
+{
+	GameEntity* Entity;
+	unsigned int MeshID;
+};
+
+// One submesh of a visible entity and the material it draws
+// with - entities with several submeshes make several of these
+struct SubmeshDraw
+{
+	GameEntity* Entity;
+	Material* Mat;
+	unsigned int Submesh;
+};
+
+// A run of sorted opaque submesh draws that share a mesh,
+// submesh and material, the vertex shader that draws them,
+// plus the ring slice for single draws
+struct DrawGroup
+{
+	unsigned int Start;
+	unsigned int Count;
+	SimpleVertexShader* VS;
+	ConstantBufferSlice PerObject;
+};
+
+class Renderer : public IGameEntityListener
 {
 
 public:
@@ -55,11 +114,25 @@ public:
 	void PostResize(unsigned int windowWidth, unsigned int windowHeight, Microsoft::WRL::ComPtr<ID3D11RenderTargetView> backBufferRTV, Microsoft::WRL::ComPtr<ID3D11DepthStencilView> depthBufferDSV);
 	void Render(Camera* camera, float totalTime);
 
+	// The draw list only changes through these, not every frame
+	void AddEntity(GameEntity* entity);
+	void RemoveEntity(GameEntity* entity);
+	void OnDrawStateChanged(GameEntity* entity);
+
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetColorsRenderTargetSRV();
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetNormalsRenderTargetSRV();
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetDepthsRenderTargetSRV();
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetSilhouetteRenderTargetSRV();
 
+	const RenderStats& GetStats() { return stats; }
+
+	// Optional - big scenes split the culling tests across its workers
+	void SetJobSystem(JobSystem* jobs) { this->jobs = jobs; }
+
+	// Materials using vs get instanced with instancedVS - anything
+	// without one still draws, just one entity at a time
+	void SetInstancedVS(SimpleVertexShader* vs, SimpleVertexShader* instancedVS) { instancedVariants[vs] = instancedVS; }
+
 private:
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
@@ -98,7 +171,6 @@ private:
 
 	Sky* sky;
 	TerrainEntity* terrain;
-	const std::vector<GameEntity*>& entities;
 	const std::vector<Light>& lights;
 	const std::vector<Emitter*>& emitters;
 	int& lightCount;
@@ -114,6 +186,63 @@ private:
 	PSPerFrameData psPerFrameData;
 	VSPerFrameData vsPerFrameData;
 
+	// every entity to draw, kept up to date by change notifications
+	std::vector<DrawListEntry> drawList;
+
+	// frustum culling, with buffers kept between frames
+	JobSystem* jobs;
+	FrustumCuller frustumCuller;
+	std::vector<Sphere> worldSpheres;
+	std::vector<unsigned char> visibility;
+	std::vector<unsigned int> visibleIndices;
+
+	// a draw per submesh of everything that survived culling,
+	// their sort keys, and the sorted draws split by pass
+	std::vector<SubmeshDraw> submeshDraws;
+	DrawSorter drawSorter;
+	std::vector<SubmeshDraw> opaqueDraws;
+	std::vector<SubmeshDraw> refractiveDraws;
+
+	// instancing for entities that share a mesh and material,
+	// with the instanced variant of each vertex shader that has one
+	std::unordered_map<SimpleVertexShader*, SimpleVertexShader*> instancedVariants;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> instanceBuffer;
+	unsigned int instanceCapacity;
+	std::vector<InstanceData> instanceData;
+	std::vector<DrawGroup> drawGroups;
+
+	// per object constant buffer data for non-instanced draws
+	ConstantBufferRing* perObjectRing;
+	SimpleStateCache* stateCache;
+
+	RenderStats stats;
+
+	// shader handles, resolved once in the constructor
+	SimpleBufferHandle perObjectHandle;
+	SimpleBufferHandle externalDataHandle;
+	SimpleVariableHandle worldHandle;
+	SimpleVariableHandle normalMatrixHandle;
+	SimpleVariableHandle viewHandle;
+	SimpleVariableHandle projectionHandle;
+	SimpleVariableHandle colorHandle;
+	SimpleVariableHandle screenSizeHandle;
+	SimpleVariableHandle viewMatrixHandle;
+	SimpleVariableHandle projMatrixHandle;
+	SimpleVariableHandle useRefractionSilhouetteHandle;
+	SimpleVariableHandle refractionFromNormalMapHandle;
+	SimpleVariableHandle indexOfRefractionHandle;
+	SimpleVariableHandle refractionScaleHandle;
+	SimpleSRVHandle brdfLookUpMapHandle;
+	SimpleSRVHandle irradianceIBLMapHandle;
+	SimpleSRVHandle specularIBLMapHandle;
+	SimpleSRVHandle pixelsHandle;
+	SimpleSRVHandle screenPixelsHandle;
+	SimpleSRVHandle refractionSilhouetteHandle;
+	SimpleSRVHandle environmentMapHandle;
+
+	void CullEntities(Camera* camera);
+	SimpleVertexShader* GetInstancedVS(SimpleVertexShader* vs);
+	void EnsureInstanceBufferCapacity(unsigned int count);
 	void DrawPointLights(Camera* camera); // fix this interfacing with ImGui at some point
 	void CreateRenderTarget(
 		unsigned int width,
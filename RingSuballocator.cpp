@@ -0,0 +1,48 @@
+#include "RingSuballocator.h"
+
+RingSuballocator::RingSuballocator(unsigned int capacity, unsigned int alignment) :
+	capacity(capacity),
+	alignment(alignment > 0 ? alignment : 1),
+	used(0),
+	requested(0)
+{
+}
+
+void RingSuballocator::Reset()
+{
+	used = 0;
+	requested = 0;
+}
+
+void RingSuballocator::Resize(unsigned int capacity)
+{
+	this->capacity = capacity;
+	Reset();
+}
+
+bool RingSuballocator::Allocate(unsigned int size, unsigned int* offsetOut)
+{
+	unsigned int alignedSize = AlignUp(size, alignment);
+	requested += alignedSize;
+
+	// Every allocation starts aligned, since every size is rounded up
+	if (alignedSize == 0 || alignedSize > capacity - used)
+		return false;
+
+	*offsetOut = used;
+	used += alignedSize;
+	return true;
+}
+
+unsigned int RingSuballocator::GetCapacityNeeded()
+{
+	unsigned int needed = capacity > 0 ? capacity : alignment;
+	while (needed < requested)
+		needed *= 2;
+	return needed;
+}
+
+unsigned int RingSuballocator::AlignUp(unsigned int value, unsigned int alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
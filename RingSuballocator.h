@@ -0,0 +1,39 @@
+#pragma once
+
+// --------------------------------------------------------
+// Hands out aligned byte ranges from a fixed size block,
+// front to back, until Reset() is called.  Only tracks
+// offsets - it never touches the memory itself - so it can
+// be used (and checked) without a device.
+// --------------------------------------------------------
+class RingSuballocator
+{
+public:
+	RingSuballocator(unsigned int capacity, unsigned int alignment);
+
+	void Reset();
+	void Resize(unsigned int capacity);
+
+	// Returns false (and leaves offsetOut alone) when it doesn't fit
+	bool Allocate(unsigned int size, unsigned int* offsetOut);
+
+	unsigned int GetCapacity() { return capacity; }
+	unsigned int GetAlignment() { return alignment; }
+	unsigned int GetUsed() { return used; }
+
+	// Total bytes asked for since the last reset, including
+	// anything that didn't fit - useful for picking a new size
+	unsigned int GetRequested() { return requested; }
+
+	// The capacity, doubled until everything requested since the
+	// last reset would have fit
+	unsigned int GetCapacityNeeded();
+
+	static unsigned int AlignUp(unsigned int value, unsigned int alignment);
+
+private:
+	unsigned int capacity;
+	unsigned int alignment;
+	unsigned int used;
+	unsigned int requested;
+};
@@ -0,0 +1,67 @@
+#include "SelfTest.h"
+#include "RingSuballocator.h"
+
+// Constant buffer slices, as ConstantBufferRing uses it
+#define SLOT_ALIGNMENT 256
+
+void RingSuballocatorTest()
+{
+	RingSuballocator ring(4 * SLOT_ALIGNMENT, SLOT_ALIGNMENT);
+
+	// Every size rounds up to whole slots, so each offset lands
+	// on a slot boundary no matter what came before
+	unsigned int offsets[4];
+	SELF_TEST_CHECK(ring.Allocate(64, &offsets[0]));
+	SELF_TEST_CHECK(ring.Allocate(256, &offsets[1]));
+	SELF_TEST_CHECK(ring.Allocate(300, &offsets[2]));
+	SELF_TEST_CHECK(offsets[0] == 0);
+	SELF_TEST_CHECK(offsets[1] == 256);
+	SELF_TEST_CHECK(offsets[2] == 512);
+	SELF_TEST_CHECK(ring.GetUsed() == 1024);
+
+	// Full, so anything else fails and leaves the offset alone
+	unsigned int untouched = 12345;
+	SELF_TEST_CHECK(!ring.Allocate(16, &untouched));
+	SELF_TEST_CHECK(untouched == 12345);
+	SELF_TEST_CHECK(ring.GetUsed() == 1024);
+
+	// Zero byte requests never succeed
+	SELF_TEST_CHECK(!ring.Allocate(0, &untouched));
+
+	// The shortfall is still counted, so the next Begin() knows
+	// to grow, and by how much
+	SELF_TEST_CHECK(ring.GetRequested() == 1024 + 256);
+	SELF_TEST_CHECK(ring.GetCapacityNeeded() == 8 * SLOT_ALIGNMENT);
+	ring.Resize(ring.GetCapacityNeeded());
+	SELF_TEST_CHECK(ring.GetCapacity() == 8 * SLOT_ALIGNMENT);
+	SELF_TEST_CHECK(ring.GetUsed() == 0);
+	SELF_TEST_CHECK(ring.GetRequested() == 0);
+
+	// A whole frame's worth now fits
+	unsigned int offset = 0;
+	for (int i = 0; i < 5; i++)
+		SELF_TEST_CHECK(ring.Allocate(200, &offset));
+	SELF_TEST_CHECK(offset == 4 * SLOT_ALIGNMENT);
+	SELF_TEST_CHECK(ring.GetRequested() <= ring.GetCapacity());
+	SELF_TEST_CHECK(ring.GetCapacityNeeded() == ring.GetCapacity());
+
+	// Resetting for the next frame wraps back to the start
+	ring.Reset();
+	SELF_TEST_CHECK(ring.Allocate(16, &offset));
+	SELF_TEST_CHECK(offset == 0);
+
+	// Filling exactly to the end, then wrapping again
+	ring.Reset();
+	for (int i = 0; i < 8; i++)
+		SELF_TEST_CHECK(ring.Allocate(SLOT_ALIGNMENT, &offset));
+	SELF_TEST_CHECK(offset == 7 * SLOT_ALIGNMENT);
+	SELF_TEST_CHECK(!ring.Allocate(1, &offset));
+	ring.Reset();
+	SELF_TEST_CHECK(ring.Allocate(SLOT_ALIGNMENT, &offset));
+	SELF_TEST_CHECK(offset == 0);
+
+	SELF_TEST_CHECK(RingSuballocator::AlignUp(0, SLOT_ALIGNMENT) == 0);
+	SELF_TEST_CHECK(RingSuballocator::AlignUp(1, SLOT_ALIGNMENT) == 256);
+	SELF_TEST_CHECK(RingSuballocator::AlignUp(256, SLOT_ALIGNMENT) == 256);
+	SELF_TEST_CHECK(RingSuballocator::AlignUp(257, SLOT_ALIGNMENT) == 512);
+}
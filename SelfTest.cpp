@@ -0,0 +1,68 @@
+#include "SelfTest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+unsigned int SelfTest::checks = 0;
+unsigned int SelfTest::failures = 0;
+
+struct SelfTestEntry
+{
+	const char* Name;
+	void (*Function)();
+};
+
+static const SelfTestEntry tests[] =
+{
+	{ "ringsuballocator", RingSuballocatorTest },
+	{ "shadercache", ShaderCacheTest },
+	{ "meshoptimizer", MeshOptimizerTest },
+	{ "vertexcompression", VertexCompressionTest },
+	{ "levelfile", LevelFileTest },
+	{ "transform", TransformTest },
+	{ "intersection", IntersectionTest },
+};
+
+bool SelfTest::Run(const char* name)
+{
+	unsigned int testsRun = 0;
+	for (const SelfTestEntry& test : tests)
+	{
+		if (name && strcmp(name, test.Name) != 0)
+			continue;
+
+		unsigned int failuresBefore = failures;
+		test.Function();
+		testsRun++;
+		printf("  %-20s %s\n", test.Name, failures == failuresBefore ? "passed" : "FAILED");
+	}
+
+	if (testsRun == 0)
+	{
+		printf("No test named %s\n", name);
+		return false;
+	}
+
+	printf("%u tests, %u checks, %u failed\n", testsRun, checks, failures);
+	return failures == 0;
+}
+
+void SelfTest::Check(bool passed, const char* expression, const char* file, int line)
+{
+	checks++;
+	if (passed)
+		return;
+
+	failures++;
+	printf("%s(%d): check failed: %s\n", file, line, expression);
+}
+
+void SelfTest::CheckAtMost(double value, double bound, const char* expression, const char* file, int line)
+{
+	checks++;
+	if (value <= bound)
+		return;
+
+	failures++;
+	printf("%s(%d): check failed: %s is %g, more than %g\n", file, line, expression, value, bound);
+}
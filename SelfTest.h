@@ -0,0 +1,40 @@
+#pragma once
+
+// --------------------------------------------------------
+// Headless checks for the parts of the engine that don't
+// need a device - run with -selftest [name] instead of the
+// game.  Each test is a function that makes checks, and a
+// failed check prints where it was and keeps going, so one
+// run shows everything that's wrong.  Only uses the C
+// runtime, so tests build on any platform along with the
+// code they cover.
+// --------------------------------------------------------
+class SelfTest
+{
+public:
+	// Runs every test, or only the one with the given name (if
+	// not null), printing each failure and a summary.  Returns
+	// true if every check passed.
+	static bool Run(const char* name);
+
+	static void Check(bool passed, const char* expression, const char* file, int line);
+
+	// For error bounds - prints the value that was too large
+	static void CheckAtMost(double value, double bound, const char* expression, const char* file, int line);
+
+private:
+	static unsigned int checks;
+	static unsigned int failures;
+};
+
+#define SELF_TEST_CHECK(condition) SelfTest::Check((condition), #condition, __FILE__, __LINE__)
+#define SELF_TEST_CHECK_AT_MOST(value, bound) SelfTest::CheckAtMost((value), (bound), #value, __FILE__, __LINE__)
+
+// The tests themselves, each in the file named after it
+void RingSuballocatorTest();
+void ShaderCacheTest();
+void MeshOptimizerTest();
+void VertexCompressionTest();
+void LevelFileTest();
+void TransformTest();
+void IntersectionTest();
@@ -0,0 +1,234 @@
+#include "ShaderCache.h"
+#include "Hashing.h"
+
+#include <string.h>
+
+// "SSHC", read as a little-endian uint32
+#define SHADER_CACHE_MAGIC 0x43485353u
+
+// --------------------------------------------------------
+// Writing helpers - everything is stored little-endian, one
+// byte at a time, so the layout doesn't depend on the host
+// --------------------------------------------------------
+static void WriteU32(std::vector<unsigned char>& out, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		out.push_back((unsigned char)(value >> (i * 8)));
+}
+
+static void WriteU64(std::vector<unsigned char>& out, uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+		out.push_back((unsigned char)(value >> (i * 8)));
+}
+
+static void WriteString(std::vector<unsigned char>& out, const std::string& str)
+{
+	WriteU32(out, (uint32_t)str.size());
+	out.insert(out.end(), str.begin(), str.end());
+}
+
+static void WriteParameters(std::vector<unsigned char>& out, const std::vector<ShaderCacheParameter>& params)
+{
+	WriteU32(out, (uint32_t)params.size());
+	for (auto& p : params)
+	{
+		WriteString(out, p.SemanticName);
+		WriteU32(out, p.SemanticIndex);
+		WriteU32(out, p.Mask);
+		WriteU32(out, p.ComponentType);
+		WriteU32(out, p.Stream);
+	}
+}
+
+// --------------------------------------------------------
+// Reading helpers - every read is bounds checked and sets
+// the reader's failed flag instead of running off the end
+// --------------------------------------------------------
+struct CacheReader
+{
+	const unsigned char* Data;
+	size_t Size;
+	size_t Offset;
+	bool Failed;
+
+	bool Has(size_t bytes)
+	{
+		if (Failed || bytes > Size - Offset)
+		{
+			Failed = true;
+			return false;
+		}
+		return true;
+	}
+
+	uint32_t ReadU32()
+	{
+		if (!Has(4)) return 0;
+		uint32_t value = 0;
+		for (int i = 0; i < 4; i++)
+			value |= (uint32_t)Data[Offset + i] << (i * 8);
+		Offset += 4;
+		return value;
+	}
+
+	uint64_t ReadU64()
+	{
+		if (!Has(8)) return 0;
+		uint64_t value = 0;
+		for (int i = 0; i < 8; i++)
+			value |= (uint64_t)Data[Offset + i] << (i * 8);
+		Offset += 8;
+		return value;
+	}
+
+	std::string ReadString()
+	{
+		uint32_t length = ReadU32();
+		if (!Has(length)) return std::string();
+		std::string str((const char*)Data + Offset, length);
+		Offset += length;
+		return str;
+	}
+
+	// Counts come from the file, so make sure they could possibly
+	// fit before anything is sized from them
+	uint32_t ReadCount(size_t minBytesEach)
+	{
+		uint32_t count = ReadU32();
+		if (!Failed && minBytesEach > 0 && count > (Size - Offset) / minBytesEach)
+			Failed = true;
+		return Failed ? 0 : count;
+	}
+};
+
+static void ReadParameters(CacheReader& reader, std::vector<ShaderCacheParameter>& params)
+{
+	uint32_t count = reader.ReadCount(20);
+	params.resize(count);
+	for (auto& p : params)
+	{
+		p.SemanticName = reader.ReadString();
+		p.SemanticIndex = reader.ReadU32();
+		p.Mask = reader.ReadU32();
+		p.ComponentType = reader.ReadU32();
+		p.Stream = reader.ReadU32();
+	}
+}
+
+// --------------------------------------------------------
+// Layout: magic, version, key, source size and write time,
+// bytecode, then each table as a count followed by its
+// entries.  Strings are a length followed by the characters,
+// with no terminator.
+// --------------------------------------------------------
+void ShaderCache::Serialize(ShaderCacheEntry& entry, std::vector<unsigned char>& out)
+{
+	entry.Key = Hashing::FNV1a(entry.Bytecode.data(), entry.Bytecode.size());
+
+	out.clear();
+	WriteU32(out, SHADER_CACHE_MAGIC);
+	WriteU32(out, Version);
+	WriteU64(out, entry.Key);
+	WriteU64(out, entry.SourceSize);
+	WriteU64(out, entry.SourceWriteTime);
+
+	WriteU32(out, (uint32_t)entry.Bytecode.size());
+	out.insert(out.end(), entry.Bytecode.begin(), entry.Bytecode.end());
+
+	WriteU32(out, (uint32_t)entry.ConstantBuffers.size());
+	for (auto& cb : entry.ConstantBuffers)
+	{
+		WriteString(out, cb.Name);
+		WriteU32(out, cb.Type);
+		WriteU32(out, cb.Size);
+		WriteU32(out, cb.BindIndex);
+		WriteU32(out, (uint32_t)cb.Variables.size());
+		for (auto& v : cb.Variables)
+		{
+			WriteString(out, v.Name);
+			WriteU32(out, v.ByteOffset);
+			WriteU32(out, v.Size);
+		}
+	}
+
+	WriteU32(out, (uint32_t)entry.Resources.size());
+	for (auto& r : entry.Resources)
+	{
+		WriteString(out, r.Name);
+		WriteU32(out, r.Type);
+		WriteU32(out, r.BindIndex);
+	}
+
+	WriteParameters(out, entry.InputParameters);
+	WriteParameters(out, entry.OutputParameters);
+
+	for (int i = 0; i < 3; i++)
+		WriteU32(out, entry.ThreadGroupSize[i]);
+}
+
+bool ShaderCache::Deserialize(const unsigned char* data, size_t size, ShaderCacheEntry* entry)
+{
+	CacheReader reader = { data, size, 0, false };
+
+	if (reader.ReadU32() != SHADER_CACHE_MAGIC || reader.ReadU32() != Version)
+		return false;
+
+	entry->Key = reader.ReadU64();
+	entry->SourceSize = reader.ReadU64();
+	entry->SourceWriteTime = reader.ReadU64();
+
+	uint32_t bytecodeSize = reader.ReadU32();
+	if (!reader.Has(bytecodeSize))
+		return false;
+	entry->Bytecode.assign(data + reader.Offset, data + reader.Offset + bytecodeSize);
+	reader.Offset += bytecodeSize;
+
+	// Catches a corrupt or hand-edited file before it reaches the driver
+	if (Hashing::FNV1a(entry->Bytecode.data(), entry->Bytecode.size()) != entry->Key)
+		return false;
+
+	entry->ConstantBuffers.resize(reader.ReadCount(20));
+	for (auto& cb : entry->ConstantBuffers)
+	{
+		cb.Name = reader.ReadString();
+		cb.Type = reader.ReadU32();
+		cb.Size = reader.ReadU32();
+		cb.BindIndex = reader.ReadU32();
+		cb.Variables.resize(reader.ReadCount(12));
+		for (auto& v : cb.Variables)
+		{
+			v.Name = reader.ReadString();
+			v.ByteOffset = reader.ReadU32();
+			v.Size = reader.ReadU32();
+		}
+	}
+
+	entry->Resources.resize(reader.ReadCount(12));
+	for (auto& r : entry->Resources)
+	{
+		r.Name = reader.ReadString();
+		r.Type = reader.ReadU32();
+		r.BindIndex = reader.ReadU32();
+	}
+
+	ReadParameters(reader, entry->InputParameters);
+	ReadParameters(reader, entry->OutputParameters);
+
+	for (int i = 0; i < 3; i++)
+		entry->ThreadGroupSize[i] = reader.ReadU32();
+
+	// Anything left over means the layout doesn't match
+	return !reader.Failed && reader.Offset == size;
+}
+
+bool ShaderCache::MatchesBytecode(const ShaderCacheEntry& entry, const void* bytecode, size_t size)
+{
+	return entry.Bytecode.size() == size && Hashing::FNV1a(bytecode, size) == entry.Key;
+}
+
+bool ShaderCache::MatchesSource(const ShaderCacheEntry& entry, uint64_t size, uint64_t writeTime)
+{
+	// A zero time means it was never recorded
+	return writeTime != 0 && entry.SourceWriteTime == writeTime && entry.SourceSize == size;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Flattened copy of everything SimpleShader reads through
+// D3DReflect, stored next to the bytecode so a cached shader
+// can be set up without reflecting again.  Enum values (buffer
+// types, resource types, component types) are stored as the
+// raw D3D numbers, which keeps this free of any D3D headers.
+// --------------------------------------------------------
+struct ShaderCacheVariable
+{
+	std::string Name;
+	uint32_t ByteOffset = 0;
+	uint32_t Size = 0;
+};
+
+struct ShaderCacheBuffer
+{
+	std::string Name;
+	uint32_t Type = 0;
+	uint32_t Size = 0;
+	uint32_t BindIndex = 0;
+	std::vector<ShaderCacheVariable> Variables;
+};
+
+struct ShaderCacheResource
+{
+	std::string Name;
+	uint32_t Type = 0;
+	uint32_t BindIndex = 0;
+};
+
+struct ShaderCacheParameter
+{
+	std::string SemanticName;
+	uint32_t SemanticIndex = 0;
+	uint32_t Mask = 0;
+	uint32_t ComponentType = 0;
+	uint32_t Stream = 0;
+};
+
+struct ShaderCacheEntry
+{
+	// FNV-1a hash of the bytecode, which is what the entry is keyed on
+	uint64_t Key = 0;
+
+	// Size and last write time (a raw FILETIME) of the compiled
+	// shader the entry was made from, so an unchanged shader can
+	// be recognized without reading it
+	uint64_t SourceSize = 0;
+	uint64_t SourceWriteTime = 0;
+
+	std::vector<unsigned char> Bytecode;
+	std::vector<ShaderCacheBuffer> ConstantBuffers;
+	std::vector<ShaderCacheResource> Resources;
+	std::vector<ShaderCacheParameter> InputParameters;
+	std::vector<ShaderCacheParameter> OutputParameters;
+	uint32_t ThreadGroupSize[3] = {};
+};
+
+// --------------------------------------------------------
+// Reads and writes cache entries as a compact little-endian
+// blob.  Works on memory only, so the round trip can be
+// checked on any platform.
+// --------------------------------------------------------
+class ShaderCache
+{
+public:
+	static const uint32_t Version = 2;
+
+	// Sets the entry's key from its bytecode before writing
+	static void Serialize(ShaderCacheEntry& entry, std::vector<unsigned char>& out);
+
+	// Returns false for anything truncated, from another version,
+	// or whose bytecode doesn't match its key
+	static bool Deserialize(const unsigned char* data, size_t size, ShaderCacheEntry* entry);
+
+	// Whether an entry was made from exactly this bytecode, going
+	// by its key - a compiled shader that has changed in any way
+	// (whatever its timestamp says) doesn't match
+	static bool MatchesBytecode(const ShaderCacheEntry& entry, const void* bytecode, size_t size);
+
+	// Whether a compiled shader is exactly the file the entry was
+	// made from, going by its size and write time.  Only an exact
+	// match counts, so anything rebuilt or copied over (older or
+	// newer) gets read and checked with MatchesBytecode instead.
+	static bool MatchesSource(const ShaderCacheEntry& entry, uint64_t size, uint64_t writeTime);
+};
@@ -0,0 +1,151 @@
+#include "SelfTest.h"
+#include "ShaderCache.h"
+#include "Hashing.h"
+
+// Magic, version, key, source size and time, then the bytecode size
+#define BYTECODE_OFFSET 36
+
+// A made up entry with something in every table
+static ShaderCacheEntry MakeEntry()
+{
+	ShaderCacheEntry entry;
+	for (int i = 0; i < 300; i++)
+		entry.Bytecode.push_back((unsigned char)(i * 7));
+
+	ShaderCacheBuffer buffer;
+	buffer.Name = "perObject";
+	buffer.Type = 0;
+	buffer.Size = 112;
+	buffer.BindIndex = 2;
+	ShaderCacheVariable world = { "world", 0, 64 };
+	ShaderCacheVariable normal = { "normalMatrix", 64, 48 };
+	buffer.Variables.push_back(world);
+	buffer.Variables.push_back(normal);
+	entry.ConstantBuffers.push_back(buffer);
+
+	ShaderCacheResource texture;
+	texture.Name = "albedo";
+	texture.Type = 2;
+	texture.BindIndex = 1;
+	entry.Resources.push_back(texture);
+
+	ShaderCacheParameter position;
+	position.SemanticName = "POSITION";
+	position.Mask = 7;
+	position.ComponentType = 3;
+	entry.InputParameters.push_back(position);
+	ShaderCacheParameter uv = position;
+	uv.SemanticName = "TEXCOORD";
+	uv.SemanticIndex = 1;
+	uv.Mask = 3;
+	entry.InputParameters.push_back(uv);
+
+	ShaderCacheParameter target;
+	target.SemanticName = "SV_TARGET";
+	target.Mask = 15;
+	entry.OutputParameters.push_back(target);
+
+	entry.ThreadGroupSize[0] = 8;
+	entry.ThreadGroupSize[1] = 4;
+	entry.ThreadGroupSize[2] = 1;
+
+	entry.SourceSize = 300;
+	entry.SourceWriteTime = 0x01DB2F4C12345678ull;
+	return entry;
+}
+
+void ShaderCacheTest()
+{
+	ShaderCacheEntry original = MakeEntry();
+	std::vector<unsigned char> bytes;
+	ShaderCache::Serialize(original, bytes);
+	SELF_TEST_CHECK(original.Key == Hashing::FNV1a(original.Bytecode.data(), original.Bytecode.size()));
+
+	// Everything comes back exactly
+	ShaderCacheEntry read;
+	SELF_TEST_CHECK(ShaderCache::Deserialize(bytes.data(), bytes.size(), &read));
+	SELF_TEST_CHECK(read.Key == original.Key);
+	SELF_TEST_CHECK(read.Bytecode == original.Bytecode);
+	SELF_TEST_CHECK(read.ConstantBuffers.size() == 1);
+	if (read.ConstantBuffers.size() == 1)
+	{
+		const ShaderCacheBuffer& buffer = read.ConstantBuffers[0];
+		SELF_TEST_CHECK(buffer.Name == "perObject");
+		SELF_TEST_CHECK(buffer.Size == 112 && buffer.BindIndex == 2);
+		SELF_TEST_CHECK(buffer.Variables.size() == 2);
+		if (buffer.Variables.size() == 2)
+		{
+			SELF_TEST_CHECK(buffer.Variables[1].Name == "normalMatrix");
+			SELF_TEST_CHECK(buffer.Variables[1].ByteOffset == 64 && buffer.Variables[1].Size == 48);
+		}
+	}
+	SELF_TEST_CHECK(read.Resources.size() == 1 && read.Resources[0].Name == "albedo" && read.Resources[0].BindIndex == 1);
+	SELF_TEST_CHECK(read.InputParameters.size() == 2);
+	if (read.InputParameters.size() == 2)
+	{
+		SELF_TEST_CHECK(read.InputParameters[1].SemanticName == "TEXCOORD");
+		SELF_TEST_CHECK(read.InputParameters[1].SemanticIndex == 1 && read.InputParameters[1].Mask == 3);
+	}
+	SELF_TEST_CHECK(read.OutputParameters.size() == 1 && read.OutputParameters[0].SemanticName == "SV_TARGET");
+	SELF_TEST_CHECK(read.ThreadGroupSize[0] == 8 && read.ThreadGroupSize[1] == 4 && read.ThreadGroupSize[2] == 1);
+	SELF_TEST_CHECK(read.SourceSize == 300 && read.SourceWriteTime == original.SourceWriteTime);
+
+	// Serializing again gives the same bytes
+	std::vector<unsigned char> again;
+	ShaderCache::Serialize(read, again);
+	SELF_TEST_CHECK(again == bytes);
+
+	// The entry only matches the bytecode it was made from
+	std::vector<unsigned char> compiled = original.Bytecode;
+	SELF_TEST_CHECK(ShaderCache::MatchesBytecode(read, compiled.data(), compiled.size()));
+	compiled[150] ^= 1;
+	SELF_TEST_CHECK(!ShaderCache::MatchesBytecode(read, compiled.data(), compiled.size()));
+	compiled[150] ^= 1;
+	compiled.push_back(0);
+	SELF_TEST_CHECK(!ShaderCache::MatchesBytecode(read, compiled.data(), compiled.size()));
+
+	// And only the exact compiled file skips the read - a newer
+	// or older time, another size, or no time recorded all miss
+	SELF_TEST_CHECK(ShaderCache::MatchesSource(read, 300, original.SourceWriteTime));
+	SELF_TEST_CHECK(!ShaderCache::MatchesSource(read, 300, original.SourceWriteTime + 1));
+	SELF_TEST_CHECK(!ShaderCache::MatchesSource(read, 300, original.SourceWriteTime - 1));
+	SELF_TEST_CHECK(!ShaderCache::MatchesSource(read, 301, original.SourceWriteTime));
+	ShaderCacheEntry unrecorded;
+	SELF_TEST_CHECK(!ShaderCache::MatchesSource(unrecorded, 0, 0));
+
+	// Every truncation fails cleanly
+	bool anyTruncationRead = false;
+	for (size_t size = 0; size < bytes.size(); size++)
+	{
+		ShaderCacheEntry truncated;
+		if (ShaderCache::Deserialize(bytes.data(), size, &truncated))
+			anyTruncationRead = true;
+	}
+	SELF_TEST_CHECK(!anyTruncationRead);
+
+	// As do extra bytes, a changed bytecode byte, and another version
+	std::vector<unsigned char> damaged = bytes;
+	damaged.push_back(0);
+	SELF_TEST_CHECK(!ShaderCache::Deserialize(damaged.data(), damaged.size(), &read));
+
+	SELF_TEST_CHECK(bytes[BYTECODE_OFFSET] == original.Bytecode[0] && bytes[BYTECODE_OFFSET + 10] == original.Bytecode[10]);
+	damaged = bytes;
+	damaged[BYTECODE_OFFSET + 10] ^= 0xFF;
+	SELF_TEST_CHECK(!ShaderCache::Deserialize(damaged.data(), damaged.size(), &read));
+
+	damaged = bytes;
+	damaged[4] = (unsigned char)(ShaderCache::Version + 1);
+	SELF_TEST_CHECK(!ShaderCache::Deserialize(damaged.data(), damaged.size(), &read));
+
+	// A count far bigger than the file is caught before anything
+	// gets sized from it (the constant buffer count follows the
+	// bytecode)
+	damaged = bytes;
+	size_t countOffset = BYTECODE_OFFSET + original.Bytecode.size();
+	damaged[countOffset + 3] = 0x7F;
+	SELF_TEST_CHECK(!ShaderCache::Deserialize(damaged.data(), damaged.size(), &read));
+
+	// Known FNV-1a values
+	SELF_TEST_CHECK(Hashing::FNV1a("", 0) == 14695981039346656037ull);
+	SELF_TEST_CHECK(Hashing::FNV1a("a", 1) == 0xaf63dc4c8601ec8cull);
+}
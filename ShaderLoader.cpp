@@ -0,0 +1,98 @@
+#include "ShaderLoader.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <stdio.h>
+
+ShaderLoader::ShaderLoader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) :
+	device(device),
+	context(context),
+	threadCount(0),
+	totalMilliseconds(0)
+{
+}
+
+// --------------------------------------------------------
+// Workers pull the next job off a shared counter until they
+// run out, so one slow shader doesn't hold up a whole thread's
+// worth of others
+// --------------------------------------------------------
+void ShaderLoader::Wait()
+{
+	if (jobs.empty())
+		return;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	auto since = [start]() {
+		return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+
+	std::atomic<unsigned int> nextJob(0);
+	auto work = [&](unsigned int thread) {
+		for (unsigned int i = nextJob++; i < jobs.size(); i = nextJob++)
+		{
+			Job& job = jobs[i];
+			job.Thread = thread;
+			job.StartMilliseconds = since();
+			ISimpleShader* shader = job.Load();
+			job.EndMilliseconds = since();
+			job.Valid = shader->IsShaderValid();
+			job.FromCache = shader->WasLoadedFromCache();
+		}
+	};
+
+	threadCount = std::thread::hardware_concurrency();
+	if (threadCount > jobs.size()) threadCount = (unsigned int)jobs.size();
+	if (threadCount == 0) threadCount = 1;
+
+	// This thread takes a share of the work too
+	std::vector<std::thread> workers;
+	for (unsigned int t = 1; t < threadCount; t++)
+		workers.push_back(std::thread(work, t));
+	work(0);
+
+	for (auto& w : workers)
+		w.join();
+
+	totalMilliseconds = since();
+}
+
+// Just the file name, since the paths are all the same
+static const wchar_t* FileName(const std::wstring& path)
+{
+	size_t slash = path.find_last_of(L"/\\");
+	return path.c_str() + (slash == std::wstring::npos ? 0 : slash + 1);
+}
+
+void ShaderLoader::LogTimeline()
+{
+	// Longest single shader is the floor on how fast this can get
+	float sequential = 0;
+	const Job* slowest = 0;
+	for (auto& job : jobs)
+	{
+		float duration = job.EndMilliseconds - job.StartMilliseconds;
+		sequential += duration;
+		if (!slowest || duration > slowest->EndMilliseconds - slowest->StartMilliseconds)
+			slowest = &job;
+	}
+
+	printf("Loaded %u shaders on %u threads in %.2f ms (%.2f ms of work)\n",
+		(unsigned int)jobs.size(), threadCount, totalMilliseconds, sequential);
+
+	for (auto& job : jobs)
+	{
+		printf("  [thread %u] %7.2f -> %7.2f ms  (%6.2f ms)  %ls%s%s\n",
+			job.Thread,
+			job.StartMilliseconds,
+			job.EndMilliseconds,
+			job.EndMilliseconds - job.StartMilliseconds,
+			FileName(job.File),
+			job.FromCache ? "  [cache]" : "",
+			job.Valid ? "" : "  [FAILED]");
+	}
+
+	if (slowest)
+		printf("  Critical path: %ls\n", FileName(slowest->File));
+}
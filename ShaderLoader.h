@@ -0,0 +1,64 @@
+#pragma once
+
+#include "SimpleShader.h"
+
+#include <wrl/client.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Loads a batch of shaders on worker threads.  Building a
+// SimpleShader only touches the device (free-threaded in D3D11)
+// and never the context, so the file reads, reflection and
+// Create*Shader calls for every queued shader can overlap.
+// Queue shaders with Add(), then Wait() once for all of them.
+// --------------------------------------------------------
+class ShaderLoader
+{
+public:
+	ShaderLoader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	// The pointer is filled in by the time Wait() returns
+	template<typename T>
+	void Add(T** shaderOut, const std::wstring& file);
+
+	// Loads everything queued, returning once all of it is done
+	void Wait();
+
+	// Prints when each shader started and finished, and on which thread
+	void LogTimeline();
+
+private:
+	struct Job
+	{
+		std::wstring File;
+		std::function<ISimpleShader*()> Load;
+		unsigned int Thread;
+		float StartMilliseconds;
+		float EndMilliseconds;
+		bool Valid;
+		bool FromCache;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	std::vector<Job> jobs;
+	unsigned int threadCount;
+	float totalMilliseconds;
+};
+
+template<typename T>
+inline void ShaderLoader::Add(T** shaderOut, const std::wstring& file)
+{
+	Microsoft::WRL::ComPtr<ID3D11Device> device = this->device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context = this->context;
+
+	Job job = {};
+	job.File = file;
+	job.Load = [=]() {
+		*shaderOut = new T(device, context, file.c_str());
+		return *shaderOut;
+	};
+	jobs.push_back(job);
+}
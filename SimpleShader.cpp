@@ -1,9 +1,21 @@
 #include "SimpleShader.h"
 
+#include <atomic>
+#include <fstream>
+#include <stdint.h>
+#include <string.h>
+
 // Default error reporting state
 bool ISimpleShader::ReportErrors = false;
 bool ISimpleShader::ReportWarnings = false;
 
+// Shader cache files are on unless turned off
+bool ISimpleShader::UseShaderCache = true;
+
+// Upload counters
+unsigned int ISimpleShader::BytesUploaded = 0;
+unsigned int ISimpleShader::UploadsSkipped = 0;
+
 // To enable error reporting, use either or both 
 // of the following lines somewhere in your program, 
 // preferably before loading/using any shaders.
@@ -24,11 +36,24 @@ ISimpleShader::ISimpleShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Micros
 	// Save the device
 	this->device = device;
 	this->deviceContext = context;
+	context.As(&this->deviceContext1);
+	this->stateCache = SimpleStateCache::ForContext(context);
+
+	// Partial constant buffer updates need 11.1 and driver support
+	this->partialBufferUpdates = false;
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (deviceContext1 && SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+		this->partialBufferUpdates = options.ConstantBufferPartialUpdate == TRUE;
 
 	// Set up fields
 	this->constantBufferCount = 0;
 	this->constantBuffers = 0;
 	this->shaderValid = false;
+	this->loadedFromCache = false;
+
+	// Small unique id for render sort keys (shaders may load on several threads)
+	static std::atomic<unsigned int> nextSortID(0);
+	this->sortID = nextSortID++;
 }
 
 // --------------------------------------------------------
@@ -68,11 +93,20 @@ void ISimpleShader::CleanUp()
 	cbTable.clear();
 	samplerTable.clear();
 	textureTable.clear();
+	variablesByHandle.clear();
+	buffersByHandle.clear();
+	srvsByHandle.clear();
+	samplersByHandle.clear();
 }
 
 // --------------------------------------------------------
 // Loads the specified shader and builds the variable table 
-// using shader reflection.
+// using shader reflection.  If the cache file next to the
+// shader was made from exactly this compiled shader (same
+// size and write time), the bytecode and reflection come from
+// it in one read.  Otherwise the compiled shader is read, and
+// is only reflected again if its bytecode has changed - either
+// way the cache file is rewritten for next time.
 //
 // shaderFile - A "wide string" specifying the compiled shader to load
 // 
@@ -80,23 +114,76 @@ void ISimpleShader::CleanUp()
 // --------------------------------------------------------
 bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 {
-	// Load the shader to a blob and ensure it worked
-	HRESULT hr = D3DReadFileToBlob(shaderFile, shaderBlob.GetAddressOf());
-	if (hr != S_OK)
+	std::wstring cacheFile = GetCacheFileName(shaderFile);
+	ShaderCacheEntry reflection;
+	bool cacheRead = UseShaderCache && ReadCacheFile(cacheFile, &reflection);
+
+	// Identify the compiled shader without reading it
+	WIN32_FILE_ATTRIBUTE_DATA shaderAttributes;
+	bool shaderExists = GetFileAttributesExW(shaderFile, GetFileExInfoStandard, &shaderAttributes) != 0;
+	uint64_t shaderSize = 0;
+	uint64_t shaderWriteTime = 0;
+	if (shaderExists)
 	{
-		if (ReportErrors)
+		shaderSize = ((uint64_t)shaderAttributes.nFileSizeHigh << 32) | shaderAttributes.nFileSizeLow;
+		shaderWriteTime =
+			((uint64_t)shaderAttributes.ftLastWriteTime.dwHighDateTime << 32) |
+			shaderAttributes.ftLastWriteTime.dwLowDateTime;
+	}
+
+	// The cache is all that's needed when it was made from this very
+	// file, or there's no compiled shader to check it against
+	loadedFromCache = cacheRead && (!shaderExists || ShaderCache::MatchesSource(reflection, shaderSize, shaderWriteTime));
+	if (!loadedFromCache)
+	{
+		HRESULT hr = shaderExists ? D3DReadFileToBlob(shaderFile, shaderBlob.ReleaseAndGetAddressOf()) : E_FAIL;
+		if (hr != S_OK)
 		{
-			LogError("SimpleShader::LoadShaderFile() - Error loading file '");
-			LogW(shaderFile);
-			LogError("'. Ensure this file exists and is spelled correctly.\n");
+			shaderBlob.Reset();
+
+			// A cache on its own still beats nothing
+			loadedFromCache = cacheRead;
+			if (!loadedFromCache)
+			{
+				if (ReportErrors)
+				{
+					LogError("SimpleShader::LoadShaderFile() - Error loading file '");
+					LogW(shaderFile);
+					LogError("'. Ensure this file exists and is spelled correctly.\n");
+				}
+
+				return false;
+			}
 		}
+		else
+		{
+			// Rebuilt or copied without changing keeps the reflection,
+			// otherwise reflect once - and either way save it with
+			// this file's identity, so next time is a single read
+			loadedFromCache = cacheRead && ShaderCache::MatchesBytecode(reflection, shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize());
+			if (!loadedFromCache)
+			{
+				reflection = ShaderCacheEntry();
+				ReflectShader(shaderBlob, &reflection);
+			}
+
+			reflection.SourceSize = shaderSize;
+			reflection.SourceWriteTime = shaderWriteTime;
+			if (UseShaderCache)
+				WriteCacheFile(cacheFile, reflection);
+		}
+	}
 
-		return false;
+	// Coming straight from the cache, hand its bytecode to D3D
+	if (!shaderBlob)
+	{
+		D3DCreateBlob(reflection.Bytecode.size(), shaderBlob.ReleaseAndGetAddressOf());
+		memcpy(shaderBlob->GetBufferPointer(), reflection.Bytecode.data(), reflection.Bytecode.size());
 	}
 
 	// Create the shader - Calls an overloaded version of this abstract
 	// method in the appropriate child class
-	shaderValid = CreateShader(shaderBlob);
+	shaderValid = CreateShader(shaderBlob, reflection);
 	if (!shaderValid)
 	{
 		if (ReportErrors)
@@ -109,12 +196,32 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
+	// Set up the variable, buffer, SRV and sampler tables
+	BuildReflectionTables(reflection);
+
+	// Handles work off the tables above, so build them last
+	BuildHandleTables();
+
+	// All set
+	return true;
+}
+
+// --------------------------------------------------------
+// Uses shader reflection to gather everything about this
+// shader (buffers, variables, resources, signatures) into
+// a flat cache entry
+// --------------------------------------------------------
+void ISimpleShader::ReflectShader(Microsoft::WRL::ComPtr<ID3DBlob> blob, ShaderCacheEntry* reflection)
+{
+	unsigned char* bytes = (unsigned char*)blob->GetBufferPointer();
+	reflection->Bytecode.assign(bytes, bytes + blob->GetBufferSize());
+
 	// Set up shader reflection to get information about
 	// this shader and its variables,  buffers, etc.
 	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
 	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
+		blob->GetBufferPointer(),
+		blob->GetBufferSize(),
 		IID_ID3D11ShaderReflection,
 		(void**)refl.GetAddressOf());
 	
@@ -122,30 +229,115 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 	D3D11_SHADER_DESC shaderDesc;
 	refl->GetDesc(&shaderDesc);
 
+	// Bound resources (textures, samplers, UAVs, etc.)
+	for (unsigned int r = 0; r < shaderDesc.BoundResources; r++)
+	{
+		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
+		refl->GetResourceBindingDesc(r, &resourceDesc);
+
+		ShaderCacheResource resource;
+		resource.Name = resourceDesc.Name;
+		resource.Type = resourceDesc.Type;
+		resource.BindIndex = resourceDesc.BindPoint;
+		reflection->Resources.push_back(resource);
+	}
+
+	// Constant buffers and their variables
+	for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
+	{
+		ID3D11ShaderReflectionConstantBuffer* cb =
+			refl->GetConstantBufferByIndex(b);
+		
+		D3D11_SHADER_BUFFER_DESC bufferDesc;
+		cb->GetDesc(&bufferDesc);
+
+		// Get the description of the resource binding, so
+		// we know exactly how it's bound in the shader
+		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
+
+		ShaderCacheBuffer buffer;
+		buffer.Name = bufferDesc.Name;
+		buffer.Type = bufferDesc.Type;
+		buffer.Size = bufferDesc.Size;
+		buffer.BindIndex = bindDesc.BindPoint;
+
+		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		{
+			ID3D11ShaderReflectionVariable* var =
+				cb->GetVariableByIndex(v);
+			
+			D3D11_SHADER_VARIABLE_DESC varDesc;
+			var->GetDesc(&varDesc);
+
+			ShaderCacheVariable variable;
+			variable.Name = varDesc.Name;
+			variable.ByteOffset = varDesc.StartOffset;
+			variable.Size = varDesc.Size;
+			buffer.Variables.push_back(variable);
+		}
+
+		reflection->ConstantBuffers.push_back(buffer);
+	}
+
+	// Input and output signatures, for input layouts and stream out
+	for (unsigned int i = 0; i < shaderDesc.InputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		refl->GetInputParameterDesc(i, &paramDesc);
+		reflection->InputParameters.push_back(MakeCacheParameter(paramDesc));
+	}
+
+	for (unsigned int i = 0; i < shaderDesc.OutputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		refl->GetOutputParameterDesc(i, &paramDesc);
+		reflection->OutputParameters.push_back(MakeCacheParameter(paramDesc));
+	}
+
+	// Only meaningful for compute shaders, zero otherwise
+	refl->GetThreadGroupSize(
+		&reflection->ThreadGroupSize[0],
+		&reflection->ThreadGroupSize[1],
+		&reflection->ThreadGroupSize[2]);
+}
+
+ShaderCacheParameter ISimpleShader::MakeCacheParameter(const D3D11_SIGNATURE_PARAMETER_DESC& paramDesc)
+{
+	ShaderCacheParameter param;
+	param.SemanticName = paramDesc.SemanticName;
+	param.SemanticIndex = paramDesc.SemanticIndex;
+	param.Mask = paramDesc.Mask;
+	param.ComponentType = paramDesc.ComponentType;
+	param.Stream = paramDesc.Stream;
+	return param;
+}
+
+// --------------------------------------------------------
+// Builds the buffer, variable, SRV and sampler tables (and
+// creates the constant buffers) from reflection data
+// --------------------------------------------------------
+void ISimpleShader::BuildReflectionTables(const ShaderCacheEntry& reflection)
+{
 	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
+	constantBufferCount = (unsigned int)reflection.ConstantBuffers.size();
 	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
 	
 	// Handle bound resources (like shaders and samplers)
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
+	for (auto& resource : reflection.Resources)
 	{
-		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
-
 		// Check the type
-		switch (resourceDesc.Type)
+		switch (resource.Type)
 		{
 		case D3D_SIT_STRUCTURED: // Treat structured buffers as texture resources
 		case D3D_SIT_TEXTURE: // A texture resource
 		{
 			// Create the SRV wrapper
 			SimpleSRV* srv = new SimpleSRV();
-			srv->BindIndex = resourceDesc.BindPoint;				// Shader bind point
+			srv->BindIndex = resource.BindIndex;					// Shader bind point
 			srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
 
-			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
+			textureTable.insert(std::pair<std::string, SimpleSRV*>(resource.Name, srv));
 			shaderResourceViews.push_back(srv);
 		}
 			break;
@@ -154,10 +346,10 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		{
 			// Create the sampler wrapper
 			SimpleSampler* samp = new SimpleSampler();
-			samp->BindIndex = resourceDesc.BindPoint;			// Shader bind point
+			samp->BindIndex = resource.BindIndex;				// Shader bind point
 			samp->Index = (unsigned int)samplerStates.size();	// Raw index
 
-			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
+			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resource.Name, samp));
 			samplerStates.push_back(samp);
 		}
 			break;
@@ -167,31 +359,20 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 	// Loop through all constant buffers
 	for (unsigned int b = 0; b < constantBufferCount; b++)
 	{
-		// Get this buffer
-		ID3D11ShaderReflectionConstantBuffer* cb =
-			refl->GetConstantBufferByIndex(b);
-		
-		// Get the description of this buffer
-		D3D11_SHADER_BUFFER_DESC bufferDesc;
-		cb->GetDesc(&bufferDesc);
+		const ShaderCacheBuffer& bufferInfo = reflection.ConstantBuffers[b];
 
 		// Save the type, which we reference when setting these buffers
-		constantBuffers[b].Type = bufferDesc.Type;
-		
-		// Get the description of the resource binding, so
-		// we know exactly how it's bound in the shader
-		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
-		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
+		constantBuffers[b].Type = (D3D_CBUFFER_TYPE)bufferInfo.Type;
 		
 		// Set up the buffer and put its pointer in the table
-		constantBuffers[b].BindIndex = bindDesc.BindPoint;
-		constantBuffers[b].Name = bufferDesc.Name;
-		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
+		constantBuffers[b].BindIndex = bufferInfo.BindIndex;
+		constantBuffers[b].Name = bufferInfo.Name;
+		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferInfo.Name, &constantBuffers[b]));
 
 		// Create this constant buffer
 		D3D11_BUFFER_DESC newBuffDesc = {};
 		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
-		newBuffDesc.ByteWidth = bufferDesc.Size;
+		newBuffDesc.ByteWidth = bufferInfo.Size;
 		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
 		newBuffDesc.CPUAccessFlags = 0;
 		newBuffDesc.MiscFlags = 0;
@@ -199,38 +380,80 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
 
 		// Set up the data buffer for this constant buffer
-		constantBuffers[b].Size = bufferDesc.Size;
-		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
-		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
+		constantBuffers[b].Size = bufferInfo.Size;
+		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferInfo.Size];
+		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferInfo.Size);
+
+		// Nothing has been uploaded yet, so the whole buffer is dirty
+		constantBuffers[b].Dirty = true;
+		constantBuffers[b].DirtyStart = 0;
+		constantBuffers[b].DirtyEnd = bufferInfo.Size;
 
 		// Loop through all variables in this buffer
-		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		for (auto& variable : bufferInfo.Variables)
 		{
-			// Get this variable
-			ID3D11ShaderReflectionVariable* var =
-				cb->GetVariableByIndex(v);
-			
-			// Get the description of the variable and its type
-			D3D11_SHADER_VARIABLE_DESC varDesc;
-			var->GetDesc(&varDesc);
-
 			// Create the variable struct
 			SimpleShaderVariable varStruct = {};
 			varStruct.ConstantBufferIndex = b;
-			varStruct.ByteOffset = varDesc.StartOffset;
-			varStruct.Size = varDesc.Size;
-			
-			// Get a string version
-			std::string varName(varDesc.Name);
+			varStruct.ByteOffset = variable.ByteOffset;
+			varStruct.Size = variable.Size;
 
 			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
+			varTable.insert(std::pair<std::string, SimpleShaderVariable>(variable.Name, varStruct));
 			constantBuffers[b].Variables.push_back(varStruct);
 		}
 	}
+}
 
-	// All set
-	return true;
+// --------------------------------------------------------
+// Cache files sit next to the shader: "Name.cso" -> "Name.sscache"
+// --------------------------------------------------------
+std::wstring ISimpleShader::GetCacheFileName(LPCWSTR shaderFile)
+{
+	std::wstring name(shaderFile);
+	size_t dot = name.find_last_of(L'.');
+	size_t slash = name.find_last_of(L"/\\");
+	if (dot != std::wstring::npos && (slash == std::wstring::npos || dot > slash))
+		name.erase(dot);
+	return name + L".sscache";
+}
+
+// --------------------------------------------------------
+// Reads a cache entry with a single file read.  Fails if the
+// file is missing, damaged or from another version - whether
+// it goes with the compiled shader is up to the caller.
+// --------------------------------------------------------
+bool ISimpleShader::ReadCacheFile(const std::wstring& cacheFile, ShaderCacheEntry* reflection)
+{
+	// Opened at the end, so the size comes from the stream itself
+	std::ifstream file(cacheFile, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	std::streamoff size = file.tellg();
+	if (size <= 0 || (unsigned long long)size > SIZE_MAX)
+		return false;
+
+	std::vector<unsigned char> bytes((size_t)size);
+	file.seekg(0);
+	if (!file.read((char*)bytes.data(), bytes.size()))
+		return false;
+
+	return ShaderCache::Deserialize(bytes.data(), bytes.size(), reflection);
+}
+
+// --------------------------------------------------------
+// Writes a cache entry, quietly doing nothing on failure
+// (a read-only install just means no cache)
+// --------------------------------------------------------
+void ISimpleShader::WriteCacheFile(const std::wstring& cacheFile, ShaderCacheEntry& reflection)
+{
+	std::vector<unsigned char> bytes;
+	ShaderCache::Serialize(reflection, bytes);
+
+	std::ofstream file(cacheFile, std::ios::binary | std::ios::trunc);
+	if (file.is_open())
+		file.write((const char*)bytes.data(), bytes.size());
 }
 
 // --------------------------------------------------------
@@ -345,14 +568,9 @@ void ISimpleShader::CopyAllBufferData()
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
-	// Loop through the constant buffers and copy all data
+	// Loop through the constant buffers and copy any changed data
 	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer.Get(), 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
-	}
+		UploadBuffer(&constantBuffers[i]);
 }
 
 // --------------------------------------------------------
@@ -380,9 +598,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
 }
 
 // --------------------------------------------------------
@@ -402,11 +618,84 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
+}
+
+
+// --------------------------------------------------------
+// Resets the upload counters, usually at the start of a frame
+// --------------------------------------------------------
+void ISimpleShader::ResetUploadStats()
+{
+	BytesUploaded = 0;
+	UploadsSkipped = 0;
+}
+
+// --------------------------------------------------------
+// Writes into a local data buffer and grows its dirty range.
+// Writing the same bytes that are already there is ignored,
+// so values set every frame (camera, lights) that haven't
+// changed don't cause an upload.
+// --------------------------------------------------------
+void ISimpleShader::WriteLocalData(SimpleConstantBuffer* cb, unsigned int offset, const void* data, unsigned int size)
+{
+	unsigned char* dest = cb->LocalDataBuffer + offset;
+	if (memcmp(dest, data, size) == 0)
+		return;
+
+	memcpy(dest, data, size);
+
+	if (!cb->Dirty)
+	{
+		cb->Dirty = true;
+		cb->DirtyStart = offset;
+		cb->DirtyEnd = offset + size;
+		return;
+	}
+
+	if (offset < cb->DirtyStart) cb->DirtyStart = offset;
+	if (offset + size > cb->DirtyEnd) cb->DirtyEnd = offset + size;
 }
 
+// --------------------------------------------------------
+// Copies a local data buffer to the GPU if it's dirty.  When
+// the device supports partial constant buffer updates only
+// the dirty range (rounded out to whole constants) is sent.
+// --------------------------------------------------------
+void ISimpleShader::UploadBuffer(SimpleConstantBuffer* cb)
+{
+	if (!cb->Dirty)
+	{
+		UploadsSkipped++;
+		return;
+	}
+
+	unsigned int start = cb->DirtyStart & ~15u;
+	unsigned int end = (cb->DirtyEnd + 15) & ~15u;
+	if (end > cb->Size) end = cb->Size;
+
+	if (partialBufferUpdates && (start > 0 || end < cb->Size))
+	{
+		D3D11_BOX box = {};
+		box.left = start;
+		box.right = end;
+		box.bottom = 1;
+		box.back = 1;
+		deviceContext1->UpdateSubresource1(
+			cb->ConstantBuffer.Get(), 0, &box,
+			cb->LocalDataBuffer + start, 0, 0, 0);
+		BytesUploaded += end - start;
+	}
+	else
+	{
+		deviceContext->UpdateSubresource(
+			cb->ConstantBuffer.Get(), 0, 0,
+			cb->LocalDataBuffer, 0, 0);
+		BytesUploaded += cb->Size;
+	}
+
+	cb->Dirty = false;
+}
 
 // --------------------------------------------------------
 // Sets a variable by name with arbitrary data of the specified size
@@ -446,10 +735,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 	}
 
 	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
+	WriteLocalData(&constantBuffers[var->ConstantBufferIndex], var->ByteOffset, data, size);
 
 	// Success
 	return true;
@@ -535,6 +821,240 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 dat
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
 
+// --------------------------------------------------------
+// Sets a variable by name, but writes into an external block
+// of memory laid out like the variable's constant buffer,
+// such as a mapped ConstantBufferRing slice
+//
+// slice - Memory for the buffer that holds this variable
+// name - The name of the shader variable
+// data - The data to set in the slice
+// size - The size of the data (this must be less than or equal to the variable's size)
+//
+// Returns true if data is copied, false if variable doesn't exist
+// --------------------------------------------------------
+bool ISimpleShader::SetSliceData(void* slice, std::string name, const void* data, unsigned int size)
+{
+	// Look for the variable and verify
+	SimpleShaderVariable* var = FindVariable(name, -1);
+	if (var == 0 || size > var->Size)
+	{
+		if (ReportWarnings)
+		{
+			LogWarning("SimpleShader::SetSliceData() - Shader variable '");
+			Log(name);
+			LogWarning("' not found or too small for the data being set.\n");
+		}
+		return false;
+	}
+
+	// Same offset it would have in the local data buffer
+	memcpy((unsigned char*)slice + var->ByteOffset, data, size);
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a 4x4 matrix variable in an external buffer slice
+// --------------------------------------------------------
+bool ISimpleShader::SetSliceMatrix4x4(void* slice, std::string name, const DirectX::XMFLOAT4X4 data)
+{
+	return this->SetSliceData(slice, name, &data, sizeof(float) * 16);
+}
+
+// --------------------------------------------------------
+// Helpers for the per shader handle tables
+// --------------------------------------------------------
+template<typename T>
+static void SetHandleTableEntry(std::vector<T*>& table, unsigned int id, T* value)
+{
+	if (id >= table.size())
+		table.resize(id + 1, 0);
+	table[id] = value;
+}
+
+template<typename T>
+static T* FindHandleTableEntry(const std::vector<T*>& table, unsigned int id)
+{
+	return id < table.size() ? table[id] : 0;
+}
+
+// --------------------------------------------------------
+// Maps a name to its handle id, adding it if it's new.  Ids
+// are shared by every shader and every kind of handle.
+// --------------------------------------------------------
+unsigned int ISimpleShader::GetHandleID(const std::string& name)
+{
+	// Function statics, so handles can be resolved from other
+	// statics without worrying about initialization order
+	static std::unordered_map<std::string, unsigned int> handleIDs;
+	static std::mutex handleMutex;
+
+	std::lock_guard<std::mutex> lock(handleMutex);
+
+	std::unordered_map<std::string, unsigned int>::iterator result =
+		handleIDs.find(name);
+	if (result != handleIDs.end())
+		return result->second;
+
+	unsigned int id = (unsigned int)handleIDs.size();
+	handleIDs.insert(std::pair<std::string, unsigned int>(name, id));
+	return id;
+}
+
+// --------------------------------------------------------
+// Fills the handle tables from the name tables.  Pointers
+// into the unordered_maps stay valid as long as the
+// elements do, which is until CleanUp().
+// --------------------------------------------------------
+void ISimpleShader::BuildHandleTables()
+{
+	for (auto& var : varTable)
+		SetHandleTableEntry(variablesByHandle, GetHandleID(var.first), &var.second);
+
+	for (auto& cb : cbTable)
+		SetHandleTableEntry(buffersByHandle, GetHandleID(cb.first), cb.second);
+
+	for (auto& srv : textureTable)
+		SetHandleTableEntry(srvsByHandle, GetHandleID(srv.first), srv.second);
+
+	for (auto& samp : samplerTable)
+		SetHandleTableEntry(samplersByHandle, GetHandleID(samp.first), samp.second);
+}
+
+SimpleVariableHandle ISimpleShader::GetVariableHandle(std::string name)
+{
+	SimpleVariableHandle handle;
+	handle.ID = GetHandleID(name);
+	return handle;
+}
+
+SimpleBufferHandle ISimpleShader::GetBufferHandle(std::string name)
+{
+	SimpleBufferHandle handle;
+	handle.ID = GetHandleID(name);
+	return handle;
+}
+
+SimpleSRVHandle ISimpleShader::GetShaderResourceViewHandle(std::string name)
+{
+	SimpleSRVHandle handle;
+	handle.ID = GetHandleID(name);
+	return handle;
+}
+
+SimpleSamplerHandle ISimpleShader::GetSamplerHandle(std::string name)
+{
+	SimpleSamplerHandle handle;
+	handle.ID = GetHandleID(name);
+	return handle;
+}
+
+SimpleShaderVariable* ISimpleShader::FindVariable(SimpleVariableHandle handle)
+{
+	return FindHandleTableEntry(variablesByHandle, handle.ID);
+}
+
+SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(SimpleBufferHandle handle)
+{
+	return FindHandleTableEntry(buffersByHandle, handle.ID);
+}
+
+const SimpleSRV* ISimpleShader::FindShaderResourceView(SimpleSRVHandle handle)
+{
+	return FindHandleTableEntry(srvsByHandle, handle.ID);
+}
+
+const SimpleSampler* ISimpleShader::FindSamplerState(SimpleSamplerHandle handle)
+{
+	return FindHandleTableEntry(samplersByHandle, handle.ID);
+}
+
+const SimpleShaderVariable* ISimpleShader::GetVariableInfo(SimpleVariableHandle variable)
+{
+	return FindVariable(variable);
+}
+
+const SimpleConstantBuffer* ISimpleShader::GetBufferInfo(SimpleBufferHandle buffer)
+{
+	return FindConstantBuffer(buffer);
+}
+
+// --------------------------------------------------------
+// Copies local data to the constant buffer the handle names
+// --------------------------------------------------------
+void ISimpleShader::CopyBufferData(SimpleBufferHandle buffer)
+{
+	// Ensure the shader is valid
+	if (!shaderValid) return;
+
+	// Check for the buffer
+	SimpleConstantBuffer* cb = FindConstantBuffer(buffer);
+	if (!cb) return;
+
+	// Copy the data and get out
+	UploadBuffer(cb);
+}
+
+// --------------------------------------------------------
+// Sets a variable by handle.  Quietly returns false if this
+// shader doesn't have the variable, since handles are often
+// shared between shaders that only have some of them.
+// --------------------------------------------------------
+bool ISimpleShader::SetData(SimpleVariableHandle variable, const void* data, unsigned int size)
+{
+	SimpleShaderVariable* var = FindVariable(variable);
+	if (var == 0 || size > var->Size)
+		return false;
+
+	WriteLocalData(&constantBuffers[var->ConstantBufferIndex], var->ByteOffset, data, size);
+	return true;
+}
+
+bool ISimpleShader::SetInt(SimpleVariableHandle variable, int data)
+{
+	return this->SetData(variable, &data, sizeof(int));
+}
+
+bool ISimpleShader::SetFloat(SimpleVariableHandle variable, float data)
+{
+	return this->SetData(variable, &data, sizeof(float));
+}
+
+bool ISimpleShader::SetFloat2(SimpleVariableHandle variable, const DirectX::XMFLOAT2 data)
+{
+	return this->SetData(variable, &data, sizeof(float) * 2);
+}
+
+bool ISimpleShader::SetFloat3(SimpleVariableHandle variable, const DirectX::XMFLOAT3 data)
+{
+	return this->SetData(variable, &data, sizeof(float) * 3);
+}
+
+bool ISimpleShader::SetFloat4(SimpleVariableHandle variable, const DirectX::XMFLOAT4 data)
+{
+	return this->SetData(variable, &data, sizeof(float) * 4);
+}
+
+bool ISimpleShader::SetMatrix4x4(SimpleVariableHandle variable, const DirectX::XMFLOAT4X4 data)
+{
+	return this->SetData(variable, &data, sizeof(float) * 16);
+}
+
+bool ISimpleShader::SetSliceData(void* slice, SimpleVariableHandle variable, const void* data, unsigned int size)
+{
+	SimpleShaderVariable* var = FindVariable(variable);
+	if (var == 0 || size > var->Size)
+		return false;
+
+	memcpy((unsigned char*)slice + var->ByteOffset, data, size);
+	return true;
+}
+
+bool ISimpleShader::SetSliceMatrix4x4(void* slice, SimpleVariableHandle variable, const DirectX::XMFLOAT4X4 data)
+{
+	return this->SetSliceData(slice, variable, &data, sizeof(float) * 16);
+}
+
 // --------------------------------------------------------
 // Determines if the shader contains the specified
 // variable within one of its constant buffers
@@ -744,7 +1264,7 @@ void SimpleVertexShader::CleanUp()
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob)
+bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, const ShaderCacheEntry& reflection)
 {
 	// Clean up first, in the event this method is
 	// called more than once on the same object
@@ -767,32 +1287,17 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 		return true;
 
 	// Vertex shader was created successfully, so we now use the
-	// shader code to re-reflect and create an input layout that 
+	// input signature from reflection to create an input layout that 
 	// matches what the vertex shader expects.  Code adapted from:
 	// https://takinginitiative.wordpress.com/2011/12/11/directx-1011-basic-shader-reflection-automatic-input-layout-creation/
 
-	// Reflect shader info
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-	
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
 	// Read input layout description from shader info
 	std::vector<D3D11_INPUT_ELEMENT_DESC> inputLayoutDesc;
-	for (unsigned int i = 0; i< shaderDesc.InputParameters; i++)
+	for (auto& paramDesc : reflection.InputParameters)
 	{
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetInputParameterDesc(i, &paramDesc);
-
 		// Check the semantic name for "_PER_INSTANCE"
 		std::string perInstanceStr = "_PER_INSTANCE";
-		std::string sem = paramDesc.SemanticName;
+		const std::string& sem = paramDesc.SemanticName;
 		int lenDiff = (int)sem.size() - (int)perInstanceStr.size();
 		bool isPerInstance = 
 			lenDiff >= 0 &&
@@ -800,7 +1305,7 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 
 		// Fill out input element desc
 		D3D11_INPUT_ELEMENT_DESC elementDesc = {};
-		elementDesc.SemanticName = paramDesc.SemanticName;
+		elementDesc.SemanticName = paramDesc.SemanticName.c_str();
 		elementDesc.SemanticIndex = paramDesc.SemanticIndex;
 		elementDesc.InputSlot = 0;
 		elementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
@@ -843,6 +1348,12 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 			else if (paramDesc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32) elementDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
 		}
 
+		// Reflection only ever reports 32-bit components, so packed
+		// inputs are asked for with a semantic suffix instead
+		DXGI_FORMAT packedFormat = GetPackedFormat(sem, paramDesc.Mask);
+		if (packedFormat != DXGI_FORMAT_UNKNOWN)
+			elementDesc.Format = packedFormat;
+
 		// Save element desc
 		inputLayoutDesc.push_back(elementDesc);
 	}
@@ -859,6 +1370,36 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 	return true;
 }
 
+// --------------------------------------------------------
+// Maps a packed input's semantic suffix to its DXGI format
+//
+//  _UNORM - 16-bit unsigned normalized
+//  _SNORM - 16-bit signed normalized
+//  _HALF  - 16-bit float
+//
+// (No bit counts in the suffixes, as trailing digits would be
+// read as the semantic index.)  There are no three component
+// 16-bit formats, so a float3 input reads from a four component
+// element.  Returns DXGI_FORMAT_UNKNOWN for anything else.
+// --------------------------------------------------------
+DXGI_FORMAT SimpleVertexShader::GetPackedFormat(const std::string& semantic, unsigned int mask)
+{
+	auto endsWith = [&](const char* suffix) {
+		size_t length = strlen(suffix);
+		return semantic.size() >= length && semantic.compare(semantic.size() - length, length, suffix) == 0;
+	};
+
+	int components = mask == 1 ? 1 : (mask <= 3 ? 2 : 4);
+	if (endsWith("_UNORM"))
+		return components == 1 ? DXGI_FORMAT_R16_UNORM : (components == 2 ? DXGI_FORMAT_R16G16_UNORM : DXGI_FORMAT_R16G16B16A16_UNORM);
+	if (endsWith("_SNORM"))
+		return components == 1 ? DXGI_FORMAT_R16_SNORM : (components == 2 ? DXGI_FORMAT_R16G16_SNORM : DXGI_FORMAT_R16G16B16A16_SNORM);
+	if (endsWith("_HALF"))
+		return components == 1 ? DXGI_FORMAT_R16_FLOAT : (components == 2 ? DXGI_FORMAT_R16G16_FLOAT : DXGI_FORMAT_R16G16B16A16_FLOAT);
+
+	return DXGI_FORMAT_UNKNOWN;
+}
+
 // --------------------------------------------------------
 // Sets the vertex shader, input layout and constant buffers
 // for future  Direct3D drawing
@@ -869,8 +1410,8 @@ void SimpleVertexShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader and input layout
-	deviceContext->IASetInputLayout(inputLayout.Get());
-	deviceContext->VSSetShader(shader.Get(), 0, 0);
+	stateCache->SetInputLayout(inputLayout.Get());
+	stateCache->SetShader(SIMPLE_STAGE_VERTEX, shader.Get());
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -880,10 +1421,10 @@ void SimpleVertexShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->VSSetConstantBuffers(
+		stateCache->SetConstantBuffer(
+			SIMPLE_STAGE_VERTEX,
 			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+			constantBuffers[i].ConstantBuffer.Get());
 	}
 }
 
@@ -910,8 +1451,23 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 		return false;
 	}
 
+	// The handle version does the actual binding
+	return SetShaderResourceView(GetShaderResourceViewHandle(name), srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view by handle
+//
+// Returns true if this shader has the SRV, false otherwise
+// --------------------------------------------------------
+bool SimpleVertexShader::SetShaderResourceView(SimpleSRVHandle handle, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	const SimpleSRV* srvInfo = FindShaderResourceView(handle);
+	if (srvInfo == 0)
+		return false;
+
 	// Set the shader resource view
-	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	stateCache->SetShaderResourceView(SIMPLE_STAGE_VERTEX, srvInfo->BindIndex, srv.Get());
 
 	// Success
 	return true;
@@ -940,13 +1496,89 @@ bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	// The handle version does the actual binding
+	return SetSamplerState(GetSamplerHandle(name), samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state by handle
+//
+// Returns true if this shader has the sampler, false otherwise
+// --------------------------------------------------------
+bool SimpleVertexShader::SetSamplerState(SimpleSamplerHandle handle, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	const SimpleSampler* sampInfo = FindSamplerState(handle);
+	if (sampInfo == 0)
+		return false;
+
+	// Set the sampler state
+	stateCache->SetSamplerState(SIMPLE_STAGE_VERTEX, sampInfo->BindIndex, samplerState.Get());
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a range of an external buffer in the vertex shader stage,
+// in the register of one of this shader's constant buffers
+//
+// bufferName - The name of the constant buffer in the shader
+// buffer - The buffer holding the data
+// firstConstant, numConstants - The range, in 16 byte constants
+//
+// Returns true if the buffer was found and the range could be bound
+// --------------------------------------------------------
+bool SimpleVertexShader::SetConstantBufferSlice(std::string bufferName, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	// Offsets need an 11.1 context
+	SimpleConstantBuffer* cb = FindConstantBuffer(bufferName);
+	if (cb == 0 || !deviceContext1)
+	{
+		if (ReportWarnings)
+		{
+			LogWarning("SimpleVertexShader::SetConstantBufferSlice() - Constant buffer named '");
+			Log(bufferName);
+			LogWarning("' was not found in the shader, or the device context doesn't support offsets.\n");
+		}
+		return false;
+	}
+
+	// The handle version does the actual binding
+	return SetConstantBufferSlice(GetBufferHandle(bufferName), buffer, firstConstant, numConstants);
+}
+
+// --------------------------------------------------------
+// Binds a range of an external buffer by constant buffer handle
+//
+// Returns true if the buffer was found and the range could be bound
+// --------------------------------------------------------
+bool SimpleVertexShader::SetConstantBufferSlice(SimpleBufferHandle handle, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	SimpleConstantBuffer* cb = FindConstantBuffer(handle);
+	if (cb == 0 || !deviceContext1)
+		return false;
+
+	return stateCache->SetConstantBufferRange(SIMPLE_STAGE_VERTEX, cb->BindIndex, buffer, firstConstant, numConstants);
+}
+
+// --------------------------------------------------------
+// Puts the shader's own constant buffer back in its slot.
+// SetShader() only binds it when the shader changes, so
+// after drawing with a slice of some other buffer, this is
+// what makes CopyBufferData() reach the GPU again.
+//
+// Returns true if the buffer was found
+// --------------------------------------------------------
+bool SimpleVertexShader::RestoreConstantBuffer(SimpleBufferHandle handle)
+{
+	SimpleConstantBuffer* cb = FindConstantBuffer(handle);
+	if (cb == 0)
+		return false;
+
+	stateCache->SetConstantBuffer(SIMPLE_STAGE_VERTEX, cb->BindIndex, cb->ConstantBuffer.Get());
+	return true;
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ SIMPLE PIXEL SHADER -------------------------------------------------
@@ -985,7 +1617,7 @@ void SimplePixelShader::CleanUp()
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob)
+bool SimplePixelShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, const ShaderCacheEntry& reflection)
 {
 	// Clean up first, in the event this method is
 	// called more than once on the same object
@@ -1012,7 +1644,7 @@ void SimplePixelShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 	
 	// Set the shader
-	deviceContext->PSSetShader(shader.Get(), 0, 0);
+	stateCache->SetShader(SIMPLE_STAGE_PIXEL, shader.Get());
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1022,10 +1654,10 @@ void SimplePixelShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->PSSetConstantBuffers(
+		stateCache->SetConstantBuffer(
+			SIMPLE_STAGE_PIXEL,
 			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+			constantBuffers[i].ConstantBuffer.Get());
 	}
 }
 
@@ -1052,8 +1684,23 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 		return false;
 	}
 
+	// The handle version does the actual binding
+	return SetShaderResourceView(GetShaderResourceViewHandle(name), srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view by handle
+//
+// Returns true if this shader has the SRV, false otherwise
+// --------------------------------------------------------
+bool SimplePixelShader::SetShaderResourceView(SimpleSRVHandle handle, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	const SimpleSRV* srvInfo = FindShaderResourceView(handle);
+	if (srvInfo == 0)
+		return false;
+
 	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	stateCache->SetShaderResourceView(SIMPLE_STAGE_PIXEL, srvInfo->BindIndex, srv.Get());
 
 	// Success
 	return true;
@@ -1082,13 +1729,71 @@ bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	// The handle version does the actual binding
+	return SetSamplerState(GetSamplerHandle(name), samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state by handle
+//
+// Returns true if this shader has the sampler, false otherwise
+// --------------------------------------------------------
+bool SimplePixelShader::SetSamplerState(SimpleSamplerHandle handle, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	const SimpleSampler* sampInfo = FindSamplerState(handle);
+	if (sampInfo == 0)
+		return false;
+
+	// Set the sampler state
+	stateCache->SetSamplerState(SIMPLE_STAGE_PIXEL, sampInfo->BindIndex, samplerState.Get());
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a range of an external buffer in the pixel shader stage,
+// in the register of one of this shader's constant buffers
+//
+// bufferName - The name of the constant buffer in the shader
+// buffer - The buffer holding the data
+// firstConstant, numConstants - The range, in 16 byte constants
+//
+// Returns true if the buffer was found and the range could be bound
+// --------------------------------------------------------
+bool SimplePixelShader::SetConstantBufferSlice(std::string bufferName, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	// Offsets need an 11.1 context
+	SimpleConstantBuffer* cb = FindConstantBuffer(bufferName);
+	if (cb == 0 || !deviceContext1)
+	{
+		if (ReportWarnings)
+		{
+			LogWarning("SimplePixelShader::SetConstantBufferSlice() - Constant buffer named '");
+			Log(bufferName);
+			LogWarning("' was not found in the shader, or the device context doesn't support offsets.\n");
+		}
+		return false;
+	}
+
+	// The handle version does the actual binding
+	return SetConstantBufferSlice(GetBufferHandle(bufferName), buffer, firstConstant, numConstants);
+}
+
+// --------------------------------------------------------
+// Binds a range of an external buffer by constant buffer handle
+//
+// Returns true if the buffer was found and the range could be bound
+// --------------------------------------------------------
+bool SimplePixelShader::SetConstantBufferSlice(SimpleBufferHandle handle, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	SimpleConstantBuffer* cb = FindConstantBuffer(handle);
+	if (cb == 0 || !deviceContext1)
+		return false;
+
+	return stateCache->SetConstantBufferRange(SIMPLE_STAGE_PIXEL, cb->BindIndex, buffer, firstConstant, numConstants);
+}
+
 
 
 
@@ -1129,7 +1834,7 @@ void SimpleDomainShader::CleanUp()
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob)
+bool SimpleDomainShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, const ShaderCacheEntry& reflection)
 {
 	// Clean up first, in the event this method is
 	// called more than once on the same object
@@ -1156,7 +1861,7 @@ void SimpleDomainShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->DSSetShader(shader.Get(), 0, 0);
+	stateCache->SetShader(SIMPLE_STAGE_DOMAIN, shader.Get());
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1166,10 +1871,10 @@ void SimpleDomainShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->DSSetConstantBuffers(
+		stateCache->SetConstantBuffer(
+			SIMPLE_STAGE_DOMAIN,
 			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+			constantBuffers[i].ConstantBuffer.Get());
 	}
 }
 
@@ -1194,43 +1899,116 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
-	}
+	}
+
+	// The handle version does the actual binding
+	return SetShaderResourceView(GetShaderResourceViewHandle(name), srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view by handle
+//
+// Returns true if this shader has the SRV, false otherwise
+// --------------------------------------------------------
+bool SimpleDomainShader::SetShaderResourceView(SimpleSRVHandle handle, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	const SimpleSRV* srvInfo = FindShaderResourceView(handle);
+	if (srvInfo == 0)
+		return false;
+
+	// Set the shader resource view
+	stateCache->SetShaderResourceView(SIMPLE_STAGE_DOMAIN, srvInfo->BindIndex, srv.Get());
+
+	// Success
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a sampler state in the domain shader stage
+//
+// name - The name of the sampler state in the shader
+// samplerState - The sampler state in GPU memory
+//
+// Returns true if a sampler of the given name was found, false otherwise
+// --------------------------------------------------------
+bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	// Look for the variable and verify
+	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	if (sampInfo == 0)
+	{
+		if (ReportWarnings)
+		{
+			LogWarning("SimpleDomainShader::SetSamplerState() - Sampler named '");
+			Log(name);
+			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
+		}
+		return false;
+	}
+
+	// The handle version does the actual binding
+	return SetSamplerState(GetSamplerHandle(name), samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state by handle
+//
+// Returns true if this shader has the sampler, false otherwise
+// --------------------------------------------------------
+bool SimpleDomainShader::SetSamplerState(SimpleSamplerHandle handle, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	const SimpleSampler* sampInfo = FindSamplerState(handle);
+	if (sampInfo == 0)
+		return false;
 
-	// Set the shader resource view
-	deviceContext->DSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	// Set the sampler state
+	stateCache->SetSamplerState(SIMPLE_STAGE_DOMAIN, sampInfo->BindIndex, samplerState.Get());
 
 	// Success
 	return true;
 }
 
 // --------------------------------------------------------
-// Sets a sampler state in the domain shader stage
+// Binds a range of an external buffer in the domain shader stage,
+// in the register of one of this shader's constant buffers
 //
-// name - The name of the sampler state in the shader
-// samplerState - The sampler state in GPU memory
+// bufferName - The name of the constant buffer in the shader
+// buffer - The buffer holding the data
+// firstConstant, numConstants - The range, in 16 byte constants
 //
-// Returns true if a sampler of the given name was found, false otherwise
+// Returns true if the buffer was found and the range could be bound
 // --------------------------------------------------------
-bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleDomainShader::SetConstantBufferSlice(std::string bufferName, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
 {
-	// Look for the variable and verify
-	const SimpleSampler* sampInfo = GetSamplerInfo(name);
-	if (sampInfo == 0)
+	// Offsets need an 11.1 context
+	SimpleConstantBuffer* cb = FindConstantBuffer(bufferName);
+	if (cb == 0 || !deviceContext1)
 	{
 		if (ReportWarnings)
 		{
-			LogWarning("SimpleDomainShader::SetSamplerState() - Sampler named '");
-			Log(name);
-			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
+			LogWarning("SimpleDomainShader::SetConstantBufferSlice() - Constant buffer named '");
+			Log(bufferName);
+			LogWarning("' was not found in the shader, or the device context doesn't support offsets.\n");
 		}
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->DSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	// The handle version does the actual binding
+	return SetConstantBufferSlice(GetBufferHandle(bufferName), buffer, firstConstant, numConstants);
+}
 
-	// Success
-	return true;
+// --------------------------------------------------------
+// Binds a range of an external buffer by constant buffer handle
+//
+// Returns true if the buffer was found and the range could be bound
+// --------------------------------------------------------
+bool SimpleDomainShader::SetConstantBufferSlice(SimpleBufferHandle handle, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	SimpleConstantBuffer* cb = FindConstantBuffer(handle);
+	if (cb == 0 || !deviceContext1)
+		return false;
+
+	return stateCache->SetConstantBufferRange(SIMPLE_STAGE_DOMAIN, cb->BindIndex, buffer, firstConstant, numConstants);
 }
 
 
@@ -1272,7 +2050,7 @@ void SimpleHullShader::CleanUp()
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob)
+bool SimpleHullShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, const ShaderCacheEntry& reflection)
 {
 	// Clean up first, in the event this method is
 	// called more than once on the same object
@@ -1299,7 +2077,7 @@ void SimpleHullShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->HSSetShader(shader.Get(), 0, 0);
+	stateCache->SetShader(SIMPLE_STAGE_HULL, shader.Get());
 
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1309,10 +2087,10 @@ void SimpleHullShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->HSSetConstantBuffers(
+		stateCache->SetConstantBuffer(
+			SIMPLE_STAGE_HULL,
 			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+			constantBuffers[i].ConstantBuffer.Get());
 	}
 }
 
@@ -1339,8 +2117,23 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::C
 		return false;
 	}
 
+	// The handle version does the actual binding
+	return SetShaderResourceView(GetShaderResourceViewHandle(name), srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view by handle
+//
+// Returns true if this shader has the SRV, false otherwise
+// --------------------------------------------------------
+bool SimpleHullShader::SetShaderResourceView(SimpleSRVHandle handle, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	const SimpleSRV* srvInfo = FindShaderResourceView(handle);
+	if (srvInfo == 0)
+		return false;
+
 	// Set the shader resource view
-	deviceContext->HSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	stateCache->SetShaderResourceView(SIMPLE_STAGE_HULL, srvInfo->BindIndex, srv.Get());
 
 	// Success
 	return true;
@@ -1369,13 +2162,71 @@ bool SimpleHullShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->HSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	// The handle version does the actual binding
+	return SetSamplerState(GetSamplerHandle(name), samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state by handle
+//
+// Returns true if this shader has the sampler, false otherwise
+// --------------------------------------------------------
+bool SimpleHullShader::SetSamplerState(SimpleSamplerHandle handle, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	const SimpleSampler* sampInfo = FindSamplerState(handle);
+	if (sampInfo == 0)
+		return false;
+
+	// Set the sampler state
+	stateCache->SetSamplerState(SIMPLE_STAGE_HULL, sampInfo->BindIndex, samplerState.Get());
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a range of an external buffer in the hull shader stage,
+// in the register of one of this shader's constant buffers
+//
+// bufferName - The name of the constant buffer in the shader
+// buffer - The buffer holding the data
+// firstConstant, numConstants - The range, in 16 byte constants
+//
+// Returns true if the buffer was found and the range could be bound
+// --------------------------------------------------------
+bool SimpleHullShader::SetConstantBufferSlice(std::string bufferName, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	// Offsets need an 11.1 context
+	SimpleConstantBuffer* cb = FindConstantBuffer(bufferName);
+	if (cb == 0 || !deviceContext1)
+	{
+		if (ReportWarnings)
+		{
+			LogWarning("SimpleHullShader::SetConstantBufferSlice() - Constant buffer named '");
+			Log(bufferName);
+			LogWarning("' was not found in the shader, or the device context doesn't support offsets.\n");
+		}
+		return false;
+	}
+
+	// The handle version does the actual binding
+	return SetConstantBufferSlice(GetBufferHandle(bufferName), buffer, firstConstant, numConstants);
+}
+
+// --------------------------------------------------------
+// Binds a range of an external buffer by constant buffer handle
+//
+// Returns true if the buffer was found and the range could be bound
+// --------------------------------------------------------
+bool SimpleHullShader::SetConstantBufferSlice(SimpleBufferHandle handle, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	SimpleConstantBuffer* cb = FindConstantBuffer(handle);
+	if (cb == 0 || !deviceContext1)
+		return false;
+
+	return stateCache->SetConstantBufferRange(SIMPLE_STAGE_HULL, cb->BindIndex, buffer, firstConstant, numConstants);
+}
+
 
 
 
@@ -1420,7 +2271,7 @@ void SimpleGeometryShader::CleanUp()
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob)
+bool SimpleGeometryShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, const ShaderCacheEntry& reflection)
 {
 	// Clean up first, in the event this method is
 	// called more than once on the same object
@@ -1428,7 +2279,7 @@ bool SimpleGeometryShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderB
 
 	// Using stream out?
 	if (useStreamOut)
-		return this->CreateShaderWithStreamOut(shaderBlob);
+		return this->CreateShaderWithStreamOut(shaderBlob, reflection);
 
 	// Create the shader from the blob
 	HRESULT result = device->CreateGeometryShader(
@@ -1449,38 +2300,22 @@ bool SimpleGeometryShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderB
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob)
+bool SimpleGeometryShader::CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, const ShaderCacheEntry& reflection)
 {
 	// Clean up first, in the event this method is
 	// called more than once on the same object
 	this->CleanUp();
 
-	// Reflect shader info
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
 	// Set up the output signature
 	streamOutVertexSize = 0;
 	std::vector<D3D11_SO_DECLARATION_ENTRY> soDecl;
-	for (unsigned int i = 0; i < shaderDesc.OutputParameters; i++)
+	for (auto& paramDesc : reflection.OutputParameters)
 	{
-		// Get the info about this entry
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetOutputParameterDesc(i, &paramDesc);
-		
 		// Create the SO Declaration
 		D3D11_SO_DECLARATION_ENTRY entry = {};
 		entry.SemanticIndex  = paramDesc.SemanticIndex;
-		entry.SemanticName   = paramDesc.SemanticName;
-		entry.Stream         = paramDesc.Stream;
+		entry.SemanticName   = paramDesc.SemanticName.c_str();
+		entry.Stream         = (BYTE)paramDesc.Stream;
 		entry.StartComponent = 0; // Assume starting at 0
 		entry.OutputSlot     = 0; // Assume the first output slot
 
@@ -1573,7 +2408,7 @@ void SimpleGeometryShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->GSSetShader(shader.Get(), 0, 0);
+	stateCache->SetShader(SIMPLE_STAGE_GEOMETRY, shader.Get());
 
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1583,10 +2418,10 @@ void SimpleGeometryShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->GSSetConstantBuffers(
+		stateCache->SetConstantBuffer(
+			SIMPLE_STAGE_GEOMETRY,
 			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+			constantBuffers[i].ConstantBuffer.Get());
 	}
 }
 
@@ -1613,8 +2448,23 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WR
 		return false;
 	}
 
+	// The handle version does the actual binding
+	return SetShaderResourceView(GetShaderResourceViewHandle(name), srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view by handle
+//
+// Returns true if this shader has the SRV, false otherwise
+// --------------------------------------------------------
+bool SimpleGeometryShader::SetShaderResourceView(SimpleSRVHandle handle, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	const SimpleSRV* srvInfo = FindShaderResourceView(handle);
+	if (srvInfo == 0)
+		return false;
+
 	// Set the shader resource view
-	deviceContext->GSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	stateCache->SetShaderResourceView(SIMPLE_STAGE_GEOMETRY, srvInfo->BindIndex, srv.Get());
 
 	// Success
 	return true;
@@ -1643,13 +2493,71 @@ bool SimpleGeometryShader::SetSamplerState(std::string name, Microsoft::WRL::Com
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->GSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	// The handle version does the actual binding
+	return SetSamplerState(GetSamplerHandle(name), samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state by handle
+//
+// Returns true if this shader has the sampler, false otherwise
+// --------------------------------------------------------
+bool SimpleGeometryShader::SetSamplerState(SimpleSamplerHandle handle, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	const SimpleSampler* sampInfo = FindSamplerState(handle);
+	if (sampInfo == 0)
+		return false;
+
+	// Set the sampler state
+	stateCache->SetSamplerState(SIMPLE_STAGE_GEOMETRY, sampInfo->BindIndex, samplerState.Get());
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a range of an external buffer in the geometry shader stage,
+// in the register of one of this shader's constant buffers
+//
+// bufferName - The name of the constant buffer in the shader
+// buffer - The buffer holding the data
+// firstConstant, numConstants - The range, in 16 byte constants
+//
+// Returns true if the buffer was found and the range could be bound
+// --------------------------------------------------------
+bool SimpleGeometryShader::SetConstantBufferSlice(std::string bufferName, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	// Offsets need an 11.1 context
+	SimpleConstantBuffer* cb = FindConstantBuffer(bufferName);
+	if (cb == 0 || !deviceContext1)
+	{
+		if (ReportWarnings)
+		{
+			LogWarning("SimpleGeometryShader::SetConstantBufferSlice() - Constant buffer named '");
+			Log(bufferName);
+			LogWarning("' was not found in the shader, or the device context doesn't support offsets.\n");
+		}
+		return false;
+	}
+
+	// The handle version does the actual binding
+	return SetConstantBufferSlice(GetBufferHandle(bufferName), buffer, firstConstant, numConstants);
+}
+
+// --------------------------------------------------------
+// Binds a range of an external buffer by constant buffer handle
+//
+// Returns true if the buffer was found and the range could be bound
+// --------------------------------------------------------
+bool SimpleGeometryShader::SetConstantBufferSlice(SimpleBufferHandle handle, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	SimpleConstantBuffer* cb = FindConstantBuffer(handle);
+	if (cb == 0 || !deviceContext1)
+		return false;
+
+	return stateCache->SetConstantBufferRange(SIMPLE_STAGE_GEOMETRY, cb->BindIndex, buffer, firstConstant, numConstants);
+}
+
 // --------------------------------------------------------
 // Calculates the number of components specified by a parameter description mask
 //
@@ -1713,7 +2621,7 @@ void SimpleComputeShader::CleanUp()
 //
 // Returns true if shader is created correctly, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob)
+bool SimpleComputeShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, const ShaderCacheEntry& reflection)
 {
 	// Clean up first, in the event this method is
 	// called more than once on the same object
@@ -1730,34 +2638,17 @@ bool SimpleComputeShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBl
 	if (result != S_OK)
 		return false;
 
-	// Set up shader reflection to get information about UAV's
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-	
 	// Grab the thread info
-	threadsTotal = refl->GetThreadGroupSize(
-		&threadsX,
-		&threadsY,
-		&threadsZ);
+	threadsX = reflection.ThreadGroupSize[0];
+	threadsY = reflection.ThreadGroupSize[1];
+	threadsZ = reflection.ThreadGroupSize[2];
+	threadsTotal = threadsX * threadsY * threadsZ;
 
 	// Loop and get all UAV resources
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
+	for (auto& resource : reflection.Resources)
 	{
-		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
-
 		// Check the type, looking for any kind of UAV
-		switch (resourceDesc.Type)
+		switch (resource.Type)
 		{
 		case D3D_SIT_UAV_APPEND_STRUCTURED:
 		case D3D_SIT_UAV_CONSUME_STRUCTURED:
@@ -1765,7 +2656,7 @@ bool SimpleComputeShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBl
 		case D3D_SIT_UAV_RWSTRUCTURED:
 		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
 		case D3D_SIT_UAV_RWTYPED:
-			uavTable.insert(std::pair<std::string, unsigned int>(resourceDesc.Name, resourceDesc.BindPoint));
+			uavTable.insert(std::pair<std::string, unsigned int>(resource.Name, resource.BindIndex));
 		}
 	}
 
@@ -1783,7 +2674,7 @@ void SimpleComputeShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->CSSetShader(shader.Get(), 0, 0);
+	stateCache->SetShader(SIMPLE_STAGE_COMPUTE, shader.Get());
 
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1793,10 +2684,10 @@ void SimpleComputeShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->CSSetConstantBuffers(
+		stateCache->SetConstantBuffer(
+			SIMPLE_STAGE_COMPUTE,
 			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+			constantBuffers[i].ConstantBuffer.Get());
 	}
 }
 
@@ -1884,8 +2775,23 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL
 		return false;
 	}
 
+	// The handle version does the actual binding
+	return SetShaderResourceView(GetShaderResourceViewHandle(name), srv);
+}
+
+// --------------------------------------------------------
+// Sets a shader resource view by handle
+//
+// Returns true if this shader has the SRV, false otherwise
+// --------------------------------------------------------
+bool SimpleComputeShader::SetShaderResourceView(SimpleSRVHandle handle, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	const SimpleSRV* srvInfo = FindShaderResourceView(handle);
+	if (srvInfo == 0)
+		return false;
+
 	// Set the shader resource view
-	deviceContext->CSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	stateCache->SetShaderResourceView(SIMPLE_STAGE_COMPUTE, srvInfo->BindIndex, srv.Get());
 
 	// Success
 	return true;
@@ -1914,13 +2820,71 @@ bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComP
 		return false;
 	}
 
-	// Set the shader resource view
-	deviceContext->CSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	// The handle version does the actual binding
+	return SetSamplerState(GetSamplerHandle(name), samplerState);
+}
+
+// --------------------------------------------------------
+// Sets a sampler state by handle
+//
+// Returns true if this shader has the sampler, false otherwise
+// --------------------------------------------------------
+bool SimpleComputeShader::SetSamplerState(SimpleSamplerHandle handle, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+{
+	const SimpleSampler* sampInfo = FindSamplerState(handle);
+	if (sampInfo == 0)
+		return false;
+
+	// Set the sampler state
+	stateCache->SetSamplerState(SIMPLE_STAGE_COMPUTE, sampInfo->BindIndex, samplerState.Get());
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a range of an external buffer in the compute shader stage,
+// in the register of one of this shader's constant buffers
+//
+// bufferName - The name of the constant buffer in the shader
+// buffer - The buffer holding the data
+// firstConstant, numConstants - The range, in 16 byte constants
+//
+// Returns true if the buffer was found and the range could be bound
+// --------------------------------------------------------
+bool SimpleComputeShader::SetConstantBufferSlice(std::string bufferName, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	// Offsets need an 11.1 context
+	SimpleConstantBuffer* cb = FindConstantBuffer(bufferName);
+	if (cb == 0 || !deviceContext1)
+	{
+		if (ReportWarnings)
+		{
+			LogWarning("SimpleComputeShader::SetConstantBufferSlice() - Constant buffer named '");
+			Log(bufferName);
+			LogWarning("' was not found in the shader, or the device context doesn't support offsets.\n");
+		}
+		return false;
+	}
+
+	// The handle version does the actual binding
+	return SetConstantBufferSlice(GetBufferHandle(bufferName), buffer, firstConstant, numConstants);
+}
+
+// --------------------------------------------------------
+// Binds a range of an external buffer by constant buffer handle
+//
+// Returns true if the buffer was found and the range could be bound
+// --------------------------------------------------------
+bool SimpleComputeShader::SetConstantBufferSlice(SimpleBufferHandle handle, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	SimpleConstantBuffer* cb = FindConstantBuffer(handle);
+	if (cb == 0 || !deviceContext1)
+		return false;
+
+	return stateCache->SetConstantBufferRange(SIMPLE_STAGE_COMPUTE, cb->BindIndex, buffer, firstConstant, numConstants);
+}
+
 // --------------------------------------------------------
 // Sets an unordered access view in the Compute shader stage
 //
@@ -1967,4 +2931,177 @@ int SimpleComputeShader::GetUnorderedAccessViewIndex(std::string name)
 
 	// Success
 	return result->second;
-}
\ No newline at end of file
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ SIMPLE STATE CACHE --------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+// --------------------------------------------------------
+// Gets the cache for a context, creating it on first use
+// --------------------------------------------------------
+SimpleStateCache* SimpleStateCache::ForContext(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+{
+	static std::mutex cacheMutex;
+	static std::unordered_map<ID3D11DeviceContext*, std::unique_ptr<SimpleStateCache>> caches;
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	std::unique_ptr<SimpleStateCache>& cache = caches[context.Get()];
+	if (!cache)
+		cache.reset(new SimpleStateCache(context));
+	return cache.get();
+}
+
+SimpleStateCache::SimpleStateCache(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+{
+	// The context owns its caches, so don't hold a reference to it
+	deviceContext = context.Get();
+	context.As(&deviceContext1);
+
+	callsIssued = 0;
+	callsFiltered = 0;
+	Invalidate();
+}
+
+// --------------------------------------------------------
+// Marks every slot as unknown.  Use after binding state
+// on the context directly (UI, clearing SRVs, etc.)
+// --------------------------------------------------------
+void SimpleStateCache::Invalidate()
+{
+	inputLayout.Known = false;
+	for (int s = 0; s < SIMPLE_STAGE_COUNT; s++)
+	{
+		StageBindings& stage = stages[s];
+		stage.Shader.Known = false;
+		for (auto& b : stage.ConstantBuffers) b.Known = false;
+		for (auto& b : stage.ShaderResourceViews) b.Known = false;
+		for (auto& b : stage.Samplers) b.Known = false;
+	}
+}
+
+void SimpleStateCache::ResetStats()
+{
+	callsIssued = 0;
+	callsFiltered = 0;
+}
+
+// --------------------------------------------------------
+// Returns true (and counts it) if the slot already holds this
+// object, otherwise records the object and counts an issued call
+// --------------------------------------------------------
+bool SimpleStateCache::IsRedundant(Binding& binding, const void* object, unsigned int firstConstant, unsigned int numConstants)
+{
+	if (binding.Known &&
+		binding.Object == object &&
+		binding.FirstConstant == firstConstant &&
+		binding.NumConstants == numConstants)
+	{
+		callsFiltered++;
+		return true;
+	}
+
+	binding.Object = object;
+	binding.FirstConstant = firstConstant;
+	binding.NumConstants = numConstants;
+	binding.Known = true;
+	callsIssued++;
+	return false;
+}
+
+void SimpleStateCache::SetInputLayout(ID3D11InputLayout* layout)
+{
+	if (IsRedundant(inputLayout, layout, 0, 0))
+		return;
+
+	deviceContext->IASetInputLayout(layout);
+}
+
+void SimpleStateCache::SetShader(SimpleShaderStage stage, ID3D11DeviceChild* shader)
+{
+	if (IsRedundant(stages[stage].Shader, shader, 0, 0))
+		return;
+
+	switch (stage)
+	{
+	case SIMPLE_STAGE_VERTEX: deviceContext->VSSetShader(static_cast<ID3D11VertexShader*>(shader), 0, 0); break;
+	case SIMPLE_STAGE_PIXEL: deviceContext->PSSetShader(static_cast<ID3D11PixelShader*>(shader), 0, 0); break;
+	case SIMPLE_STAGE_DOMAIN: deviceContext->DSSetShader(static_cast<ID3D11DomainShader*>(shader), 0, 0); break;
+	case SIMPLE_STAGE_HULL: deviceContext->HSSetShader(static_cast<ID3D11HullShader*>(shader), 0, 0); break;
+	case SIMPLE_STAGE_GEOMETRY: deviceContext->GSSetShader(static_cast<ID3D11GeometryShader*>(shader), 0, 0); break;
+	case SIMPLE_STAGE_COMPUTE: deviceContext->CSSetShader(static_cast<ID3D11ComputeShader*>(shader), 0, 0); break;
+	}
+}
+
+void SimpleStateCache::SetConstantBuffer(SimpleShaderStage stage, unsigned int slot, ID3D11Buffer* buffer)
+{
+	// A zero range means "the whole buffer"
+	if (IsRedundant(stages[stage].ConstantBuffers[slot], buffer, 0, 0))
+		return;
+
+	switch (stage)
+	{
+	case SIMPLE_STAGE_VERTEX: deviceContext->VSSetConstantBuffers(slot, 1, &buffer); break;
+	case SIMPLE_STAGE_PIXEL: deviceContext->PSSetConstantBuffers(slot, 1, &buffer); break;
+	case SIMPLE_STAGE_DOMAIN: deviceContext->DSSetConstantBuffers(slot, 1, &buffer); break;
+	case SIMPLE_STAGE_HULL: deviceContext->HSSetConstantBuffers(slot, 1, &buffer); break;
+	case SIMPLE_STAGE_GEOMETRY: deviceContext->GSSetConstantBuffers(slot, 1, &buffer); break;
+	case SIMPLE_STAGE_COMPUTE: deviceContext->CSSetConstantBuffers(slot, 1, &buffer); break;
+	}
+}
+
+// --------------------------------------------------------
+// Binds part of a buffer, which needs an 11.1 context.
+// Returns false if offsets aren't supported.
+// --------------------------------------------------------
+bool SimpleStateCache::SetConstantBufferRange(SimpleShaderStage stage, unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	if (!deviceContext1)
+		return false;
+
+	if (IsRedundant(stages[stage].ConstantBuffers[slot], buffer, firstConstant, numConstants))
+		return true;
+
+	switch (stage)
+	{
+	case SIMPLE_STAGE_VERTEX: deviceContext1->VSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &numConstants); break;
+	case SIMPLE_STAGE_PIXEL: deviceContext1->PSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &numConstants); break;
+	case SIMPLE_STAGE_DOMAIN: deviceContext1->DSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &numConstants); break;
+	case SIMPLE_STAGE_HULL: deviceContext1->HSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &numConstants); break;
+	case SIMPLE_STAGE_GEOMETRY: deviceContext1->GSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &numConstants); break;
+	case SIMPLE_STAGE_COMPUTE: deviceContext1->CSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &numConstants); break;
+	}
+	return true;
+}
+
+void SimpleStateCache::SetShaderResourceView(SimpleShaderStage stage, unsigned int slot, ID3D11ShaderResourceView* srv)
+{
+	if (IsRedundant(stages[stage].ShaderResourceViews[slot], srv, 0, 0))
+		return;
+
+	switch (stage)
+	{
+	case SIMPLE_STAGE_VERTEX: deviceContext->VSSetShaderResources(slot, 1, &srv); break;
+	case SIMPLE_STAGE_PIXEL: deviceContext->PSSetShaderResources(slot, 1, &srv); break;
+	case SIMPLE_STAGE_DOMAIN: deviceContext->DSSetShaderResources(slot, 1, &srv); break;
+	case SIMPLE_STAGE_HULL: deviceContext->HSSetShaderResources(slot, 1, &srv); break;
+	case SIMPLE_STAGE_GEOMETRY: deviceContext->GSSetShaderResources(slot, 1, &srv); break;
+	case SIMPLE_STAGE_COMPUTE: deviceContext->CSSetShaderResources(slot, 1, &srv); break;
+	}
+}
+
+void SimpleStateCache::SetSamplerState(SimpleShaderStage stage, unsigned int slot, ID3D11SamplerState* samplerState)
+{
+	if (IsRedundant(stages[stage].Samplers[slot], samplerState, 0, 0))
+		return;
+
+	switch (stage)
+	{
+	case SIMPLE_STAGE_VERTEX: deviceContext->VSSetSamplers(slot, 1, &samplerState); break;
+	case SIMPLE_STAGE_PIXEL: deviceContext->PSSetSamplers(slot, 1, &samplerState); break;
+	case SIMPLE_STAGE_DOMAIN: deviceContext->DSSetSamplers(slot, 1, &samplerState); break;
+	case SIMPLE_STAGE_HULL: deviceContext->HSSetSamplers(slot, 1, &samplerState); break;
+	case SIMPLE_STAGE_GEOMETRY: deviceContext->GSSetSamplers(slot, 1, &samplerState); break;
+	case SIMPLE_STAGE_COMPUTE: deviceContext->CSSetSamplers(slot, 1, &samplerState); break;
+	}
+}
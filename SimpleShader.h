@@ -3,13 +3,18 @@
 #pragma comment(lib, "d3dcompiler.lib")
 
 #include <d3d11.h>
+#include <d3d11_1.h>
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
 #include <wrl/client.h>
 
 #include <unordered_map>
 #include <vector>
+#include <memory>
 #include <string>
+#include <mutex>
+
+#include "ShaderCache.h"
 
 
 // --------------------------------------------------------
@@ -37,6 +42,11 @@ struct SimpleConstantBuffer
 	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer = 0;
 	unsigned char* LocalDataBuffer = 0;
 	std::vector<SimpleShaderVariable> Variables;
+
+	// Byte range of LocalDataBuffer that differs from the GPU copy
+	bool Dirty = true;
+	unsigned int DirtyStart = 0;
+	unsigned int DirtyEnd = 0;
 };
 
 // --------------------------------------------------------
@@ -57,6 +67,106 @@ struct SimpleSampler
 	unsigned int BindIndex; // The register of the Sampler
 };
 
+// --------------------------------------------------------
+// Handles for setting shader data without string lookups.
+// Every name maps to one id shared by all shaders, so a handle
+// resolved once works with any shader that has a variable
+// (or buffer, SRV or sampler) of that name.
+// --------------------------------------------------------
+#define SIMPLE_SHADER_INVALID_HANDLE 0xFFFFFFFF
+
+struct SimpleVariableHandle
+{
+	unsigned int ID = SIMPLE_SHADER_INVALID_HANDLE;
+};
+
+struct SimpleBufferHandle
+{
+	unsigned int ID = SIMPLE_SHADER_INVALID_HANDLE;
+};
+
+struct SimpleSRVHandle
+{
+	unsigned int ID = SIMPLE_SHADER_INVALID_HANDLE;
+};
+
+struct SimpleSamplerHandle
+{
+	unsigned int ID = SIMPLE_SHADER_INVALID_HANDLE;
+};
+
+// --------------------------------------------------------
+// Shadow copy of the pipeline state SimpleShader binds, one
+// per device context and shared by every shader stage.  Binds
+// that match what's already in the slot are dropped.
+//
+// Anything that binds shaders, constant buffers, SRVs or
+// samplers directly on the context must either go through
+// this cache or call Invalidate() afterwards.
+// --------------------------------------------------------
+enum SimpleShaderStage
+{
+	SIMPLE_STAGE_VERTEX,
+	SIMPLE_STAGE_PIXEL,
+	SIMPLE_STAGE_DOMAIN,
+	SIMPLE_STAGE_HULL,
+	SIMPLE_STAGE_GEOMETRY,
+	SIMPLE_STAGE_COMPUTE,
+	SIMPLE_STAGE_COUNT
+};
+
+class SimpleStateCache
+{
+public:
+	static SimpleStateCache* ForContext(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	void SetInputLayout(ID3D11InputLayout* inputLayout);
+	void SetShader(SimpleShaderStage stage, ID3D11DeviceChild* shader);
+	void SetConstantBuffer(SimpleShaderStage stage, unsigned int slot, ID3D11Buffer* buffer);
+	bool SetConstantBufferRange(SimpleShaderStage stage, unsigned int slot, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
+	void SetShaderResourceView(SimpleShaderStage stage, unsigned int slot, ID3D11ShaderResourceView* srv);
+	void SetSamplerState(SimpleShaderStage stage, unsigned int slot, ID3D11SamplerState* samplerState);
+
+	// Forget everything, so the next bind of each slot is issued
+	void Invalidate();
+
+	// Counts since the last ResetStats()
+	void ResetStats();
+	unsigned int GetCallsIssued() { return callsIssued; }
+	unsigned int GetCallsFiltered() { return callsFiltered; }
+
+private:
+	SimpleStateCache(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	// What's in one slot, and whether that's actually known
+	struct Binding
+	{
+		const void* Object;
+		unsigned int FirstConstant;
+		unsigned int NumConstants;
+		bool Known;
+	};
+
+	struct StageBindings
+	{
+		Binding Shader;
+		Binding ConstantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+		Binding ShaderResourceViews[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
+		Binding Samplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+	};
+
+	bool IsRedundant(Binding& binding, const void* object, unsigned int firstConstant, unsigned int numConstants);
+
+	ID3D11DeviceContext* deviceContext;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> deviceContext1; // Null before D3D 11.1
+
+	Binding inputLayout;
+	StageBindings stages[SIMPLE_STAGE_COUNT];
+
+	unsigned int callsIssued;
+	unsigned int callsFiltered;
+};
+
 // --------------------------------------------------------
 // Base abstract class for simplifying shader handling
 // --------------------------------------------------------
@@ -68,6 +178,7 @@ public:
 
 	// Simple helpers
 	bool IsShaderValid() { return shaderValid; }
+	unsigned int GetSortID() { return sortID; }
 
 	// Activating the shader and copying data
 	void SetShader();
@@ -89,10 +200,43 @@ public:
 	bool SetMatrix4x4(std::string name, const float data[16]);
 	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
 
+	// Sets shader data in a slice of an external constant buffer
+	// (like a ConstantBufferRing) rather than the local data buffer
+	bool SetSliceData(void* slice, std::string name, const void* data, unsigned int size);
+	bool SetSliceMatrix4x4(void* slice, std::string name, const DirectX::XMFLOAT4X4 data);
+
 	// Setting shader resources
 	virtual bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
 	virtual bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
 
+	// Binds part of an external buffer in place of one of this shader's constant buffers
+	virtual bool SetConstantBufferSlice(std::string bufferName, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants) = 0;
+
+	// Resolving names to handles - do this once, up front
+	static SimpleVariableHandle GetVariableHandle(std::string name);
+	static SimpleBufferHandle GetBufferHandle(std::string name);
+	static SimpleSRVHandle GetShaderResourceViewHandle(std::string name);
+	static SimpleSamplerHandle GetSamplerHandle(std::string name);
+
+	// Handle versions of the above, with no hashing or allocation
+	void CopyBufferData(SimpleBufferHandle buffer);
+	bool SetData(SimpleVariableHandle variable, const void* data, unsigned int size);
+	bool SetInt(SimpleVariableHandle variable, int data);
+	bool SetFloat(SimpleVariableHandle variable, float data);
+	bool SetFloat2(SimpleVariableHandle variable, const DirectX::XMFLOAT2 data);
+	bool SetFloat3(SimpleVariableHandle variable, const DirectX::XMFLOAT3 data);
+	bool SetFloat4(SimpleVariableHandle variable, const DirectX::XMFLOAT4 data);
+	bool SetMatrix4x4(SimpleVariableHandle variable, const DirectX::XMFLOAT4X4 data);
+	bool SetSliceData(void* slice, SimpleVariableHandle variable, const void* data, unsigned int size);
+	bool SetSliceMatrix4x4(void* slice, SimpleVariableHandle variable, const DirectX::XMFLOAT4X4 data);
+
+	virtual bool SetShaderResourceView(SimpleSRVHandle handle, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
+	virtual bool SetSamplerState(SimpleSamplerHandle handle, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
+	virtual bool SetConstantBufferSlice(SimpleBufferHandle handle, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants) = 0;
+
+	const SimpleShaderVariable* GetVariableInfo(SimpleVariableHandle variable);
+	const SimpleConstantBuffer* GetBufferInfo(SimpleBufferHandle buffer);
+
 	// Simple resource checking
 	bool HasVariable(std::string name);
 	bool HasShaderResourceView(std::string name);
@@ -122,12 +266,27 @@ public:
 	static bool ReportErrors;
 	static bool ReportWarnings;
 
+	// Load from (and write) .sscache files next to compiled shaders
+	static bool UseShaderCache;
+	bool WasLoadedFromCache() { return loadedFromCache; }
+
+	// Constant buffer upload counters, summed over every shader
+	// until ResetUploadStats() is called (usually once per frame)
+	static unsigned int BytesUploaded;
+	static unsigned int UploadsSkipped;
+	static void ResetUploadStats();
+
 protected:
 	
 	bool shaderValid;
+	bool loadedFromCache;
+	unsigned int sortID;
 	Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> deviceContext1; // Null before D3D 11.1
+	bool partialBufferUpdates; // Can UpdateSubresource1 copy part of a constant buffer?
+	SimpleStateCache* stateCache; // Shared with every shader on this context
 
 	// Resource counts
 	unsigned int constantBufferCount;
@@ -141,11 +300,31 @@ protected:
 	std::unordered_map<std::string, SimpleSRV*> textureTable;
 	std::unordered_map<std::string, SimpleSampler*> samplerTable;
 
+	// Lookups by handle id, null where this shader doesn't have the name
+	std::vector<SimpleShaderVariable*> variablesByHandle;
+	std::vector<SimpleConstantBuffer*> buffersByHandle;
+	std::vector<SimpleSRV*> srvsByHandle;
+	std::vector<SimpleSampler*> samplersByHandle;
+	void BuildHandleTables();
+	static unsigned int GetHandleID(const std::string& name);
+
+	// Local data writes and uploads, tracking the dirty range
+	void WriteLocalData(SimpleConstantBuffer* cb, unsigned int offset, const void* data, unsigned int size);
+	void UploadBuffer(SimpleConstantBuffer* cb);
+
 	// Initialization method
 	bool LoadShaderFile(LPCWSTR shaderFile);
 
+	// Reflection, either straight from the bytecode or from a cache file
+	void ReflectShader(Microsoft::WRL::ComPtr<ID3DBlob> blob, ShaderCacheEntry* reflection);
+	void BuildReflectionTables(const ShaderCacheEntry& reflection);
+	static ShaderCacheParameter MakeCacheParameter(const D3D11_SIGNATURE_PARAMETER_DESC& paramDesc);
+	static std::wstring GetCacheFileName(LPCWSTR shaderFile);
+	static bool ReadCacheFile(const std::wstring& cacheFile, ShaderCacheEntry* reflection);
+	static void WriteCacheFile(const std::wstring& cacheFile, ShaderCacheEntry& reflection);
+
 	// Pure virtual functions for dealing with shader types
-	virtual bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob) = 0;
+	virtual bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, const ShaderCacheEntry& reflection) = 0;
 	virtual void SetShaderAndCBs() = 0;
 
 	virtual void CleanUp();
@@ -153,6 +332,10 @@ protected:
 	// Helpers for finding data by name
 	SimpleShaderVariable* FindVariable(std::string name, int size);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+	SimpleShaderVariable* FindVariable(SimpleVariableHandle handle);
+	SimpleConstantBuffer* FindConstantBuffer(SimpleBufferHandle handle);
+	const SimpleSRV* FindShaderResourceView(SimpleSRVHandle handle);
+	const SimpleSampler* FindSamplerState(SimpleSamplerHandle handle);
 
 	// Error logging
 	void Log(std::string message, WORD color);
@@ -180,14 +363,24 @@ public:
 
 	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetConstantBufferSlice(std::string bufferName, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
+	bool SetShaderResourceView(SimpleSRVHandle handle, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(SimpleSamplerHandle handle, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetConstantBufferSlice(SimpleBufferHandle handle, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
+
+	// Binds the shader's own buffer again after a slice replaced it
+	bool RestoreConstantBuffer(SimpleBufferHandle handle);
 
 protected:
 	bool perInstanceCompatible;
 	 Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
 	 Microsoft::WRL::ComPtr<ID3D11VertexShader> shader;
-	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
+	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, const ShaderCacheEntry& reflection);
 	void SetShaderAndCBs();
 	void CleanUp();
+
+	// Packed input format from a semantic suffix like "NORMAL_SNORM"
+	static DXGI_FORMAT GetPackedFormat(const std::string& semantic, unsigned int mask);
 };
 
 
@@ -203,10 +396,14 @@ public:
 
 	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetConstantBufferSlice(std::string bufferName, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
+	bool SetShaderResourceView(SimpleSRVHandle handle, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(SimpleSamplerHandle handle, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetConstantBufferSlice(SimpleBufferHandle handle, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> shader;
-	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
+	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, const ShaderCacheEntry& reflection);
 	void SetShaderAndCBs();
 	void CleanUp();
 };
@@ -223,10 +420,14 @@ public:
 
 	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetConstantBufferSlice(std::string bufferName, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
+	bool SetShaderResourceView(SimpleSRVHandle handle, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(SimpleSamplerHandle handle, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetConstantBufferSlice(SimpleBufferHandle handle, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11DomainShader> shader;
-	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
+	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, const ShaderCacheEntry& reflection);
 	void SetShaderAndCBs();
 	void CleanUp();
 };
@@ -243,10 +444,14 @@ public:
 
 	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetConstantBufferSlice(std::string bufferName, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
+	bool SetShaderResourceView(SimpleSRVHandle handle, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(SimpleSamplerHandle handle, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetConstantBufferSlice(SimpleBufferHandle handle, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11HullShader> shader;
-	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
+	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, const ShaderCacheEntry& reflection);
 	void SetShaderAndCBs();
 	void CleanUp();
 };
@@ -263,6 +468,10 @@ public:
 
 	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetConstantBufferSlice(std::string bufferName, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
+	bool SetShaderResourceView(SimpleSRVHandle handle, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(SimpleSamplerHandle handle, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetConstantBufferSlice(SimpleBufferHandle handle, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
 
 	bool CreateCompatibleStreamOutBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer> buffer, int vertexCount);
 
@@ -277,8 +486,8 @@ protected:
 	bool allowStreamOutRasterization;
 	unsigned int streamOutVertexSize;
 
-	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
-	bool CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
+	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, const ShaderCacheEntry& reflection);
+	bool CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, const ShaderCacheEntry& reflection);
 	void SetShaderAndCBs();
 	void CleanUp();
 
@@ -304,6 +513,10 @@ public:
 
 	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetConstantBufferSlice(std::string bufferName, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
+	bool SetShaderResourceView(SimpleSRVHandle handle, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	bool SetSamplerState(SimpleSamplerHandle handle, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetConstantBufferSlice(SimpleBufferHandle handle, ID3D11Buffer* buffer, unsigned int firstConstant, unsigned int numConstants);
 	bool SetUnorderedAccessView(std::string name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset = -1);
 
 	int GetUnorderedAccessViewIndex(std::string name);
@@ -317,7 +530,7 @@ protected:
 	unsigned int threadsZ;
 	unsigned int threadsTotal;
 
-	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
+	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob, const ShaderCacheEntry& reflection);
 	void SetShaderAndCBs();
 	void CleanUp();
 };
\ No newline at end of file
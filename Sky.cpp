@@ -29,6 +29,12 @@ Sky::Sky(
 	// Init render states
 	InitRenderStates();
 
+	// Shader data the sky sets every draw
+	viewHandle = ISimpleShader::GetVariableHandle("view");
+	projectionHandle = ISimpleShader::GetVariableHandle("projection");
+	skyTextureHandle = ISimpleShader::GetShaderResourceViewHandle("skyTexture");
+	samplerOptionsHandle = ISimpleShader::GetSamplerHandle("samplerOptions");
+
 	// Load texture
 	CreateDDSTextureFromFile(device.Get(), cubemapDDSFile, 0, skySRV.GetAddressOf());
 
@@ -66,6 +72,12 @@ Sky::Sky(
 	// Init render states
 	InitRenderStates();
 
+	// Shader data the sky sets every draw
+	viewHandle = ISimpleShader::GetVariableHandle("view");
+	projectionHandle = ISimpleShader::GetVariableHandle("projection");
+	skyTextureHandle = ISimpleShader::GetShaderResourceViewHandle("skyTexture");
+	samplerOptionsHandle = ISimpleShader::GetSamplerHandle("samplerOptions");
+
 	// Create texture from 6 images
 	skySRV = CreateCubemap(right, left, up, down, front, back);
 
@@ -89,13 +101,13 @@ void Sky::Draw(Camera* camera)
 	skyPS->SetShader();
 
 	// Give them proper data
-	skyVS->SetMatrix4x4("view", camera->GetView());
-	skyVS->SetMatrix4x4("projection", camera->GetProjection());
+	skyVS->SetMatrix4x4(viewHandle, camera->GetView());
+	skyVS->SetMatrix4x4(projectionHandle, camera->GetProjection());
 	skyVS->CopyAllBufferData();
 
 	// Send the proper resources to the pixel shader
-	skyPS->SetShaderResourceView("skyTexture", skySRV);
-	skyPS->SetSamplerState("samplerOptions", samplerOptions);
+	skyPS->SetShaderResourceView(skyTextureHandle, skySRV);
+	skyPS->SetSamplerState(samplerOptionsHandle, samplerOptions);
 
 	// Set mesh buffers and draw
 	skyMesh->SetBuffersAndDraw(context);
@@ -277,8 +289,12 @@ void Sky::IBLCreateIrradianceMap(SimpleVertexShader* fullscreenVS, SimplePixelSh
 
 	fullscreenVS->SetShader(); 
 	irradianceMapPS->SetShader(); 
-	irradianceMapPS->SetShaderResourceView("EnvironmentMap", skySRV.Get()); // Skybox texture itself
-	irradianceMapPS->SetSamplerState("BasicSampler", samplerOptions.Get());
+	irradianceMapPS->SetShaderResourceView(ISimpleShader::GetShaderResourceViewHandle("EnvironmentMap"), skySRV.Get()); // Skybox texture itself
+	irradianceMapPS->SetSamplerState(ISimpleShader::GetSamplerHandle("BasicSampler"), samplerOptions.Get());
+
+	SimpleVariableHandle faceIndexHandle = ISimpleShader::GetVariableHandle("faceIndex");
+	SimpleVariableHandle sampleStepPhiHandle = ISimpleShader::GetVariableHandle("sampleStepPhi");
+	SimpleVariableHandle sampleStepThetaHandle = ISimpleShader::GetVariableHandle("sampleStepTheta");
 
 	// Loop through faces of the cube map
 	for (int face = 0; face < 6; face++) {
@@ -300,9 +316,9 @@ void Sky::IBLCreateIrradianceMap(SimpleVertexShader* fullscreenVS, SimplePixelSh
 		context->OMSetRenderTargets(1, rtv.GetAddressOf(), 0);
 
 		// Per-face shader data and copy
-		irradianceMapPS->SetInt("faceIndex", face);
-		irradianceMapPS->SetFloat("sampleStepPhi", 0.05f);
-		irradianceMapPS->SetFloat("sampleStepTheta", 0.05f);
+		irradianceMapPS->SetInt(faceIndexHandle, face);
+		irradianceMapPS->SetFloat(sampleStepPhiHandle, 0.05f);
+		irradianceMapPS->SetFloat(sampleStepThetaHandle, 0.05f);
 		irradianceMapPS->CopyAllBufferData();
 
 		// Render exactly 3 vertices
@@ -366,8 +382,12 @@ void Sky::IBLCreateConvolvedSpecularMap(SimpleVertexShader* fullscreenVS, Simple
 
 	fullscreenVS->SetShader();
 	specularConvolutionPS->SetShader();
-	specularConvolutionPS->SetShaderResourceView("EnvironmentMap", skySRV.Get()); // Skybox texture itself
-	specularConvolutionPS->SetSamplerState("BasicSampler", samplerOptions.Get());
+	specularConvolutionPS->SetShaderResourceView(ISimpleShader::GetShaderResourceViewHandle("EnvironmentMap"), skySRV.Get()); // Skybox texture itself
+	specularConvolutionPS->SetSamplerState(ISimpleShader::GetSamplerHandle("BasicSampler"), samplerOptions.Get());
+
+	SimpleVariableHandle roughnessHandle = ISimpleShader::GetVariableHandle("roughness");
+	SimpleVariableHandle faceIndexHandle = ISimpleShader::GetVariableHandle("faceIndex");
+	SimpleVariableHandle mipLevelHandle = ISimpleShader::GetVariableHandle("mipLevel");
 
 	for (int currentMipLevel = 0; currentMipLevel < totalSpecIBLMipLevels; currentMipLevel++) {
 		// Loop through faces of the cube map
@@ -398,9 +418,9 @@ void Sky::IBLCreateConvolvedSpecularMap(SimpleVertexShader* fullscreenVS, Simple
 			context->RSSetViewports(1, &vp);
 
 			// Handle per-face shader data and copy
-			specularConvolutionPS->SetFloat("roughness", currentMipLevel / (float)(totalSpecIBLMipLevels - 1));    
-			specularConvolutionPS->SetInt("faceIndex", face);
-			specularConvolutionPS->SetInt("mipLevel", currentMipLevel);
+			specularConvolutionPS->SetFloat(roughnessHandle, currentMipLevel / (float)(totalSpecIBLMipLevels - 1));    
+			specularConvolutionPS->SetInt(faceIndexHandle, face);
+			specularConvolutionPS->SetInt(mipLevelHandle, currentMipLevel);
 			specularConvolutionPS->CopyAllBufferData();
 
 			// Render exactly 3 vertices
@@ -84,6 +84,11 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
 
+	SimpleVariableHandle viewHandle;
+	SimpleVariableHandle projectionHandle;
+	SimpleSRVHandle skyTextureHandle;
+	SimpleSamplerHandle samplerOptionsHandle;
+
 	// IBL
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> irradianceMap;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> convolvedSpecularMap;
@@ -0,0 +1,15 @@
+#pragma once
+
+// --------------------------------------------------------
+// A range of a mesh's index buffer, drawn with its own
+// material.  Indices are relative to BaseVertex, and
+// MaterialIndex is the material slot from the model file.
+// Single material meshes have one covering every index.
+// --------------------------------------------------------
+struct Submesh
+{
+	unsigned int IndexStart;
+	unsigned int IndexCount;
+	unsigned int BaseVertex;
+	unsigned int MaterialIndex;
+};
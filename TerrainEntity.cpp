@@ -27,6 +27,47 @@ TerrainEntity::TerrainEntity(
 		samplerOptions(samplerOptions) {
 	transform.SetPosition(0, 0, 0);
 	transform.SetScale(10, 7, 10);
+
+	// Lighting never changes, so it only goes into the local
+	// buffers once and gets copied along with everything else
+	ps->SetFloat(ISimpleShader::GetVariableHandle("lightIntensity"), 1.0f);
+	ps->SetFloat3(ISimpleShader::GetVariableHandle("lightColor"), XMFLOAT3(0.8f, 0.8f, 0.8f));
+	ps->SetFloat3(ISimpleShader::GetVariableHandle("lightDirection"), XMFLOAT3(1, -1, 1));
+
+	ps->SetFloat(ISimpleShader::GetVariableHandle("pointLightIntensity"), 1.0f);
+	ps->SetFloat(ISimpleShader::GetVariableHandle("pointLightRange"), 10.0f);
+	ps->SetFloat3(ISimpleShader::GetVariableHandle("pointLightColor"), XMFLOAT3(1, 1, 1));
+	ps->SetFloat3(ISimpleShader::GetVariableHandle("pointLightPos"), XMFLOAT3(0, 4, 0));
+
+	ps->SetFloat3(ISimpleShader::GetVariableHandle("environmentAmbientColor"), XMFLOAT3(0.05f, 0.1f, 0.15f));
+
+	ps->SetFloat(ISimpleShader::GetVariableHandle("uvScale0"), 50.0f);
+	ps->SetFloat(ISimpleShader::GetVariableHandle("uvScale1"), 50.0f);
+	ps->SetFloat(ISimpleShader::GetVariableHandle("uvScale2"), 50.0f);
+
+	ps->SetFloat(ISimpleShader::GetVariableHandle("specularAdjust"), 0.0f);
+
+	vs->SetFloat4(ISimpleShader::GetVariableHandle("colorTint"), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
+
+	// Compact vertices need their positions dequantized in the vs
+	if (mesh->GetVertexFormat() == MESH_VERTEX_COMPACT) {
+		vs->SetFloat3(ISimpleShader::GetVariableHandle("positionOffset"), mesh->GetPositionOffset());
+		vs->SetFloat3(ISimpleShader::GetVariableHandle("positionScale"), mesh->GetPositionScale());
+	}
+
+	// Everything set per draw
+	cameraPositionHandle = ISimpleShader::GetVariableHandle("cameraPosition");
+	worldHandle = ISimpleShader::GetVariableHandle("world");
+	viewHandle = ISimpleShader::GetVariableHandle("view");
+	projHandle = ISimpleShader::GetVariableHandle("proj");
+	blendMapHandle = ISimpleShader::GetShaderResourceViewHandle("blendMap");
+	texture0Handle = ISimpleShader::GetShaderResourceViewHandle("texture0");
+	texture1Handle = ISimpleShader::GetShaderResourceViewHandle("texture1");
+	texture2Handle = ISimpleShader::GetShaderResourceViewHandle("texture2");
+	normalMap0Handle = ISimpleShader::GetShaderResourceViewHandle("normalMap0");
+	normalMap1Handle = ISimpleShader::GetShaderResourceViewHandle("normalMap1");
+	normalMap2Handle = ISimpleShader::GetShaderResourceViewHandle("normalMap2");
+	samplerOptionsHandle = ISimpleShader::GetSamplerHandle("samplerOptions");
 }
 
 Mesh* TerrainEntity::GetMesh() { return mesh; }
@@ -38,41 +79,23 @@ void TerrainEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Ca
 	vs->SetShader();
 	ps->SetShader();
 
-	ps->SetFloat("lightIntensity", 1.0f);
-	ps->SetFloat3("lightColor", XMFLOAT3(0.8f, 0.8f, 0.8f));
-	ps->SetFloat3("lightDirection", XMFLOAT3(1, -1, 1));
-
-	ps->SetFloat("pointLightIntensity", 1.0f);
-	ps->SetFloat("pointLightRange", 10.0f);
-	ps->SetFloat3("pointLightColor", XMFLOAT3(1, 1, 1));
-	ps->SetFloat3("pointLightPos", XMFLOAT3(0, 4, 0));
-
-	ps->SetFloat3("environmentAmbientColor", XMFLOAT3(0.05f, 0.1f, 0.15f));
-
-	ps->SetFloat3("cameraPosition", camera->GetTransform()->GetPosition());
-
-	ps->SetFloat("uvScale0", 50.0f);
-	ps->SetFloat("uvScale1", 50.0f);
-	ps->SetFloat("uvScale2", 50.0f);
-
-	ps->SetFloat("specularAdjust", 0.0f);
+	ps->SetFloat3(cameraPositionHandle, camera->GetTransform()->GetPosition());
 
 	ps->CopyAllBufferData();
 
 	// Set texture resources for the next draw
-	ps->SetShaderResourceView("blendMap", terrainBlendMapSRV.Get());
-	ps->SetShaderResourceView("texture0", terrainTexture0SRV.Get());
-	ps->SetShaderResourceView("texture1", terrainTexture1SRV.Get());
-	ps->SetShaderResourceView("texture2", terrainTexture2SRV.Get());
-	ps->SetShaderResourceView("normalMap0", terrainNormals0SRV.Get());
-	ps->SetShaderResourceView("normalMap1", terrainNormals1SRV.Get());
-	ps->SetShaderResourceView("normalMap2", terrainNormals2SRV.Get());
-	ps->SetSamplerState("samplerOptions", samplerOptions.Get());
-
-	vs->SetFloat4("colorTint", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
-	vs->SetMatrix4x4("world", transform.GetWorldMatrix());
-	vs->SetMatrix4x4("view", camera->GetView());
-	vs->SetMatrix4x4("proj", camera->GetProjection());
+	ps->SetShaderResourceView(blendMapHandle, terrainBlendMapSRV.Get());
+	ps->SetShaderResourceView(texture0Handle, terrainTexture0SRV.Get());
+	ps->SetShaderResourceView(texture1Handle, terrainTexture1SRV.Get());
+	ps->SetShaderResourceView(texture2Handle, terrainTexture2SRV.Get());
+	ps->SetShaderResourceView(normalMap0Handle, terrainNormals0SRV.Get());
+	ps->SetShaderResourceView(normalMap1Handle, terrainNormals1SRV.Get());
+	ps->SetShaderResourceView(normalMap2Handle, terrainNormals2SRV.Get());
+	ps->SetSamplerState(samplerOptionsHandle, samplerOptions.Get());
+
+	vs->SetMatrix4x4(worldHandle, transform.GetWorldMatrix());
+	vs->SetMatrix4x4(viewHandle, camera->GetView());
+	vs->SetMatrix4x4(projHandle, camera->GetProjection());
 
 	// Actually copy the data to the GPU
 	vs->CopyAllBufferData();
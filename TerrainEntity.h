@@ -44,5 +44,19 @@ private:
 
 	Mesh* mesh;
 	Transform transform;
+
+	// Shader handles for the data that changes each draw
+	SimpleVariableHandle cameraPositionHandle;
+	SimpleVariableHandle worldHandle;
+	SimpleVariableHandle viewHandle;
+	SimpleVariableHandle projHandle;
+	SimpleSRVHandle blendMapHandle;
+	SimpleSRVHandle texture0Handle;
+	SimpleSRVHandle texture1Handle;
+	SimpleSRVHandle texture2Handle;
+	SimpleSRVHandle normalMap0Handle;
+	SimpleSRVHandle normalMap1Handle;
+	SimpleSRVHandle normalMap2Handle;
+	SimpleSamplerHandle samplerOptionsHandle;
 };
 
@@ -14,7 +14,8 @@ TerrainMesh::TerrainMesh(
 	TerrainBitDepth bitDepth,
 	float yScale,
 	float xzScale,
-	float uvScale)
+	float uvScale,
+	MeshVertexFormat format)
 	: Mesh()
 {
 	unsigned int numVertices = heightmapWidth * heightmapHeight;
@@ -163,7 +164,7 @@ TerrainMesh::TerrainMesh(
 	}
 
 	// Create the buffers and clean up arrays
-	this->CreateBuffers(verts, numVertices, indices, numIndices, device);
+	this->CreateBuffers(verts, numVertices, indices, numIndices, device, format);
 	delete[] verts;
 	delete[] indices;
 }
@@ -20,7 +20,8 @@ public:
 		TerrainBitDepth bitDepth = BitDepth_8,
 		float yScale = 1.0f,
 		float xzScale = 1.0f,
-		float uvScale = 1.0f);
+		float uvScale = 1.0f,
+		MeshVertexFormat format = MESH_VERTEX_FULL);
 	~TerrainMesh();
 
 private:
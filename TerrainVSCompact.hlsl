@@ -0,0 +1,72 @@
+#include "VertexCompression.hlsli"
+
+// The variables defined in this cbuffer will pull their data from the 
+// constant buffer (ID3D11Buffer) bound to "vertex shader constant buffer slot 0"
+// It was bound using context->VSSetConstantBuffers() over in C++.
+cbuffer ExternalData : register(b0)
+{
+	float4 colorTint;
+	matrix world;
+	matrix view;
+	matrix proj;
+
+	// Undoes the mesh's position quantization
+	float3 positionOffset;
+	float3 positionScale;
+}
+
+// Same as TerrainVS, but reading a CompactVertex - the semantic
+// suffixes tell SimpleShader which packed formats to use
+struct VertexShaderInput
+{
+	float4 position		: POSITION_UNORM;
+	float2 uv			: TEXCOORD_HALF;
+	float2 normal		: NORMAL_SNORM;
+	float2 tangent		: TANGENT_SNORM;
+};
+
+// Struct representing the data we're sending down the pipeline
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;	// XYZW position (System Value Position)
+	float4 color		: COLOR;        // RGBA color
+	float2 uv			: TEXCOORD;
+	float3 normal		: NORMAL;
+	float3 tangent		: TANGENT;
+	float3 worldPos		: POSITION;
+};
+
+// --------------------------------------------------------
+// The entry point (main method) for our vertex shader
+// --------------------------------------------------------
+VertexToPixel main(VertexShaderInput input)
+{
+	// Set up output struct
+	VertexToPixel output;
+
+	// Unpack everything first
+	float3 position = DecodePosition(input.position.xyz, positionOffset, positionScale);
+	float3 normal = DecodeOctahedral(input.normal);
+	float3 tangent = DecodeOctahedral(input.tangent);
+
+	// Modifying the position using the provided transformation (world) matrix
+	matrix wvp = mul(proj, mul(view, world));
+	output.position = mul(wvp, float4(position, 1.0f));
+
+	// Calculate the final world position of the vertex
+	output.worldPos = mul(world, float4(position, 1.0f)).xyz;
+
+	// Modify the normal so its also in world space
+	output.normal = mul((float3x3)world, normal);
+	output.normal = normalize(output.normal);
+
+	// Modify the tangent much like the normal
+	output.tangent = mul((float3x3)world, tangent);
+	output.tangent = normalize(output.tangent);
+
+	// Tints the color before passing it through
+	output.color = colorTint;
+	output.uv = input.uv;
+
+	return output;
+}
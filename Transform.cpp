@@ -1,30 +1,39 @@
 #include "Transform.h"
 
+#include <algorithm>
+
 using namespace DirectX;
 
 Transform::Transform()
 {
-	// Start with an identity matrix and basic transform data
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
-	XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixIdentity());
+	// The slot starts out as an identity transform
+	system = &TransformSystem::GetInstance();
+	index = system->Allocate();
 
-	position = XMFLOAT3(0, 0, 0);
-	pitchYawRoll = XMFLOAT3(0, 0, 0);
-	scale = XMFLOAT3(1, 1, 1);
+	parent = 0;
+}
 
-	// No need to recalc yet
-	matricesDirty = false;
+Transform::~Transform()
+{
+	// Nothing can be left pointing at this slot once it's reused
+	DetachFromParent();
 
-	parent = 0;
+	// Children stay where they are in the world (SetParent
+	// takes each out of the list, hence the copy)
+	std::vector<Transform*> orphans(children);
+	for (auto child : orphans)
+		child->SetParent(0);
+
+	system->Free(index);
 }
 
 void Transform::MoveAbsolute(float x, float y, float z)
 {
+	XMFLOAT3 position = system->GetPosition(index);
 	position.x += x;
 	position.y += y;
 	position.z += z;
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	SetPosition(position);
 }
 
 void Transform::MoveRelative(float x, float y, float z)
@@ -32,90 +41,108 @@ void Transform::MoveRelative(float x, float y, float z)
 	// Create a direction vector from the params
 	// and a rotation quaternion
 	XMVECTOR movement = XMVectorSet(x, y, z, 0);
-	XMVECTOR rotQuat = XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
+	XMVECTOR rotQuat = XMLoadFloat4(&system->GetRotation(index));
 
 	// Rotate the movement by the quaternion
 	XMVECTOR dir = XMVector3Rotate(movement, rotQuat);
 
 	// Add and store, and invalidate the matrices
-	XMStoreFloat3(&position, XMLoadFloat3(&position) + dir);
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	XMFLOAT3 position;
+	XMStoreFloat3(&position, XMLoadFloat3(&system->GetPosition(index)) + dir);
+	SetPosition(position);
 }
 
+// Adds to the Euler angles, rather than rotating about the
+// local axes, so cameras can keep the horizon level
 void Transform::Rotate(float p, float y, float r)
 {
-	pitchYawRoll.x += p;
-	pitchYawRoll.y += y;
-	pitchYawRoll.z += r;
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	XMFLOAT3 pitchYawRoll = GetPitchYawRoll();
+	SetRotation(pitchYawRoll.x + p, pitchYawRoll.y + y, pitchYawRoll.z + r);
 }
 
 void Transform::Scale(float x, float y, float z)
 {
+	XMFLOAT3 scale = system->GetScale(index);
 	scale.x *= x;
 	scale.y *= y;
 	scale.z *= z;
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	SetScale(scale);
 }
 
 void Transform::SetPosition(float x, float y, float z)
 {
-	position.x = x;
-	position.y = y;
-	position.z = z;
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	SetPosition(XMFLOAT3(x, y, z));
 }
 
 void Transform::SetRotation(float p, float y, float r)
 {
-	pitchYawRoll.x = p;
-	pitchYawRoll.y = y;
-	pitchYawRoll.z = r;
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	XMFLOAT4 rotation;
+	XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(p, y, r));
+	SetRotation(rotation);
 }
 
 void Transform::SetRotationQuat(float x, float y, float z, float w)
 {
-	XMFLOAT3 euler = QuatToEuler(XMFLOAT4(x, y, z, w));
-	SetRotation(euler.x, euler.y, euler.z);
+	SetRotation(XMFLOAT4(x, y, z, w));
 }
 
 void Transform::SetScale(float x, float y, float z)
 {
-	scale.x = x;
-	scale.y = y;
-	scale.z = z;
-	matricesDirty = true;
-	MarkChildTransformsDirty();
+	SetScale(XMFLOAT3(x, y, z));
+}
+
+void Transform::SetPosition(const XMFLOAT3& position)
+{
+	system->SetPosition(index, position);
 }
 
-DirectX::XMFLOAT3 Transform::GetPosition() { return position; }
+void Transform::SetRotation(const XMFLOAT4& rotation)
+{
+	system->SetRotation(index, rotation);
+}
+
+void Transform::SetPose(const XMFLOAT3& position, const XMFLOAT4& rotation)
+{
+	system->SetPose(index, position, rotation);
+}
 
-DirectX::XMFLOAT3 Transform::GetPitchYawRoll() { return pitchYawRoll; }
+void Transform::SetScale(const XMFLOAT3& scale)
+{
+	system->SetScale(index, scale);
+}
+
+DirectX::XMFLOAT3 Transform::GetPosition() { return system->GetPosition(index); }
 
-DirectX::XMFLOAT3 Transform::GetScale() { return scale; }
+// Worked out from the quaternion each time, so only for
+// editing and the odd angle check
+DirectX::XMFLOAT3 Transform::GetPitchYawRoll() { return QuatToEuler(system->GetRotation(index)); }
 
+DirectX::XMFLOAT4 Transform::GetRotation() { return system->GetRotation(index); }
 
+DirectX::XMFLOAT3 Transform::GetScale() { return system->GetScale(index); }
+
+// Usually already up to date from the system's once-a-frame
+// batch update, unless something changed since
 DirectX::XMFLOAT4X4 Transform::GetWorldMatrix()
 {
-	UpdateMatrices();
-	return worldMatrix;
+	return system->GetWorldMatrix(index);
+}
+
+const NormalMatrix& Transform::GetNormalMatrix()
+{
+	return system->GetNormalMatrix(index);
 }
 
-DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix()
+bool Transform::HasUniformScale()
 {
-	UpdateMatrices();
-	return worldMatrix;
+	GetWorldMatrix();
+	return system->HasUniformScale(index);
 }
 
 void Transform::AddChild(Transform* child)
 {
-	if (child != 0 && IndexOfChild(child) == -1) {
+	// A child can't take its own ancestor (or itself) as a child
+	if (child != 0 && IndexOfChild(child) == -1 && !system->IsInSubtree(index, child->index)) {
 		// get matrices
 		XMFLOAT4X4 world = GetWorldMatrix();
 		XMMATRIX wm = XMLoadFloat4x4(&world);
@@ -131,9 +158,10 @@ void Transform::AddChild(Transform* child)
 		XMStoreFloat4x4(&relativeChildWorld, relcwm);
 		child->SetTransformsFromMatrix(relativeChildWorld);
 
+		child->DetachFromParent();
 		children.push_back(child);
 		child->parent = this;
-		MarkChildTransformsDirty();
+		system->SetParent(child->index, index);
 	}
 }
 
@@ -142,25 +170,32 @@ void Transform::RemoveChild(Transform* child)
 	int index = IndexOfChild(child);
 
 	if (index != -1) {
-		XMFLOAT4X4 childWorld = child->GetWorldMatrix();
-		child->SetTransformsFromMatrix(childWorld);
-
+		// SetParent keeps the child where it is in the world
 		children.erase(children.begin() + index);
 		child->SetParent(0);
-		MarkChildTransformsDirty();
 	}
 }
 
 void Transform::SetParent(Transform* newParent)
 {
+	// Parenting to itself or a descendant would make a loop, so
+	// that leaves everything as it was
+	if (newParent != 0 && system->IsInSubtree(newParent->index, index))
+		return;
+
+	// The world matrix under the old parent, before it changes
+	XMFLOAT4X4 world = GetWorldMatrix();
+
+	if (parent != newParent)
+		DetachFromParent();
 	parent = newParent;
+	system->SetParent(index, parent ? parent->index : TransformSystem::NoParent);
 
 	if (parent != 0 && parent->IndexOfChild(this) == -1) {
 		// get matrices
 		XMFLOAT4X4 pWorld = parent->GetWorldMatrix();
 		XMMATRIX pwm = XMLoadFloat4x4(&pWorld);
 
-		XMFLOAT4X4 world = GetWorldMatrix();
 		XMMATRIX wm = XMLoadFloat4x4(&world);
 
 		// "subtract" parent transforms from child transforms
@@ -172,10 +207,8 @@ void Transform::SetParent(Transform* newParent)
 		SetTransformsFromMatrix(relativeWorld);
 
 		parent->children.push_back(this);
-		parent->MarkChildTransformsDirty();
 	}
 	else if (parent == 0) {
-		XMFLOAT4X4 world = GetWorldMatrix();
 		SetTransformsFromMatrix(world);
 	}
 }
@@ -208,45 +241,15 @@ unsigned int Transform::GetChildCount()
 	return children.size();
 }
 
-void Transform::UpdateMatrices()
+void Transform::DetachFromParent()
 {
-	// Are the matrices out of date (dirty)?
-	if (matricesDirty)
-	{
-		// Create the three transformation pieces
-		XMMATRIX trans = XMMatrixTranslationFromVector(XMLoadFloat3(&position));
-		XMMATRIX rot = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&pitchYawRoll));
-		XMMATRIX sc = XMMatrixScalingFromVector(XMLoadFloat3(&scale));
-
-		// Combine and store the world
-		XMMATRIX wm = sc * rot * trans;
-
-		if (parent) {
-			XMFLOAT4X4 parentWorld = parent->GetWorldMatrix();
-			XMMATRIX pWorld = XMLoadFloat4x4(&parentWorld);
-
-			wm *= pWorld;
-		}
-
-		XMStoreFloat4x4(&worldMatrix, wm);
-
-		// Invert and transpose, too
-		XMStoreFloat4x4(&worldInverseTransposeMatrix, XMMatrixInverse(0, XMMatrixTranspose(wm)));
-
-		// All set
-		matricesDirty = false;
-
-		MarkChildTransformsDirty();
+	if (parent) {
+		int i = parent->IndexOfChild(this);
+		if (i != -1)
+			parent->children.erase(parent->children.begin() + i);
 	}
 }
 
-void Transform::MarkChildTransformsDirty()
-{
-	for (int i = 0; i < children.size(); i++) {
-		children[i]->matricesDirty = true;
-		children[i]->MarkChildTransformsDirty();
-	}
-}
 
 void Transform::SetTransformsFromMatrix(DirectX::XMFLOAT4X4 worldMatrix)
 {
@@ -255,15 +258,14 @@ void Transform::SetTransformsFromMatrix(DirectX::XMFLOAT4X4 worldMatrix)
 	XMVECTOR sc;
 	XMMatrixDecompose(&sc, &rot, &pos, XMLoadFloat4x4(&worldMatrix));
 
-	// convert to euler
-	XMFLOAT4 quat;
-	XMStoreFloat4(&quat, rot);
-	pitchYawRoll = QuatToEuler(quat);
-
+	XMFLOAT3 position;
+	XMFLOAT4 rotation;
+	XMFLOAT3 scale;
 	XMStoreFloat3(&position, pos);
+	XMStoreFloat4(&rotation, rot);
 	XMStoreFloat3(&scale, sc);
-
-	matricesDirty = true;
+	system->SetPose(index, position, rotation);
+	system->SetScale(index, scale);
 }
 
 DirectX::XMFLOAT3 Transform::QuatToEuler(DirectX::XMFLOAT4 quat)
@@ -274,8 +276,11 @@ DirectX::XMFLOAT3 Transform::QuatToEuler(DirectX::XMFLOAT4 quat)
 	XMFLOAT4X4 rot;
 	XMStoreFloat4x4(&rot, rMat);
 
-	// map values
-	float pitch = (float)asin(-rot._32);
+	// map values (rounding can push the sine just past 1)
+	float sinPitch = -rot._32;
+	if (sinPitch > 1.0f) sinPitch = 1.0f;
+	if (sinPitch < -1.0f) sinPitch = -1.0f;
+	float pitch = (float)asin(sinPitch);
 	float yaw = (float)atan2(rot._31, rot._33);
 	float roll = (float)atan2(rot._12, rot._22);
 
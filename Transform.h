@@ -3,10 +3,24 @@
 #include <DirectXMath.h>
 #include <vector>
 
+#include "TransformSystem.h"
+
+// --------------------------------------------------------
+// A handle to one transform's slot in the TransformSystem,
+// which holds the actual data and builds the matrices.  The
+// hierarchy is kept in both: the system keeps it flattened
+// for updates, while the parent and child pointers here are
+// for walking and editing it.
+// --------------------------------------------------------
 class Transform
 {
 public:
 	Transform();
+	~Transform();
+
+	// The slot belongs to this object, so there's no copying
+	Transform(const Transform&) = delete;
+	Transform& operator=(const Transform&) = delete;
 
 	void MoveAbsolute(float x, float y, float z);
 	void MoveRelative(float x, float y, float z);
@@ -16,13 +30,22 @@ public:
 	void SetPosition(float x, float y, float z);
 	void SetRotation(float p, float y, float r);
 	void SetRotationQuat(float x, float y, float z, float w);
+	void SetRotation(const DirectX::XMFLOAT4& rotation);
 	void SetScale(float x, float y, float z);
 
+	// Position and rotation together, as physics hands them over
+	void SetPose(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT4& rotation);
+
 	DirectX::XMFLOAT3 GetPosition();
 	DirectX::XMFLOAT3 GetPitchYawRoll();
+	DirectX::XMFLOAT4 GetRotation();
 	DirectX::XMFLOAT3 GetScale();
 	DirectX::XMFLOAT4X4 GetWorldMatrix();
-	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
+
+	// Inverse transpose of the world matrix's rotation and scale,
+	// for transforming normals
+	const NormalMatrix& GetNormalMatrix();
+	bool HasUniformScale();
 
 	// hierarchy methods
 	void AddChild(Transform* child);
@@ -36,25 +59,21 @@ public:
 	int IndexOfChild(Transform* child);
 	unsigned int GetChildCount();
 
+	static DirectX::XMFLOAT3 QuatToEuler(DirectX::XMFLOAT4 quat);
+
 private:
 	Transform* parent;
 	std::vector<Transform*> children;
 
-	// Raw transformation data
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT3 pitchYawRoll;
-	DirectX::XMFLOAT3 scale;
-
-	// World matrix and inverse transpose of the world matrix
-	bool matricesDirty;
-	DirectX::XMFLOAT4X4 worldMatrix;
-	DirectX::XMFLOAT4X4 worldInverseTransposeMatrix;
-
-	// Helper to update both matrices if necessary
-	void UpdateMatrices();
+	// Where the raw data and matrices live
+	TransformSystem* system;
+	unsigned int index;
 
-	void MarkChildTransformsDirty();
+	void SetPosition(const DirectX::XMFLOAT3& position);
+	void SetScale(const DirectX::XMFLOAT3& scale);
 
-	DirectX::XMFLOAT3 QuatToEuler(DirectX::XMFLOAT4 quat);
+	// Takes this transform out of its parent's list of children,
+	// without changing its parent pointer
+	void DetachFromParent();
 };
 
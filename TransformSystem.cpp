@@ -0,0 +1,487 @@
+#include "TransformSystem.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace DirectX;
+
+// Index of the lowest set bit, for walking the dirty bitset
+// a set bit at a time instead of a slot at a time
+static unsigned int LowestBit(uint64_t bits)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return (unsigned int)index;
+#elif defined(_MSC_VER)
+	// 32 bit builds only have the 32 bit scan
+	unsigned long index;
+	if (_BitScanForward(&index, (unsigned long)bits))
+		return (unsigned int)index;
+	_BitScanForward(&index, (unsigned long)(bits >> 32));
+	return (unsigned int)index + 32;
+#else
+	return (unsigned int)__builtin_ctzll(bits);
+#endif
+}
+
+// Copies the upper 3x3 of a matrix into a normal matrix
+static void StoreNormalMatrix(NormalMatrix* normal, FXMMATRIX m)
+{
+	for (int i = 0; i < 3; i++)
+		XMStoreFloat4(&normal->Rows[i], XMVectorSetW(m.r[i], 0));
+}
+
+// Scales within this fraction of each other count as the same
+static bool IsUniformScale(const XMFLOAT3& scale)
+{
+	float tolerance = 1e-5f * (fabsf(scale.x) + fabsf(scale.y) + fabsf(scale.z));
+	return fabsf(scale.x - scale.y) <= tolerance && fabsf(scale.y - scale.z) <= tolerance;
+}
+
+// --------------------------------------------------------
+// Puts one array's data where ReindexOrder moved each entry,
+// given where it was before.  Everything moving is at "from"
+// or later, both before and after.  Holes keep whatever was
+// there, as nothing reads them.
+// --------------------------------------------------------
+template <typename T>
+static void MoveData(std::vector<T>& data, const std::vector<unsigned int>& sources, unsigned int from)
+{
+	std::vector<T> old(data.begin() + from, data.end());
+	data.resize(from + sources.size());
+	for (size_t i = 0; i < sources.size(); i++) {
+		if (sources[i] != TransformSystem::NoSlot)
+			data[from + i] = old[sources[i] - from];
+	}
+}
+
+const unsigned int TransformSystem::NoParent;
+const unsigned int TransformSystem::NoSlot;
+
+TransformSystem::TransformSystem()
+{
+	holeCount = 0;
+	lastUpdateCount = 0;
+}
+
+TransformSystem& TransformSystem::GetInstance()
+{
+	static TransformSystem instance;
+	return instance;
+}
+
+unsigned int TransformSystem::Allocate()
+{
+	unsigned int index;
+	if (!freeSlots.empty()) {
+		index = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else {
+		index = (unsigned int)parents.size();
+		parents.push_back(NoParent);
+		orderPositions.push_back(NoSlot);
+		subtreeSizes.push_back(0);
+		movingDirty.push_back(0);
+	}
+
+	// New transforms go on the end, as roots
+	unsigned int position = (unsigned int)order.size();
+	order.push_back(index);
+	orderPositions[index] = position;
+	subtreeSizes[index] = 1;
+	parents[index] = NoParent;
+	if (position / 64 >= dirtyBits.size())
+		dirtyBits.push_back(0);
+
+	XMFLOAT4X4 world;
+	NormalMatrix normal;
+	XMStoreFloat4x4(&world, XMMatrixIdentity());
+	StoreNormalMatrix(&normal, XMMatrixIdentity());
+	positions.push_back(XMFLOAT3(0, 0, 0));
+	rotations.push_back(XMFLOAT4(0, 0, 0, 1));
+	scales.push_back(XMFLOAT3(1, 1, 1));
+	worldMatrices.push_back(world);
+	normalMatrices.push_back(normal);
+	uniformScales.push_back(1);
+	parentPositions.push_back(NoSlot);
+	ClearDirty(index);
+	return index;
+}
+
+void TransformSystem::Free(unsigned int index)
+{
+	// Leaves a hole, which still counts toward its old parents'
+	// subtree sizes until the holes are cleared out
+	ClearDirty(index);
+	order[orderPositions[index]] = NoSlot;
+	parentPositions[orderPositions[index]] = NoSlot;
+	orderPositions[index] = NoSlot;
+	parents[index] = NoParent;
+	freeSlots.push_back(index);
+
+	holeCount++;
+	if (holeCount > 64 && holeCount * 2 > order.size())
+		RemoveHoles();
+}
+
+void TransformSystem::SetPosition(unsigned int index, const XMFLOAT3& position)
+{
+	positions[orderPositions[index]] = position;
+	MarkDirty(index);
+}
+
+void TransformSystem::SetRotation(unsigned int index, const XMFLOAT4& rotation)
+{
+	rotations[orderPositions[index]] = rotation;
+	MarkDirty(index);
+}
+
+void TransformSystem::SetPose(unsigned int index, const XMFLOAT3& position, const XMFLOAT4& rotation)
+{
+	unsigned int p = orderPositions[index];
+	positions[p] = position;
+	rotations[p] = rotation;
+	MarkDirty(index);
+}
+
+void TransformSystem::SetScale(unsigned int index, const XMFLOAT3& scale)
+{
+	scales[orderPositions[index]] = scale;
+	MarkDirty(index);
+}
+
+// --------------------------------------------------------
+// A transform only ever goes clean after its parents do, and
+// whenever one is marked, so is everything under it.  So if
+// it's already dirty, its whole subtree is too, and there's
+// nothing to do - no matter how many times it changes in a
+// frame, or how deep the hierarchy under it is.
+// --------------------------------------------------------
+void TransformSystem::MarkDirty(unsigned int index)
+{
+	if (IsDirty(index))
+		return;
+
+	unsigned int begin = orderPositions[index];
+	SetDirtyRange(begin, begin + subtreeSizes[index]);
+}
+
+bool TransformSystem::IsDirty(unsigned int index)
+{
+	unsigned int position = orderPositions[index];
+	return (dirtyBits[position / 64] & (1ull << (position % 64))) != 0;
+}
+
+void TransformSystem::ClearDirty(unsigned int index)
+{
+	unsigned int position = orderPositions[index];
+	dirtyBits[position / 64] &= ~(1ull << (position % 64));
+}
+
+// Sets bits [begin, end) a word at a time
+void TransformSystem::SetDirtyRange(unsigned int begin, unsigned int end)
+{
+	while (begin < end) {
+		unsigned int word = begin / 64;
+		unsigned int first = begin % 64;
+		unsigned int count = end - begin < 64 - first ? end - begin : 64 - first;
+
+		uint64_t mask = count == 64 ? ~0ull : ((1ull << count) - 1) << first;
+		dirtyBits[word] |= mask;
+		begin += count;
+	}
+}
+
+// --------------------------------------------------------
+// Cuts the subtree out of the order and puts it back after
+// the new parent's last descendant.  Everything between the
+// two spots shifts, so this is linear in the number of
+// transforms - fine for reparenting, which is rare.
+// --------------------------------------------------------
+bool TransformSystem::SetParent(unsigned int index, unsigned int parent)
+{
+	if (parent != NoParent && IsInSubtree(parent, index))
+		return false;
+
+	unsigned int begin = orderPositions[index];
+	unsigned int size = subtreeSizes[index];
+	unsigned int parentPosition = parent == NoParent ? NoSlot : orderPositions[parent];
+
+	unsigned int from = parentPosition < begin ? parentPosition : begin;
+	SaveMovingDirty(from);
+
+	// Old parents lose the subtree, new ones gain it
+	for (unsigned int a = parents[index]; a != NoParent; a = parents[a])
+		subtreeSizes[a] -= size;
+	for (unsigned int a = parent; a != NoParent; a = parents[a])
+		subtreeSizes[a] += size;
+	parents[index] = parent;
+
+	std::vector<unsigned int> subtree(order.begin() + begin, order.begin() + begin + size);
+	order.erase(order.begin() + begin, order.begin() + begin + size);
+
+	unsigned int insertAt = (unsigned int)order.size();
+	if (parent != NoParent) {
+		if (parentPosition > begin)
+			parentPosition -= size;
+
+		// The size already includes the subtree going in
+		insertAt = parentPosition + subtreeSizes[parent] - size;
+	}
+	order.insert(order.begin() + insertAt, subtree.begin(), subtree.end());
+
+	ReindexOrder(from);
+	MarkDirty(index);
+	return true;
+}
+
+// A subtree is one run of the order, so this is just a range check
+bool TransformSystem::IsInSubtree(unsigned int index, unsigned int root)
+{
+	unsigned int position = orderPositions[index];
+	unsigned int begin = orderPositions[root];
+	return position >= begin && position < begin + subtreeSizes[root];
+}
+
+void TransformSystem::SaveMovingDirty(unsigned int from)
+{
+	for (unsigned int p = from; p < order.size(); p++) {
+		if (order[p] != NoSlot)
+			movingDirty[order[p]] = (dirtyBits[p / 64] >> (p % 64)) & 1;
+	}
+}
+
+void TransformSystem::ReindexOrder(unsigned int from)
+{
+	// Where each entry's data was, before its position changes
+	std::vector<unsigned int> sources(order.size() - from);
+
+	dirtyBits.resize((order.size() + 63) / 64);
+	for (unsigned int p = from; p < order.size(); p++) {
+		uint64_t bit = 1ull << (p % 64);
+		dirtyBits[p / 64] &= ~bit;
+
+		unsigned int index = order[p];
+		sources[p - from] = index == NoSlot ? NoSlot : orderPositions[index];
+		if (index == NoSlot)
+			continue;
+
+		orderPositions[index] = p;
+		if (movingDirty[index])
+			dirtyBits[p / 64] |= bit;
+	}
+
+	// Nothing past the end should ever read as dirty
+	if (order.size() % 64 != 0)
+		dirtyBits.back() &= (1ull << (order.size() % 64)) - 1;
+
+	MoveData(positions, sources, from);
+	MoveData(rotations, sources, from);
+	MoveData(scales, sources, from);
+	MoveData(worldMatrices, sources, from);
+	MoveData(normalMatrices, sources, from);
+	MoveData(uniformScales, sources, from);
+
+	// Parents come first, so theirs are already reindexed
+	parentPositions.resize(order.size());
+	for (unsigned int p = from; p < order.size(); p++) {
+		unsigned int index = order[p];
+		if (index == NoSlot || parents[index] == NoParent)
+			parentPositions[p] = NoSlot;
+		else
+			parentPositions[p] = orderPositions[parents[index]];
+	}
+}
+
+// --------------------------------------------------------
+// Squeezes the holes out of the order.  A subtree's holes are
+// all inside its range, so it shrinks by however many holes
+// fall between its start and end.
+// --------------------------------------------------------
+void TransformSystem::RemoveHoles()
+{
+	std::vector<unsigned int> holesBefore(order.size() + 1);
+	holesBefore[0] = 0;
+	for (size_t p = 0; p < order.size(); p++)
+		holesBefore[p + 1] = holesBefore[p] + (order[p] == NoSlot ? 1 : 0);
+
+	SaveMovingDirty(0);
+	for (size_t p = 0; p < order.size(); p++) {
+		unsigned int index = order[p];
+		if (index != NoSlot)
+			subtreeSizes[index] -= holesBefore[p + subtreeSizes[index]] - holesBefore[p];
+	}
+
+	size_t kept = 0;
+	for (size_t p = 0; p < order.size(); p++) {
+		if (order[p] != NoSlot)
+			order[kept++] = order[p];
+	}
+	order.resize(kept);
+	holeCount = 0;
+
+	ReindexOrder(0);
+}
+
+const XMFLOAT4X4& TransformSystem::GetWorldMatrix(unsigned int index)
+{
+	if (IsDirty(index))
+		Recompute(index);
+	return worldMatrices[orderPositions[index]];
+}
+
+const NormalMatrix& TransformSystem::GetNormalMatrix(unsigned int index)
+{
+	if (IsDirty(index))
+		Recompute(index);
+	return normalMatrices[orderPositions[index]];
+}
+
+// Brings one transform up to date on its own, along with any
+// dirty parents first
+void TransformSystem::Recompute(unsigned int index)
+{
+	unsigned int parent = parents[index];
+	if (parent != NoParent && IsDirty(parent))
+		Recompute(parent);
+
+	BuildMatrices(orderPositions[index]);
+	ClearDirty(index);
+}
+
+// --------------------------------------------------------
+// Builds the matrices at one position from its raw data and
+// its parent's world matrix, which has to be up to date.
+//
+// With uniform scale s, the upper 3x3 is s times a rotation R,
+// and its inverse transpose is R / s - which is the 3x3 itself
+// divided by s squared, the squared length of any of its rows.
+// Only other transforms need the general inverse, done here
+// as the rows' cross products over the determinant.
+// --------------------------------------------------------
+void TransformSystem::BuildMatrices(unsigned int position)
+{
+	XMMATRIX world =
+		XMMatrixScalingFromVector(XMLoadFloat3(&scales[position])) *
+		XMMatrixRotationQuaternion(XMLoadFloat4(&rotations[position])) *
+		XMMatrixTranslationFromVector(XMLoadFloat3(&positions[position]));
+
+	// A uniform scale under a non-uniform parent can still skew,
+	// so it's only uniform if the parent is too
+	bool uniform = IsUniformScale(scales[position]);
+	unsigned int parentPosition = parentPositions[position];
+	if (parentPosition != NoSlot) {
+		world *= XMLoadFloat4x4(&worldMatrices[parentPosition]);
+		uniform = uniform && uniformScales[parentPosition];
+	}
+
+	XMStoreFloat4x4(&worldMatrices[position], world);
+	uniformScales[position] = uniform ? 1 : 0;
+
+	XMMATRIX normal;
+	if (uniform) {
+		XMVECTOR inverseScaleSquared = XMVectorReciprocal(XMVector3Dot(world.r[0], world.r[0]));
+		normal.r[0] = world.r[0] * inverseScaleSquared;
+		normal.r[1] = world.r[1] * inverseScaleSquared;
+		normal.r[2] = world.r[2] * inverseScaleSquared;
+	}
+	else {
+		XMVECTOR cross0 = XMVector3Cross(world.r[1], world.r[2]);
+		XMVECTOR cross1 = XMVector3Cross(world.r[2], world.r[0]);
+		XMVECTOR cross2 = XMVector3Cross(world.r[0], world.r[1]);
+		XMVECTOR inverseDeterminant = XMVectorReciprocal(XMVector3Dot(world.r[0], cross0));
+		normal.r[0] = cross0 * inverseDeterminant;
+		normal.r[1] = cross1 * inverseDeterminant;
+		normal.r[2] = cross2 * inverseDeterminant;
+	}
+	StoreNormalMatrix(&normalMatrices[position], normal);
+}
+
+// --------------------------------------------------------
+// One pass over the dirty bits a run at a time.  The bits and
+// the data are both in depth first order, so each run reads
+// and writes every array front to back, and each parent is
+// done before its children - no dirty checks or lookups
+// through the slots needed.
+// --------------------------------------------------------
+void TransformSystem::UpdateDirty()
+{
+	unsigned int count = 0;
+	for (size_t word = 0; word < dirtyBits.size(); word++) {
+		uint64_t bits = dirtyBits[word];
+		while (bits) {
+			// From the lowest set bit up to the next clear one
+			unsigned int first = LowestBit(bits);
+			uint64_t clear = ~(bits >> first);
+			unsigned int length = clear ? LowestBit(clear) : 64;
+			bits = first + length == 64 ? 0 : bits & ~(((1ull << length) - 1) << first);
+
+			unsigned int begin = (unsigned int)word * 64 + first;
+			for (unsigned int p = begin; p < begin + length; p++) {
+				// Holes can be caught up in a dirty subtree
+				if (order[p] != NoSlot) {
+					BuildMatrices(p);
+					count++;
+				}
+			}
+		}
+		dirtyBits[word] = 0;
+	}
+
+	lastUpdateCount = count;
+}
+
+float TransformSystem::Benchmark(unsigned int transformCount, unsigned int iterations, bool batched)
+{
+	TransformSystem system;
+	std::vector<unsigned int> indices(transformCount);
+	for (unsigned int i = 0; i < transformCount; i++) {
+		indices[i] = system.Allocate();
+		system.SetPosition(indices[i], XMFLOAT3((float)(i % 100), (float)(i / 100 % 100), (float)(i / 10000)));
+		XMFLOAT4 rotation;
+		XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(i * 0.1f, i * 0.2f, i * 0.3f));
+		system.SetRotation(indices[i], rotation);
+
+		// every fourth one hangs off the one before it
+		if (i % 4 == 3)
+			system.SetParent(indices[i], indices[i - 1]);
+	}
+	system.UpdateDirty();
+
+	// The order entities ask for their matrices has nothing to
+	// do with where their data lives, so shuffle it
+	std::vector<unsigned int> order(indices);
+	srand(0);
+	for (unsigned int i = transformCount; i > 1; i--) {
+		unsigned int j = (unsigned int)rand() % i;
+		unsigned int swap = order[i - 1];
+		order[i - 1] = order[j];
+		order[j] = swap;
+	}
+
+	float totalMilliseconds = 0;
+	for (unsigned int it = 0; it < iterations; it++) {
+		for (unsigned int i = 0; i < transformCount; i++)
+			system.SetPosition(indices[i], XMFLOAT3((float)it, (float)i, 0));
+
+		auto start = std::chrono::high_resolution_clock::now();
+		if (batched) {
+			system.UpdateDirty();
+		}
+		else {
+			for (auto index : order)
+				system.GetWorldMatrix(index);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		totalMilliseconds += std::chrono::duration<float, std::milli>(end - start).count();
+	}
+
+	return totalMilliseconds / iterations;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <stdint.h>
+#include <vector>
+
+// --------------------------------------------------------
+// The inverse transpose of a world matrix's upper 3x3, which
+// is all normals and tangents need.  Each row is padded to a
+// float4, matching a row_major float3x4 in a constant buffer.
+// --------------------------------------------------------
+struct NormalMatrix
+{
+	DirectX::XMFLOAT4 Rows[3];
+};
+
+// --------------------------------------------------------
+// Owns the data behind every Transform, stored as parallel
+// arrays (one per field), so a pass over one field walks
+// memory in order instead of hopping between entities.
+// Rotations are unit quaternions, which is what physics hands
+// over and what the matrices are built from, so there's no
+// trip through Euler angles.
+//
+// The hierarchy is flattened into one array in depth first
+// order, so every transform comes after its parent and has
+// its whole subtree in the entries right after it.  The data
+// arrays and dirty bits are laid out in that order too (a
+// transform's slot is just a handle to its position), so
+// marking a subtree is setting a run of bits (skipped entirely
+// if the transform is already dirty, as then so is everything
+// under it), and UpdateDirty goes through each run of dirty
+// entries front to back, reading and writing every array in
+// order.  Parents always come first, so by the time a run
+// reaches an entry its parent's matrix is already final.
+// Normal matrices skip the inverse entirely when the world
+// matrix has uniform scale (rigid transforms included).
+// Anything that needs a matrix sooner (like reparenting) can
+// still get it on demand, along with any dirty parents.
+//
+// Only depends on DirectXMath, so it can be benchmarked
+// without a device or a window.
+// --------------------------------------------------------
+class TransformSystem
+{
+public:
+	static const unsigned int NoParent = 0xFFFFFFFF;
+	static const unsigned int NoSlot = 0xFFFFFFFF;
+
+	TransformSystem();
+
+	// The system every Transform lives in
+	static TransformSystem& GetInstance();
+
+	// Slots are reused once freed, starting out as an identity
+	// transform with no parent.  Anything parented to a slot has
+	// to be moved off it before it's freed.
+	unsigned int Allocate();
+	void Free(unsigned int index);
+
+	const DirectX::XMFLOAT3& GetPosition(unsigned int index) { return positions[orderPositions[index]]; }
+	const DirectX::XMFLOAT4& GetRotation(unsigned int index) { return rotations[orderPositions[index]]; }
+	const DirectX::XMFLOAT3& GetScale(unsigned int index) { return scales[orderPositions[index]]; }
+
+	// Each of these marks the transform and its subtree dirty
+	void SetPosition(unsigned int index, const DirectX::XMFLOAT3& position);
+	void SetRotation(unsigned int index, const DirectX::XMFLOAT4& rotation);
+	void SetPose(unsigned int index, const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT4& rotation);
+	void SetScale(unsigned int index, const DirectX::XMFLOAT3& scale);
+	void MarkDirty(unsigned int index);
+	bool IsDirty(unsigned int index);
+
+	// Moves the transform's whole subtree to the end of the new
+	// parent's (or the end of the array, with NoParent).  Asking
+	// to parent a transform to itself or something under it
+	// does nothing and returns false.
+	bool SetParent(unsigned int index, unsigned int parent);
+	bool IsInSubtree(unsigned int index, unsigned int root);
+	unsigned int GetParent(unsigned int index) { return parents[index]; }
+
+	// Brings just this transform (and dirty parents) up to date
+	const DirectX::XMFLOAT4X4& GetWorldMatrix(unsigned int index);
+	const NormalMatrix& GetNormalMatrix(unsigned int index);
+
+	// Whether the world matrix is rotation, translation and the
+	// same scale on every axis, as of its last update
+	bool HasUniformScale(unsigned int index) { return uniformScales[orderPositions[index]] != 0; }
+
+	// Recomputes everything dirty, once a frame
+	void UpdateDirty();
+
+	unsigned int GetCount() { return (unsigned int)parents.size() - (unsigned int)freeSlots.size(); }
+	unsigned int GetLastUpdateCount() { return lastUpdateCount; }
+
+	// Times updating transformCount dirty transforms (a quarter
+	// of them children) through UpdateDirty when batched, or one
+	// at a time in a scattered order the way lazy per-object
+	// updates happen, returning milliseconds per update
+	static float Benchmark(unsigned int transformCount, unsigned int iterations, bool batched);
+
+private:
+	// By position in the order, and moved along with it
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<DirectX::XMFLOAT4> rotations;
+	std::vector<DirectX::XMFLOAT3> scales;
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+	std::vector<NormalMatrix> normalMatrices;
+	std::vector<unsigned char> uniformScales;
+	std::vector<unsigned int> parentPositions;
+
+	// By slot
+	std::vector<unsigned int> parents;
+
+	// Where each slot is in the flattened hierarchy, and how many
+	// entries its subtree takes there (itself included)
+	std::vector<unsigned int> orderPositions;
+	std::vector<unsigned int> subtreeSizes;
+
+	// Slots in depth first order.  Freed slots leave a NoSlot
+	// hole, so nothing has to shift, until holes are half of it.
+	std::vector<unsigned int> order;
+	unsigned int holeCount;
+
+	// One bit per entry in the order
+	std::vector<uint64_t> dirtyBits;
+
+	std::vector<unsigned int> freeSlots;
+
+	// Which slots were dirty while entries move around, by slot
+	std::vector<unsigned char> movingDirty;
+	unsigned int lastUpdateCount;
+
+	void SetDirtyRange(unsigned int begin, unsigned int end);
+	void ClearDirty(unsigned int index);
+	void Recompute(unsigned int index);
+
+	// Builds the matrices at one position, from a parent that's
+	// already up to date
+	void BuildMatrices(unsigned int position);
+
+	// Before and after moving entries from position "from" on,
+	// carrying their data, dirty bits and positions along
+	void SaveMovingDirty(unsigned int from);
+	void ReindexOrder(unsigned int from);
+	void RemoveHoles();
+};
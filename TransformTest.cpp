@@ -0,0 +1,214 @@
+#include "SelfTest.h"
+#include "Transform.h"
+#include "TransformSystem.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+using namespace DirectX;
+
+static bool NearlyEqual(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+	return fabsf(a.x - b.x) < 1e-4f && fabsf(a.y - b.y) < 1e-4f && fabsf(a.z - b.z) < 1e-4f;
+}
+
+static XMFLOAT3 WorldPosition(Transform& transform)
+{
+	XMFLOAT4X4 world = transform.GetWorldMatrix();
+	return XMFLOAT3(world._41, world._42, world._43);
+}
+
+// --------------------------------------------------------
+// Parenting something to itself or its own descendant has to
+// leave the Transform's pointers, the system's flattened
+// hierarchy and every world matrix exactly as they were
+// --------------------------------------------------------
+static void CycleTest()
+{
+	Transform a, b, c;
+	a.SetPosition(1, 2, 3);
+	b.SetPosition(4, 0, 0);
+	c.SetPosition(0, 5, 0);
+	a.Rotate(0, 0.5f, 0);
+	b.SetParent(&a);
+	c.SetParent(&b);
+
+	XMFLOAT3 aWorld = WorldPosition(a);
+	XMFLOAT3 cWorld = WorldPosition(c);
+	XMFLOAT3 aLocal = a.GetPosition();
+
+	// Each way in: SetParent on the ancestor, AddChild on the
+	// descendant, and both pointed at the transform itself
+	a.SetParent(&c);
+	c.AddChild(&a);
+	a.SetParent(&a);
+	a.AddChild(&a);
+	b.SetParent(&c);
+
+	SELF_TEST_CHECK(a.GetParent() == 0);
+	SELF_TEST_CHECK(b.GetParent() == &a);
+	SELF_TEST_CHECK(c.GetParent() == &b);
+	SELF_TEST_CHECK(a.GetChildCount() == 1 && a.GetChild(0) == &b);
+	SELF_TEST_CHECK(b.GetChildCount() == 1 && b.GetChild(0) == &c);
+	SELF_TEST_CHECK(c.GetChildCount() == 0);
+	SELF_TEST_CHECK(NearlyEqual(a.GetPosition(), aLocal));
+	SELF_TEST_CHECK(NearlyEqual(WorldPosition(a), aWorld));
+	SELF_TEST_CHECK(NearlyEqual(WorldPosition(c), cWorld));
+
+	// A legal move afterwards still works, and keeps c in place
+	c.SetParent(&a);
+	SELF_TEST_CHECK(c.GetParent() == &a);
+	SELF_TEST_CHECK(a.GetChildCount() == 2 && b.GetChildCount() == 0);
+	SELF_TEST_CHECK(NearlyEqual(WorldPosition(c), cWorld));
+}
+
+// The same rules straight on the system, which says whether it moved anything
+static void SystemCycleTest()
+{
+	TransformSystem system;
+	unsigned int a = system.Allocate();
+	unsigned int b = system.Allocate();
+	unsigned int c = system.Allocate();
+
+	SELF_TEST_CHECK(system.SetParent(b, a));
+	SELF_TEST_CHECK(system.SetParent(c, b));
+	SELF_TEST_CHECK(system.IsInSubtree(c, a) && system.IsInSubtree(a, a));
+	SELF_TEST_CHECK(!system.IsInSubtree(a, c));
+
+	SELF_TEST_CHECK(!system.SetParent(a, c));
+	SELF_TEST_CHECK(!system.SetParent(a, a));
+	SELF_TEST_CHECK(system.GetParent(a) == TransformSystem::NoParent);
+	SELF_TEST_CHECK(system.GetParent(c) == b);
+
+	SELF_TEST_CHECK(system.SetParent(c, TransformSystem::NoParent));
+	SELF_TEST_CHECK(system.SetParent(a, c));
+	SELF_TEST_CHECK(system.GetParent(a) == c);
+}
+
+// Normal matrices skip the inverse where they can, so they're
+// compared with the full inverse, relative to each row's size
+// (as scales vary a lot).  Both float paths measure under
+// 1e-5, even four levels deep.
+static const double normalMatrixTolerance = 1e-4;
+
+static double NormalMatrixError(TransformSystem& system, unsigned int index)
+{
+	XMFLOAT4X4 expected;
+	XMStoreFloat4x4(&expected, XMMatrixInverse(0, XMMatrixTranspose(XMLoadFloat4x4(&system.GetWorldMatrix(index)))));
+
+	const NormalMatrix& normal = system.GetNormalMatrix(index);
+	double largest = 0;
+	for (int r = 0; r < 3; r++) {
+		double rowLength = sqrt(
+			(double)expected.m[r][0] * expected.m[r][0] +
+			(double)expected.m[r][1] * expected.m[r][1] +
+			(double)expected.m[r][2] * expected.m[r][2]);
+		double difference =
+			fabs((double)normal.Rows[r].x - expected.m[r][0]) +
+			fabs((double)normal.Rows[r].y - expected.m[r][1]) +
+			fabs((double)normal.Rows[r].z - expected.m[r][2]);
+		if (difference / rowLength > largest)
+			largest = difference / rowLength;
+	}
+	return largest;
+}
+
+static float RandomFloat(float low, float high)
+{
+	return low + (high - low) * rand() / (float)RAND_MAX;
+}
+
+static XMFLOAT4 RandomRotation()
+{
+	XMFLOAT4 rotation;
+	XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(RandomFloat(-3, 3), RandomFloat(-3, 3), RandomFloat(-3, 3)));
+	return rotation;
+}
+
+// --------------------------------------------------------
+// Random transforms in chains of four, each with a uniform or
+// non-uniform scale at random, so both paths get covered at
+// the root and under every kind of parent - including uniform
+// under non-uniform, which skews and needs the full inverse
+// --------------------------------------------------------
+static void NormalMatrixTest()
+{
+	TransformSystem system;
+	const unsigned int count = 4000;
+	unsigned int indices[count];
+	bool uniform[count];
+	srand(1);
+
+	for (unsigned int i = 0; i < count; i++) {
+		indices[i] = system.Allocate();
+		system.SetPose(indices[i], XMFLOAT3(RandomFloat(-50, 50), RandomFloat(-50, 50), RandomFloat(-50, 50)), RandomRotation());
+
+		uniform[i] = rand() % 2 == 0;
+		float s = RandomFloat(0.25f, 4);
+		if (uniform[i])
+			system.SetScale(indices[i], XMFLOAT3(s, s, s));
+		else
+			system.SetScale(indices[i], XMFLOAT3(s, RandomFloat(0.25f, 4), RandomFloat(0.25f, 4)));
+
+		if (i % 4 != 0)
+			system.SetParent(indices[i], indices[i - 1]);
+	}
+	system.UpdateDirty();
+
+	// The largest error for each path, so a failure says which
+	double fastPath = 0, rootInverse = 0, childInverse = 0;
+	unsigned int skewedChildren = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		bool child = i % 4 != 0;
+		bool expectUniform = uniform[i] && (!child || system.HasUniformScale(indices[i - 1]));
+		SELF_TEST_CHECK(system.HasUniformScale(indices[i]) == expectUniform);
+		if (uniform[i] && !expectUniform)
+			skewedChildren++;
+
+		double error = NormalMatrixError(system, indices[i]);
+		double* largest = expectUniform ? &fastPath : child ? &childInverse : &rootInverse;
+		if (error > *largest)
+			*largest = error;
+	}
+
+	SELF_TEST_CHECK(skewedChildren > 0);
+	SELF_TEST_CHECK_AT_MOST(fastPath, normalMatrixTolerance);
+	SELF_TEST_CHECK_AT_MOST(rootInverse, normalMatrixTolerance);
+	SELF_TEST_CHECK_AT_MOST(childInverse, normalMatrixTolerance);
+}
+
+// --------------------------------------------------------
+// A uniform parent keeps a uniform child on the fast path, and
+// changing the parent to non-uniform later has to move the
+// child off it when the subtree updates
+// --------------------------------------------------------
+static void NormalMatrixParentChangeTest()
+{
+	TransformSystem system;
+	unsigned int parent = system.Allocate();
+	unsigned int child = system.Allocate();
+	system.SetPose(parent, XMFLOAT3(1, 2, 3), RandomRotation());
+	system.SetScale(parent, XMFLOAT3(2, 2, 2));
+	system.SetPose(child, XMFLOAT3(0, 4, 0), RandomRotation());
+	system.SetScale(child, XMFLOAT3(0.5f, 0.5f, 0.5f));
+	system.SetParent(child, parent);
+	system.UpdateDirty();
+
+	SELF_TEST_CHECK(system.HasUniformScale(child));
+	SELF_TEST_CHECK_AT_MOST(NormalMatrixError(system, child), normalMatrixTolerance);
+
+	system.SetScale(parent, XMFLOAT3(1, 3, 0.5f));
+	system.UpdateDirty();
+
+	SELF_TEST_CHECK(!system.HasUniformScale(parent) && !system.HasUniformScale(child));
+	SELF_TEST_CHECK_AT_MOST(NormalMatrixError(system, parent), normalMatrixTolerance);
+	SELF_TEST_CHECK_AT_MOST(NormalMatrixError(system, child), normalMatrixTolerance);
+}
+
+void TransformTest()
+{
+	CycleTest();
+	SystemCycleTest();
+	NormalMatrixTest();
+	NormalMatrixParentChangeTest();
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <stdint.h>
 
 // --------------------------------------------------------
 // A custom vertex definition
@@ -13,4 +14,20 @@ struct Vertex
 	DirectX::XMFLOAT2 UV;			// Texture mapping
 	DirectX::XMFLOAT3 Normal;		// Lighting
 	DirectX::XMFLOAT3 Tangent;		// Normal mapping
-};
\ No newline at end of file
+};
+// --------------------------------------------------------
+// Packed alternative to Vertex, 20 bytes instead of 44:
+//  - Position: UNORM16 within the mesh's bounds (w unused)
+//  - UV: half floats, so tiling UVs past 1 still work
+//  - Normal, Tangent: octahedral encoded SNORM16 pairs
+//
+// Shaders read it with the packed semantic suffixes (see
+// SimpleVertexShader) and decode with VertexCompression.hlsli
+// --------------------------------------------------------
+struct CompactVertex
+{
+	uint16_t Position[4];
+	uint16_t UV[2];
+	int16_t Normal[2];
+	int16_t Tangent[2];
+};
@@ -0,0 +1,144 @@
+#include "VertexCompression.h"
+
+#include <math.h>
+#include <string.h>
+
+uint16_t VertexCompression::FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+	int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	// NaN stays NaN, infinity and overflow become infinity
+	if (((bits >> 23) & 0xFF) == 0xFF)
+		return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+	if (exponent >= 31)
+		return sign | 0x7C00;
+
+	// Too small even for a denormal
+	if (exponent < -10)
+		return sign;
+
+	// Denormal - shift the implicit one in, then round
+	if (exponent <= 0) {
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+			half++;
+		return sign | (uint16_t)half;
+	}
+
+	// Normal - round to nearest even, which may carry into the exponent
+	uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1FFF;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+		half++;
+	return sign | (uint16_t)half;
+}
+
+float VertexCompression::HalfToFloat(uint16_t half)
+{
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+
+	uint32_t bits;
+	if (exponent == 0x1F) {
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else if (exponent != 0) {
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+	else if (mantissa == 0) {
+		bits = sign;
+	}
+	else {
+		// Denormal - the value is just mantissa * 2^-24
+		float value = (float)mantissa / 16777216.0f;
+		return sign ? -value : value;
+	}
+
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static int16_t FloatToSnorm16(float value)
+{
+	if (value > 1.0f) value = 1.0f;
+	if (value < -1.0f) value = -1.0f;
+	return (int16_t)(value * 32767.0f + (value >= 0 ? 0.5f : -0.5f));
+}
+
+// Same as the input assembler - both -32768 and -32767 are -1
+static float Snorm16ToFloat(int16_t value)
+{
+	float f = value / 32767.0f;
+	return f < -1.0f ? -1.0f : f;
+}
+
+// --------------------------------------------------------
+// Projects the vector onto the octahedron |x|+|y|+|z| = 1,
+// then folds the lower half over the diagonals so the whole
+// thing flattens into the [-1, 1] square
+// --------------------------------------------------------
+void VertexCompression::EncodeOctahedral(const float vector[3], int16_t encoded[2])
+{
+	float length = fabsf(vector[0]) + fabsf(vector[1]) + fabsf(vector[2]);
+	if (length <= 0) {
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+
+	float x = vector[0] / length;
+	float y = vector[1] / length;
+	if (vector[2] < 0) {
+		float foldedX = (1.0f - fabsf(y)) * (x >= 0 ? 1.0f : -1.0f);
+		float foldedY = (1.0f - fabsf(x)) * (y >= 0 ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	encoded[0] = FloatToSnorm16(x);
+	encoded[1] = FloatToSnorm16(y);
+}
+
+void VertexCompression::DecodeOctahedral(const int16_t encoded[2], float vector[3])
+{
+	float x = Snorm16ToFloat(encoded[0]);
+	float y = Snorm16ToFloat(encoded[1]);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	// Unfold the lower half
+	float t = z < 0 ? -z : 0;
+	x += x >= 0 ? -t : t;
+	y += y >= 0 ? -t : t;
+
+	float length = sqrtf(x * x + y * y + z * z);
+	vector[0] = x / length;
+	vector[1] = y / length;
+	vector[2] = z / length;
+}
+
+uint16_t VertexCompression::QuantizeUnorm16(float value, float min, float size)
+{
+	if (size <= 0)
+		return 0;
+
+	float normalized = (value - min) / size;
+	if (normalized < 0) normalized = 0;
+	if (normalized > 1) normalized = 1;
+	return (uint16_t)(normalized * 65535.0f + 0.5f);
+}
+
+float VertexCompression::DequantizeUnorm16(uint16_t quantized, float min, float size)
+{
+	return min + quantized / 65535.0f * size;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+// --------------------------------------------------------
+// Encoders (and matching decoders, for checking error and
+// for CPU side use) behind CompactVertex.  The decoders do
+// exactly what the input assembler and VertexCompression.hlsli
+// do on the GPU, so round trip error here is the real error.
+//
+// Worst case error, each well under what's visible:
+//  - Half UVs: 1/2048 of the value (about 0.0005 near 1.0)
+//  - Octahedral 16:16 unit vectors: about 0.04 degrees
+//  - UNORM16 positions: half a step, 1/131070 of the bounds
+// --------------------------------------------------------
+class VertexCompression
+{
+public:
+	// IEEE half precision, rounded to nearest, with overflow
+	// going to infinity and tiny values to (signed) zero
+	static uint16_t FloatToHalf(float value);
+	static float HalfToFloat(uint16_t half);
+
+	// Unit vector to two SNORM16 values on the octahedron
+	static void EncodeOctahedral(const float vector[3], int16_t encoded[2]);
+	static void DecodeOctahedral(const int16_t encoded[2], float vector[3]);
+
+	// Position within [min, min + size] as UNORM16
+	static uint16_t QuantizeUnorm16(float value, float min, float size);
+	static float DequantizeUnorm16(uint16_t quantized, float min, float size);
+};
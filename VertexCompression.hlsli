@@ -0,0 +1,26 @@
+// Include guard
+#ifndef _VERTEX_COMPRESSION_HLSL
+#define _VERTEX_COMPRESSION_HLSL
+
+// Decoders for CompactVertex (see Vertex.h).  The input assembler
+// already turns the UNORM16, SNORM16 and half components into
+// floats, so all that's left is undoing the encodings themselves.
+
+// Octahedral [-1, 1] pair back to a unit vector
+float3 DecodeOctahedral(float2 encoded)
+{
+	float3 n = float3(encoded.xy, 1.0f - abs(encoded.x) - abs(encoded.y));
+
+	// Unfold the lower half
+	float t = saturate(-n.z);
+	n.xy += n.xy >= 0.0f ? -t : t;
+	return normalize(n);
+}
+
+// [0, 1] position back into the mesh's bounds
+float3 DecodePosition(float3 quantized, float3 positionOffset, float3 positionScale)
+{
+	return positionOffset + quantized * positionScale;
+}
+
+#endif
@@ -0,0 +1,165 @@
+#include "SelfTest.h"
+#include "VertexCompression.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// The bounds promised in VertexCompression.h
+#define OCTAHEDRAL_MAX_DEGREES	0.04
+#define HALF_MAX_RELATIVE_ERROR	(1.0 / 2048.0)
+#define UNORM16_MAX_STEPS		0.5
+
+static float RandomFloat(float low, float high)
+{
+	return low + (high - low) * rand() / (float)RAND_MAX;
+}
+
+static double AngleDegrees(const float a[3], const float b[3])
+{
+	double dot = (double)a[0] * b[0] + (double)a[1] * b[1] + (double)a[2] * b[2];
+	double crossX = (double)a[1] * b[2] - (double)a[2] * b[1];
+	double crossY = (double)a[2] * b[0] - (double)a[0] * b[2];
+	double crossZ = (double)a[0] * b[1] - (double)a[1] * b[0];
+	double cross = sqrt(crossX * crossX + crossY * crossY + crossZ * crossZ);
+
+	// atan2 stays accurate for tiny angles, where acos doesn't
+	return atan2(cross, dot) * 180.0 / 3.14159265358979323846;
+}
+
+static double OctahedralError(float x, float y, float z)
+{
+	float length = sqrtf(x * x + y * y + z * z);
+	float vector[3] = { x / length, y / length, z / length };
+
+	int16_t encoded[2];
+	float decoded[3];
+	VertexCompression::EncodeOctahedral(vector, encoded);
+	VertexCompression::DecodeOctahedral(encoded, decoded);
+	return AngleDegrees(vector, decoded);
+}
+
+static void OctahedralTest()
+{
+	// Axes, diagonals and the folds between the two halves, which
+	// is where the encoding has its seams
+	double largest = 0;
+	for (int x = -1; x <= 1; x++) {
+		for (int y = -1; y <= 1; y++) {
+			for (int z = -1; z <= 1; z++) {
+				if (x == 0 && y == 0 && z == 0)
+					continue;
+				double error = OctahedralError((float)x, (float)y, (float)z);
+				if (error > largest)
+					largest = error;
+			}
+		}
+	}
+	SELF_TEST_CHECK_AT_MOST(largest, OCTAHEDRAL_MAX_DEGREES);
+
+	srand(4);
+	largest = 0;
+	for (int i = 0; i < 200000; i++) {
+		// Every other one right on (or just under) the z = 0 fold
+		float z = i % 2 ? RandomFloat(-1, 1) : RandomFloat(-1e-4f, 1e-4f);
+		double error = OctahedralError(RandomFloat(-1, 1), RandomFloat(-1, 1), z);
+		if (error > largest)
+			largest = error;
+	}
+	SELF_TEST_CHECK_AT_MOST(largest, OCTAHEDRAL_MAX_DEGREES);
+
+	// Decoding always gives a unit vector, even for codes the
+	// encoder never writes
+	bool allUnit = true;
+	for (int x = -32768; x <= 32767; x += 97) {
+		for (int y = -32768; y <= 32767; y += 89) {
+			int16_t encoded[2] = { (int16_t)x, (int16_t)y };
+			float decoded[3];
+			VertexCompression::DecodeOctahedral(encoded, decoded);
+			float length = sqrtf(decoded[0] * decoded[0] + decoded[1] * decoded[1] + decoded[2] * decoded[2]);
+			if (fabsf(length - 1.0f) > 1e-5f)
+				allUnit = false;
+		}
+	}
+	SELF_TEST_CHECK(allUnit);
+}
+
+static void HalfTest()
+{
+	// Every half converts to a float and back to itself (NaNs stay NaN)
+	bool allRoundTrip = true;
+	for (uint32_t bits = 0; bits <= 0xFFFF; bits++) {
+		uint16_t half = (uint16_t)bits;
+		float value = VertexCompression::HalfToFloat(half);
+		uint16_t back = VertexCompression::FloatToHalf(value);
+		bool isNaN = (half & 0x7C00) == 0x7C00 && (half & 0x3FF) != 0;
+		if (isNaN ? (back & 0x7C00) != 0x7C00 || (back & 0x3FF) == 0 : back != half)
+			allRoundTrip = false;
+	}
+	SELF_TEST_CHECK(allRoundTrip);
+
+	// UVs, tiled well past 1 and negative
+	srand(5);
+	double largest = 0;
+	for (int i = 0; i < 200000; i++) {
+		float uv = RandomFloat(-64, 64);
+		if (fabsf(uv) < 1e-4f)
+			continue;
+		double error = fabs(VertexCompression::HalfToFloat(VertexCompression::FloatToHalf(uv)) - uv) / fabs(uv);
+		if (error > largest)
+			largest = error;
+	}
+	SELF_TEST_CHECK_AT_MOST(largest, HALF_MAX_RELATIVE_ERROR);
+
+	// Exact values, ties to even, overflow and underflow
+	SELF_TEST_CHECK(VertexCompression::FloatToHalf(0.0f) == 0x0000);
+	SELF_TEST_CHECK(VertexCompression::FloatToHalf(-0.0f) == 0x8000);
+	SELF_TEST_CHECK(VertexCompression::FloatToHalf(1.0f) == 0x3C00);
+	SELF_TEST_CHECK(VertexCompression::FloatToHalf(-2.0f) == 0xC000);
+	SELF_TEST_CHECK(VertexCompression::FloatToHalf(65504.0f) == 0x7BFF);
+	SELF_TEST_CHECK(VertexCompression::FloatToHalf(1.0f + 1.0f / 2048.0f) == 0x3C00);
+	SELF_TEST_CHECK(VertexCompression::FloatToHalf(1.0f + 3.0f / 2048.0f) == 0x3C02);
+	SELF_TEST_CHECK(VertexCompression::FloatToHalf(70000.0f) == 0x7C00);
+	SELF_TEST_CHECK(VertexCompression::FloatToHalf(-70000.0f) == 0xFC00);
+	SELF_TEST_CHECK(VertexCompression::FloatToHalf(1e-9f) == 0x0000);
+	SELF_TEST_CHECK(VertexCompression::FloatToHalf(5.9604645e-8f) == 0x0001);
+	SELF_TEST_CHECK(VertexCompression::HalfToFloat(0x0001) == 5.9604645e-8f);
+	SELF_TEST_CHECK(VertexCompression::HalfToFloat(0x3555) == 0.333251953125f);
+}
+
+static void Unorm16Test()
+{
+	// Half a step of the range, plus float rounding in the math
+	float min = -12.5f;
+	float size = 40.0f;
+	double bound = UNORM16_MAX_STEPS * size / 65535.0 + 1e-5;
+
+	srand(6);
+	double largest = 0;
+	for (int i = 0; i < 200000; i++) {
+		float value = RandomFloat(min, min + size);
+		float back = VertexCompression::DequantizeUnorm16(VertexCompression::QuantizeUnorm16(value, min, size), min, size);
+		double error = fabs((double)back - value);
+		if (error > largest)
+			largest = error;
+	}
+	SELF_TEST_CHECK_AT_MOST(largest, bound);
+
+	// The ends are exact, and anything outside clamps to them
+	SELF_TEST_CHECK(VertexCompression::QuantizeUnorm16(min, min, size) == 0);
+	SELF_TEST_CHECK(VertexCompression::QuantizeUnorm16(min + size, min, size) == 65535);
+	SELF_TEST_CHECK(VertexCompression::QuantizeUnorm16(min - 5, min, size) == 0);
+	SELF_TEST_CHECK(VertexCompression::QuantizeUnorm16(min + size + 5, min, size) == 65535);
+	SELF_TEST_CHECK(VertexCompression::DequantizeUnorm16(0, min, size) == min);
+	SELF_TEST_CHECK(VertexCompression::DequantizeUnorm16(65535, min, size) == min + size);
+
+	// Flat bounds (every vertex at the same height) don't divide by zero
+	SELF_TEST_CHECK(VertexCompression::QuantizeUnorm16(3, 3, 0) == 0);
+	SELF_TEST_CHECK(VertexCompression::DequantizeUnorm16(0, 3, 0) == 3);
+}
+
+void VertexCompressionTest()
+{
+	OctahedralTest();
+	HalfTest();
+	Unorm16Test();
+}
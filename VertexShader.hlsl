@@ -12,7 +12,10 @@ cbuffer perMaterial : register(b1)
 cbuffer perObject : register(b2)
 {
 	matrix world;
-	matrix worldInverseTranspose;
+
+	// Inverse transpose of world's upper 3x3, in rows padded to
+	// float4 (only the 3x3 part is used)
+	row_major float3x4 normalMatrix;
 }
 
 // Struct representing a single vertex worth of data
@@ -51,8 +54,8 @@ VertexToPixel main(VertexShaderInput input)
 	output.worldPos = mul(world, float4(input.position, 1.0f)).xyz;
 
 	// Make sure the normal is in WORLD space, not "local" space
-	output.normal = normalize(mul((float3x3)worldInverseTranspose, input.normal));
-	output.tangent = normalize(mul((float3x3)worldInverseTranspose, input.tangent));
+	output.normal = normalize(mul(input.normal, (float3x3)normalMatrix));
+	output.tangent = normalize(mul(input.tangent, (float3x3)normalMatrix));
 
 	// Pass through the uv
 	output.uv = input.uv * uvScale;
@@ -0,0 +1,74 @@
+cbuffer perFrame : register(b0)
+{
+	matrix view;
+	matrix projection;
+}
+
+cbuffer perMaterial : register(b1)
+{
+	float2 uvScale;
+}
+
+// Struct representing a single vertex worth of data, plus
+// the per-instance matrices from the second vertex buffer.
+// The "_PER_INSTANCE" suffix tells SimpleShader to pull these
+// from input slot 1 once per instance.
+struct VertexShaderInput
+{
+	float3 position		: POSITION;
+	float2 uv			: TEXCOORD;
+	float3 normal		: NORMAL;
+	float3 tangent		: TANGENT;
+
+	// Rows of the world and normal matrices (the normal
+	// matrix is 3x3, with each row padded to a float4)
+	float4 world0		: WORLD_PER_INSTANCE0;
+	float4 world1		: WORLD_PER_INSTANCE1;
+	float4 world2		: WORLD_PER_INSTANCE2;
+	float4 world3		: WORLD_PER_INSTANCE3;
+	float4 normalMatrix0	: NORMALMATRIX_PER_INSTANCE0;
+	float4 normalMatrix1	: NORMALMATRIX_PER_INSTANCE1;
+	float4 normalMatrix2	: NORMALMATRIX_PER_INSTANCE2;
+};
+
+// Out of the vertex shader (and eventually input to the PS)
+struct VertexToPixel
+{
+	float4 screenPosition	: SV_POSITION;
+	float2 uv				: TEXCOORD;
+	float3 normal			: NORMAL;
+	float3 tangent			: TANGENT;
+	float3 worldPos			: POSITION; // The world position of this vertex
+};
+
+// --------------------------------------------------------
+// Instanced version of VertexShader.hlsl - identical output,
+// but world matrices come from the vertex stream instead of
+// the perObject constant buffer
+// --------------------------------------------------------
+VertexToPixel main(VertexShaderInput input)
+{
+	// Set up output
+	VertexToPixel output;
+
+	// Instance data arrives as rows, exactly as it was laid out on the CPU
+	float4x4 world = float4x4(input.world0, input.world1, input.world2, input.world3);
+	float3x3 normalMatrix = float3x3(input.normalMatrix0.xyz, input.normalMatrix1.xyz, input.normalMatrix2.xyz);
+
+	// Calculate the world position of this vertex (to be used
+	// in the pixel shader when we do point/spot lights)
+	float4 worldPos = mul(float4(input.position, 1.0f), world);
+	output.worldPos = worldPos.xyz;
+
+	// Calculate output position
+	output.screenPosition = mul(projection, mul(view, worldPos));
+
+	// Make sure the normal is in WORLD space, not "local" space
+	output.normal = normalize(mul(input.normal, normalMatrix));
+	output.tangent = normalize(mul(input.tangent, normalMatrix));
+
+	// Pass through the uv
+	output.uv = input.uv * uvScale;
+
+	return output;
+}